@@ -2,12 +2,19 @@
 #include <random>
 #include <algorithm>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <vector>
 #include <set>
+#include <span>
 #include <string>
 #include <unordered_map>
 
 #include "RedBlackTree.h"
+#include "IntervalTree.h"
+#include "BTree.h"
+#include "FrozenTree.h"
+#include "TreeSerialization.h"
 
 class GlobalStopwatch
 {
@@ -37,6 +44,19 @@ private:
 
 #define STOPWATCH(x) GlobalStopwatch __x__(x)
 
+void Report(size_t sampleSize, size_t sampleAverage, int64_t sth)
+{
+	std::cout << "Sample size " << sampleSize << " and " << sampleAverage << " repetitions.\n";
+	std::vector<std::pair<std::string, double>> measured{ GlobalStopwatch::s_times.begin(), GlobalStopwatch::s_times.end() };
+	std::sort(measured.begin(), measured.end());
+	for (auto&&[name, time] : measured)
+	{
+		std::cout << name << std::string((sth % 2 + 34) - name.size(), ' ') << " took " << time / sampleAverage << "ms on average.\n";
+	}
+
+	GlobalStopwatch::s_times.clear();
+}
+
 int main()
 {
 	size_t sampleSize = 100000;
@@ -70,7 +90,16 @@ int main()
 
 		{
 			STOPWATCH("RedBlackTree<int64_t>.Find()");
-			for (auto num : nums) tree.Find(num);
+			for (auto num : nums) sth += tree.Find(num).first;
+		}
+		{
+			STOPWATCH("RedBlackTree<int64_t>.FindMany()");
+			std::vector<size_t> indices(256);
+			for (size_t i = 0; i < nums.size(); i += indices.size())
+			{
+				tree.FindMany(std::span(nums).subspan(i, std::min(indices.size(), nums.size() - i)), indices);
+				sth += indices[0];
+			}
 		}
 		{
 			STOPWATCH("std::set<int64_t>.find()");
@@ -89,11 +118,319 @@ int main()
 		}
 	}
 
-	std::cout << "Sample size " << sampleSize << " and " << sampleAverage << " repetitions.\n";
-	std::vector<std::pair<std::string, double>> measured{ GlobalStopwatch::s_times.begin(), GlobalStopwatch::s_times.end() };
-	std::sort(measured.begin(), measured.end());
-	for (auto&&[name, time] : measured)
+	Report(sampleSize, sampleAverage, sth);
+
+	// Appending increasing keys, with and without the end as a hint.
+	sampleSize = 1000000;
+	sampleAverage = 3;
+
+	for (size_t iter = 0; iter < sampleAverage; ++iter)
 	{
-		std::cout << name << std::string((sth % 2 + 34) - name.size(), ' ') << " took " << time / sampleAverage << "ms on average.\n";
+		std::vector<std::string> keys;
+		for (size_t i = 0; i < sampleSize; i++)
+		{
+			keys.push_back("2024-01-01T00:00:00." + std::to_string(10000000 + i));
+		}
+
+		{
+			STOPWATCH("RedBlackTree<string>.Insert()");
+			RedBlackTree<std::string> tree;
+			for (auto& key : keys) tree.Insert(key);
+			sth += tree.Size();
+		}
+		{
+			STOPWATCH("RedBlackTree<string>.Insert(end)");
+			RedBlackTree<std::string> tree;
+			for (auto& key : keys) tree.Insert(tree.end(), key);
+			sth += tree.Size();
+		}
+		{
+			STOPWATCH("RedBlackTree<int64_t>.Insert()");
+			RedBlackTree<int64_t> tree;
+			for (size_t i = 0; i < sampleSize; i++) tree.Insert(i);
+			sth += tree.Size();
+		}
+		{
+			STOPWATCH("RedBlackTree<int64_t>.Insert(end)");
+			RedBlackTree<int64_t> tree;
+			for (size_t i = 0; i < sampleSize; i++) tree.Insert(tree.end(), i);
+			sth += tree.Size();
+		}
 	}
+
+	Report(sampleSize, sampleAverage, sth);
+
+	// Draining the tree as an order-statistic priority queue, removing by
+	// rank through a key lookup and in a single pass.
+	sampleSize = 1000000;
+	sampleAverage = 3;
+
+	for (size_t iter = 0; iter < sampleAverage; ++iter)
+	{
+		std::random_device rd;
+		std::mt19937_64 e2(rd());
+		std::uniform_int_distribution<int64_t> dist(std::llround(std::pow(2, 61)), std::llround(std::pow(2, 62)));
+
+		std::vector<int64_t> nums;
+		for (size_t i = 0; i < sampleSize; i++)
+		{
+			nums.push_back(dist(e2));
+		}
+
+		RedBlackTree<int64_t> byKey(nums.begin(), nums.end()), byRank(byKey.begin(), byKey.end()), popped(byKey.begin(), byKey.end());
+		std::vector<size_t> ranks;
+		for (size_t size = byKey.Size(); size > 0; --size)
+		{
+			ranks.push_back(e2() % size);
+		}
+
+		{
+			STOPWATCH("RedBlackTree<int64_t>.Delete(At)");
+			for (auto rank : ranks) sth += byKey.Delete(byKey.At(rank));
+		}
+		{
+			STOPWATCH("RedBlackTree<int64_t>.DeleteAt()");
+			for (auto rank : ranks) sth += byRank.DeleteAt(rank);
+		}
+		{
+			STOPWATCH("RedBlackTree<int64_t>.PopMin()");
+			while (auto item = popped.PopMin()) sth += *item;
+		}
+	}
+
+	Report(sampleSize, sampleAverage, sth);
+
+	// Lookups in a tree much larger than the last level cache, where every
+	// level of a search is a cache miss.
+	sampleSize = 4000000;
+	sampleAverage = 3;
+
+	for (size_t iter = 0; iter < sampleAverage; ++iter)
+	{
+		std::random_device rd;
+		std::mt19937_64 e2(rd());
+		std::uniform_int_distribution<int64_t> dist(std::llround(std::pow(2, 61)), std::llround(std::pow(2, 62)));
+
+		std::vector<int64_t> nums;
+		for (size_t i = 0; i < sampleSize; i++)
+		{
+			nums.push_back(dist(e2));
+		}
+
+		RedBlackTree<int64_t> tree(nums.begin(), nums.end());
+		BTree<int64_t> btree(nums.begin(), nums.end());
+		auto frozen = tree.Freeze();
+
+		std::shuffle(nums.begin(), nums.end(), std::default_random_engine{ rd() });
+
+		{
+			STOPWATCH("RedBlackTree<int64_t>.Find()");
+			for (auto num : nums) sth += tree.Find(num).first;
+		}
+		{
+			STOPWATCH("RedBlackTree<int64_t>.FindMany()");
+			std::vector<size_t> indices(256);
+			for (size_t i = 0; i < nums.size(); i += indices.size())
+			{
+				tree.FindMany(std::span(nums).subspan(i, std::min(indices.size(), nums.size() - i)), indices);
+				sth += indices[0];
+			}
+		}
+		{
+			STOPWATCH("BTree<int64_t>.Find()");
+			for (auto num : nums) sth += btree.Find(num).first;
+		}
+		{
+			STOPWATCH("FrozenTree<int64_t>.Find()");
+			for (auto num : nums) sth += frozen.Find(num).first;
+		}
+	}
+
+	Report(sampleSize, sampleAverage, sth);
+
+	// Lookup streams with locality, where each key is close to the one
+	// before, from the root and through a finger.
+	sampleSize = 4000000;
+	sampleAverage = 3;
+
+	for (size_t iter = 0; iter < sampleAverage; ++iter)
+	{
+		std::random_device rd;
+		std::mt19937_64 e2(rd());
+		std::uniform_int_distribution<int64_t> dist(std::llround(std::pow(2, 61)), std::llround(std::pow(2, 62)));
+
+		std::vector<int64_t> nums;
+		for (size_t i = 0; i < sampleSize; i++)
+		{
+			nums.push_back(dist(e2));
+		}
+
+		RedBlackTree<int64_t> tree(nums.begin(), nums.end());
+		std::vector<int64_t> sequential(tree.begin(), tree.end());
+		std::vector<int64_t> clustered;
+		for (size_t i = 0; i < sequential.size(); i += 64)
+		{
+			size_t center = e2() % sequential.size();
+			for (size_t j = 0; j < 64; ++j)
+			{
+				clustered.push_back(sequential[std::min(center + e2() % 256, sequential.size() - 1)]);
+			}
+		}
+
+		{
+			STOPWATCH("Sequential Find()");
+			for (auto num : sequential) sth += tree.Find(num).first;
+		}
+		{
+			STOPWATCH("Sequential Finger.Find()");
+			RedBlackTree<int64_t>::Finger finger(tree);
+			for (auto num : sequential) sth += finger.Find(num).first;
+		}
+		{
+			STOPWATCH("Clustered Find()");
+			for (auto num : clustered) sth += tree.Find(num).first;
+		}
+		{
+			STOPWATCH("Clustered Finger.Find()");
+			RedBlackTree<int64_t>::Finger finger(tree);
+			for (auto num : clustered) sth += finger.Find(num).first;
+		}
+	}
+
+	Report(sampleSize, sampleAverage, sth);
+
+	// Merging a smaller tree into a large one, element by element and with
+	// a single set operation.
+	sampleSize = 1000000;
+	sampleAverage = 10;
+
+	for (size_t iter = 0; iter < sampleAverage; ++iter)
+	{
+		std::random_device rd;
+		std::mt19937_64 e2(rd());
+		std::uniform_int_distribution<int64_t> dist(std::llround(std::pow(2, 61)), std::llround(std::pow(2, 62)));
+
+		std::vector<int64_t> nums, shard;
+		for (size_t i = 0; i < sampleSize; i++)
+		{
+			nums.push_back(dist(e2));
+		}
+
+		for (size_t i = 0; i < sampleSize / 10; i++)
+		{
+			shard.push_back(dist(e2));
+		}
+
+		RedBlackTree<int64_t> inserted(nums.begin(), nums.end());
+		RedBlackTree<int64_t> merged(nums.begin(), nums.end());
+		RedBlackTree<int64_t> shardTree(shard.begin(), shard.end());
+
+		{
+			STOPWATCH("RedBlackTree.Insert() of shard");
+			for (auto num : shard) inserted.Insert(num);
+		}
+		{
+			STOPWATCH("RedBlackTree.Union() of shard");
+			merged.Union(std::move(shardTree));
+		}
+
+		RedBlackTree<int64_t> batched(nums.begin(), nums.end());
+		{
+			STOPWATCH("RedBlackTree.InsertBatch()");
+			batched.InsertBatch(shard);
+		}
+
+		sth += inserted.Size() + merged.Size() + batched.Size();
+	}
+
+	Report(sampleSize, sampleAverage, sth);
+
+	// Stabbing queries over many short intervals, by scanning all of them and
+	// through the interval tree.
+	sampleSize = 1000000;
+	sampleAverage = 3;
+
+	for (size_t iter = 0; iter < sampleAverage; ++iter)
+	{
+		std::random_device rd;
+		std::mt19937_64 e2(rd());
+		std::uniform_int_distribution<int64_t> dist(0, std::llround(std::pow(2, 40)));
+		std::uniform_int_distribution<int64_t> length(0, std::llround(std::pow(2, 24)));
+
+		std::vector<Interval<int64_t>> intervals;
+		for (size_t i = 0; i < sampleSize; i++)
+		{
+			int64_t low = dist(e2);
+			intervals.push_back({ low, low + length(e2) });
+		}
+
+		std::vector<int64_t> points;
+		for (size_t i = 0; i < 100; i++)
+		{
+			points.push_back(dist(e2));
+		}
+
+		IntervalTree<int64_t> tree(intervals.begin(), intervals.end());
+
+		{
+			STOPWATCH("Linear scan stabbing");
+			for (auto point : points)
+			{
+				sth += std::ranges::count_if(intervals, [&](const Interval<int64_t>& interval) { return interval.Low <= point && point <= interval.High; });
+			}
+		}
+		{
+			STOPWATCH("IntervalTree.Stabbing()");
+			for (auto point : points) sth += tree.Stabbing(point).size();
+		}
+	}
+
+	Report(sampleSize, sampleAverage, sth);
+
+	// Restoring a saved tree at startup, by inserting the items again, by
+	// reading a tree file and by mapping it.
+	sampleSize = 10000000;
+	sampleAverage = 3;
+
+	std::string filename = (std::filesystem::temp_directory_path() / "rbtree_benchmark.bin").string();
+	for (size_t iter = 0; iter < sampleAverage; ++iter)
+	{
+		std::random_device rd;
+		std::mt19937_64 e2(rd());
+		std::uniform_int_distribution<int64_t> dist(std::llround(std::pow(2, 61)), std::llround(std::pow(2, 62)));
+
+		std::vector<int64_t> nums;
+		for (size_t i = 0; i < sampleSize; i++)
+		{
+			nums.push_back(dist(e2));
+		}
+
+		{
+			RedBlackTree<int64_t> tree(nums.begin(), nums.end());
+			std::ofstream file(filename, std::ios::binary);
+			WriteTree(file, tree);
+		}
+		{
+			STOPWATCH("RedBlackTree<int64_t>.Insert()");
+			RedBlackTree<int64_t> tree;
+			for (auto num : nums) tree.Insert(num);
+			sth += tree.Size();
+		}
+		{
+			STOPWATCH("ReadTree(RedBlackTree<int64_t>)");
+			RedBlackTree<int64_t> tree;
+			std::ifstream file(filename, std::ios::binary);
+			ReadTree(file, tree);
+			sth += tree.Size();
+		}
+		{
+			STOPWATCH("MappedTree<int64_t>.Open()");
+			MappedTree<int64_t> tree;
+			tree.Open(filename);
+			sth += tree->Size() + tree->Find(nums[0]).first;
+		}
+	}
+
+	std::filesystem::remove(filename);
+	Report(sampleSize, sampleAverage, sth);
 }
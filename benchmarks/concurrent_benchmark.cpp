@@ -0,0 +1,162 @@
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+
+#include "RedBlackTree.h"
+#include "RcuRedBlackTree.h"
+#include "ConcurrentRedBlackTree.h"
+
+// Lookups per second of reader threads working on one shared tree, while a
+// single writer keeps inserting and deleting in the background.
+template <typename Lookup, typename Write>
+double MeasureReaders(size_t readerCount, const std::vector<int64_t>& nums, Lookup&& lookup, Write&& write)
+{
+	constexpr auto duration = std::chrono::milliseconds(500);
+
+	std::atomic<bool> start = false;
+	std::atomic<bool> stop = false;
+	std::atomic<size_t> totalLookups = 0;
+
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < readerCount; ++i)
+	{
+		threads.emplace_back([&, i]()
+		{
+			auto reader = lookup();
+			size_t lookups = 0;
+			size_t found = 0;
+			size_t position = i * 7919;
+			while (!start.load());
+			while (!stop.load(std::memory_order_relaxed))
+			{
+				for (size_t j = 0; j < 64; ++j, ++lookups)
+				{
+					found += reader(nums[position++ % nums.size()]);
+				}
+			}
+
+			totalLookups += lookups + found % 2;
+		});
+	}
+
+	std::thread writer([&]()
+	{
+		std::mt19937_64 e2(42);
+		while (!start.load());
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			write(nums[e2() % nums.size()]);
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	});
+
+	start = true;
+	std::this_thread::sleep_for(duration);
+	stop = true;
+
+	for (auto& thread : threads) thread.join();
+	writer.join();
+
+	return totalLookups / std::chrono::duration<double>(duration).count();
+}
+
+// Updates per second of writer threads that each insert and then delete
+// their own share of the items in one shared tree.
+template <typename Write>
+double MeasureWriters(size_t writerCount, const std::vector<int64_t>& nums, Write&& write)
+{
+	std::atomic<bool> start = false;
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < writerCount; ++i)
+	{
+		threads.emplace_back([&, i]()
+		{
+			while (!start.load());
+			for (size_t j = i; j < nums.size(); j += writerCount) write(nums[j], true);
+			for (size_t j = i; j < nums.size(); j += writerCount) write(nums[j], false);
+		});
+	}
+
+	auto begin = std::chrono::steady_clock::now();
+	start = true;
+	for (auto& thread : threads) thread.join();
+	auto end = std::chrono::steady_clock::now();
+
+	return 2 * nums.size() / std::chrono::duration<double>(end - begin).count();
+}
+
+int main()
+{
+	size_t sampleSize = 1000000;
+	size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::random_device rd;
+	std::mt19937_64 e2(rd());
+	std::uniform_int_distribution<int64_t> dist(std::llround(std::pow(2, 61)), std::llround(std::pow(2, 62)));
+
+	std::vector<int64_t> nums;
+	for (size_t i = 0; i < sampleSize; i++)
+	{
+		nums.push_back(dist(e2));
+	}
+
+	RedBlackTree<int64_t> lockedTree(nums.begin(), nums.end());
+	std::shared_mutex lock;
+
+	RcuRedBlackTree<int64_t> rcuTree;
+	for (auto num : nums) rcuTree.Insert(num);
+
+	std::shuffle(nums.begin(), nums.end(), std::default_random_engine{ rd() });
+
+	std::cout << "Sample size " << sampleSize << ", lookups per second with one writer in the background.\n";
+	std::cout << "Readers  RedBlackTree + std::shared_mutex  RcuRedBlackTree\n";
+	for (size_t readers = 1; readers <= maxThreads; readers *= 2)
+	{
+		double locked = MeasureReaders(readers, nums,
+			[&]() { return [&](int64_t num) { std::shared_lock guard(lock); return lockedTree.Contains(num); }; },
+			[&](int64_t num) { std::unique_lock guard(lock); if (!lockedTree.Delete(num)) lockedTree.Insert(num); });
+
+		double rcu = MeasureReaders(readers, nums,
+			[&]() { return [reader = std::make_shared<RcuRedBlackTree<int64_t>::Reader>(rcuTree)](int64_t num) { return reader->Contains(num); }; },
+			[&](int64_t num) { if (!rcuTree.Delete(num)) rcuTree.Insert(num); });
+
+		std::string column = std::to_string(readers);
+		std::cout << column << std::string(9 - column.size(), ' ');
+		column = std::to_string(locked / 1e6) + " M/s";
+		std::cout << column << std::string(34 - column.size(), ' ');
+		std::cout << rcu / 1e6 << " M/s\n";
+	}
+
+	std::cout << "\nSample size " << sampleSize << ", inserts and deletes per second.\n";
+	std::cout << "Writers  RedBlackTree + std::mutex  ConcurrentRedBlackTree\n";
+	for (size_t writers = 1; writers <= maxThreads; writers *= 2)
+	{
+		RedBlackTree<int64_t> mutexTree;
+		std::mutex mutex;
+		double locked = MeasureWriters(writers, nums, [&](int64_t num, bool insert)
+		{
+			std::lock_guard guard(mutex);
+			insert ? mutexTree.Insert(num) : mutexTree.Delete(num);
+		});
+
+		ConcurrentRedBlackTree<int64_t> shardedTree;
+		double sharded = MeasureWriters(writers, nums, [&](int64_t num, bool insert)
+		{
+			insert ? shardedTree.Insert(num) : shardedTree.Delete(num);
+		});
+
+		std::string column = std::to_string(writers);
+		std::cout << column << std::string(9 - column.size(), ' ');
+		column = std::to_string(locked / 1e6) + " M/s";
+		std::cout << column << std::string(27 - column.size(), ' ');
+		std::cout << sharded / 1e6 << " M/s\n";
+	}
+}
@@ -0,0 +1,772 @@
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "RedBlackTree.h"
+
+// Benchmark suite comparing RedBlackTree with std::set and a sorted vector
+// over sizes, key distributions and workloads. Every workload runs once to
+// warm up and then a number of timed repetitions, each timed as one batch;
+// throughput is the median over them. One more run times a sample of the
+// operations on their own, less the cost of reading the clock, for the p50
+// and p99 latency.
+//
+// Usage: RBTreeBenchmarkSuite [--min-size n] [--max-size n] [--repetitions n]
+//                             [--operations n] [--filter text]
+//                             [--json file] [--csv file]
+
+using Clock = std::chrono::steady_clock;
+
+//////////////////////////////////////////////////////////////////////////////
+// MEASUREMENT
+//////////////////////////////////////////////////////////////////////////////
+
+// Bytes held by the containers under test, which allocate through
+// CountingAllocator. The suite is single threaded.
+static size_t s_allocated = 0;
+
+template <typename T>
+struct CountingAllocator
+{
+	using value_type = T;
+
+	CountingAllocator() = default;
+	template <typename U>
+	CountingAllocator(const CountingAllocator<U>&) {}
+
+	T* allocate(size_t count)
+	{
+		s_allocated += count * sizeof(T);
+		return std::allocator<T>().allocate(count);
+	}
+
+	void deallocate(T* pointer, size_t count)
+	{
+		s_allocated -= count * sizeof(T);
+		std::allocator<T>().deallocate(pointer, count);
+	}
+
+	template <typename U>
+	bool operator==(const CountingAllocator<U>&) const { return true; }
+};
+
+// Latency histogram with 32 buckets per power of two, so percentiles are
+// exact to about 3% without keeping every sample.
+class LatencyHistogram
+{
+	static constexpr size_t SubBits = 5;
+	static constexpr size_t SubBuckets = 1 << SubBits;
+public:
+	void Add(int64_t nanoseconds)
+	{
+		uint64_t value = std::max<int64_t>(nanoseconds, 0);
+		m_counts[Bucket(value)]++;
+		m_count++;
+	}
+
+	double Percentile(double fraction) const
+	{
+		uint64_t target = std::max<uint64_t>(1, (uint64_t)std::ceil(fraction * m_count));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < m_counts.size(); ++i)
+		{
+			seen += m_counts[i];
+			if (seen >= target)
+			{
+				return Middle(i);
+			}
+		}
+
+		return 0;
+	}
+
+	uint64_t Count() const { return m_count; }
+private:
+	static size_t Bucket(uint64_t value)
+	{
+		if (value < SubBuckets)
+		{
+			return value;
+		}
+
+		size_t exponent = std::bit_width(value) - 1;
+		size_t sub = (value >> (exponent - SubBits)) & (SubBuckets - 1);
+		return (exponent - SubBits + 1) * SubBuckets + sub;
+	}
+
+	static double Middle(size_t bucket)
+	{
+		if (bucket < SubBuckets)
+		{
+			return (double)bucket;
+		}
+
+		size_t exponent = bucket / SubBuckets + SubBits - 1;
+		uint64_t width = uint64_t(1) << (exponent - SubBits);
+		uint64_t lower = (SubBuckets + bucket % SubBuckets) * width;
+		return lower + (width - 1) / 2.0;
+	}
+
+	std::vector<uint64_t> m_counts = std::vector<uint64_t>((64 - SubBits + 1) * SubBuckets);
+	uint64_t m_count = 0;
+};
+
+// Median of back to back clock readings, subtracted from every sample
+int64_t MeasureTimerOverhead()
+{
+	std::vector<int64_t> samples(100000);
+	for (auto& sample : samples)
+	{
+		auto start = Clock::now();
+		sample = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	}
+
+	std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+	return samples[samples.size() / 2];
+}
+
+// Peak resident memory is reset before every workload where the system
+// allows it. It covers the whole process, including the keys.
+void ResetPeakMemory()
+{
+#ifdef __linux__
+	std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+size_t PeakMemory()
+{
+#ifdef __linux__
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.rfind("VmHWM:", 0) == 0)
+		{
+			return std::stoull(line.substr(6)) * 1024;
+		}
+	}
+#endif
+	return 0;
+}
+
+struct Measurement
+{
+	LatencyHistogram Latency;
+	size_t Operations = 0;
+	double Throughput = 0;
+};
+
+static int64_t s_timerOverhead = 0;
+static volatile size_t s_sink = 0;
+
+// Runs a warmup, the timed repetitions and the latency run. Prepare sets up
+// the state a run starts from and returns how many operations it runs, and
+// Operation runs the i-th of them.
+template <typename Prepare, typename Operation>
+Measurement Measure(size_t repetitions, Prepare&& prepare, Operation&& operation)
+{
+	// Reading the clock costs about as much as a lookup in a small tree, so
+	// the repetitions do not read it between operations.
+	Measurement measurement;
+	std::vector<double> throughputs;
+	for (size_t repetition = 0; repetition <= repetitions; ++repetition)
+	{
+		size_t count = prepare();
+		size_t sink = 0;
+		auto start = Clock::now();
+		for (size_t i = 0; i < count; ++i)
+		{
+			sink += operation(i);
+		}
+
+		auto end = Clock::now();
+		s_sink = s_sink + sink;
+		if (repetition > 0)
+		{
+			measurement.Operations += count;
+			throughputs.push_back(count / std::max(1e-9, std::chrono::duration<double>(end - start).count()));
+		}
+	}
+
+	std::nth_element(throughputs.begin(), throughputs.begin() + throughputs.size() / 2, throughputs.end());
+	measurement.Throughput = throughputs[throughputs.size() / 2];
+
+	// Every operation still runs, as later ones depend on the state the
+	// earlier ones leave, but only enough of them are timed for the
+	// percentiles.
+	constexpr size_t LatencySamples = 100000;
+
+	size_t count = prepare();
+	size_t interval = std::max<size_t>(1, count / LatencySamples);
+	size_t sink = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i % interval != 0)
+		{
+			sink += operation(i);
+			continue;
+		}
+
+		auto start = Clock::now();
+		sink += operation(i);
+		auto end = Clock::now();
+		measurement.Latency.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() - s_timerOverhead);
+	}
+
+	s_sink = s_sink + sink;
+	return measurement;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// KEYS AND DISTRIBUTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+using String = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+template <typename K> const char* KeyName();
+template <> const char* KeyName<int64_t>() { return "int64_t"; }
+template <> const char* KeyName<String>() { return "string"; }
+
+// Reads a key found by rank, so the lookup cannot be optimized away
+size_t Touch(int64_t key) { return (size_t)key; }
+size_t Touch(const String& key) { return key.size(); }
+
+// Bijective, so distinct inputs give distinct keys
+uint64_t Mix(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+	return x ^ (x >> 31);
+}
+
+// Distinct keys in increasing order. Workloads address them by rank.
+template <typename K>
+std::vector<K> MakeKeys(size_t count)
+{
+	std::vector<K> keys;
+	keys.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if constexpr (std::is_same_v<K, String>)
+		{
+			std::string digits = std::to_string(Mix(i));
+			keys.emplace_back(digits.begin(), digits.end());
+		}
+		else
+		{
+			keys.push_back((int64_t)Mix(i));
+		}
+	}
+
+	std::sort(keys.begin(), keys.end());
+	return keys;
+}
+
+enum class Pattern { Sequential, Random, Zipfian, Clustered };
+
+const char* PatternName(Pattern pattern)
+{
+	switch (pattern)
+	{
+	case Pattern::Sequential: return "sequential";
+	case Pattern::Random:     return "random";
+	case Pattern::Zipfian:    return "zipfian";
+	case Pattern::Clustered:  return "clustered";
+	}
+
+	return "";
+}
+
+// Zipfian ranks as generated by YCSB, with the popular ranks scattered over
+// the key space rather than being the smallest keys.
+class Zipfian
+{
+	static constexpr double Theta = 0.99;
+public:
+	explicit Zipfian(size_t count) : m_count(count), m_zeta(0)
+	{
+		for (size_t i = 1; i <= count; ++i)
+		{
+			m_zeta += 1 / std::pow((double)i, Theta);
+		}
+
+		double zeta2 = 1 + 1 / std::pow(2.0, Theta);
+		m_alpha = 1 / (1 - Theta);
+		m_eta = (1 - std::pow(2.0 / count, 1 - Theta)) / (1 - zeta2 / m_zeta);
+	}
+
+	size_t Next(std::mt19937_64& random) const
+	{
+		double u = std::uniform_real_distribution<double>(0, 1)(random);
+		double uz = u * m_zeta;
+		size_t rank = uz < 1 ? 0 : uz < 1 + std::pow(0.5, Theta) ? 1 : (size_t)(m_count * std::pow(m_eta * u - m_eta + 1, m_alpha));
+		return Mix(std::min(rank, m_count - 1)) % m_count;
+	}
+private:
+	size_t m_count;
+	double m_zeta;
+	double m_alpha;
+	double m_eta;
+};
+
+// Ranks below count in the given pattern. Clustered ranks come in runs of
+// neighbouring keys starting at random places.
+std::vector<size_t> MakeRanks(Pattern pattern, size_t count, size_t length, const Zipfian& zipfian, std::mt19937_64& random)
+{
+	constexpr size_t ClusterLength = 64;
+
+	std::vector<size_t> ranks(length);
+	size_t position = pattern == Pattern::Sequential ? 0 : random() % count;
+	for (size_t i = 0; i < length; ++i)
+	{
+		switch (pattern)
+		{
+		case Pattern::Sequential: ranks[i] = position++ % count; break;
+		case Pattern::Random:     ranks[i] = random() % count; break;
+		case Pattern::Zipfian:    ranks[i] = zipfian.Next(random); break;
+		case Pattern::Clustered:
+			if (i % ClusterLength == 0) position = random() % count;
+			ranks[i] = position++ % count;
+			break;
+		}
+	}
+
+	return ranks;
+}
+
+// Every rank below count once, in the given pattern. Zipfian is not an order.
+std::vector<size_t> MakeOrder(Pattern pattern, size_t count, std::mt19937_64& random)
+{
+	constexpr size_t ClusterLength = 64;
+
+	std::vector<size_t> order(count);
+	std::iota(order.begin(), order.end(), 0);
+	if (pattern == Pattern::Random)
+	{
+		std::shuffle(order.begin(), order.end(), random);
+	}
+	else if (pattern == Pattern::Clustered)
+	{
+		std::vector<size_t> clusters((count + ClusterLength - 1) / ClusterLength);
+		std::iota(clusters.begin(), clusters.end(), 0);
+		std::shuffle(clusters.begin(), clusters.end(), random);
+
+		order.clear();
+		for (size_t cluster : clusters)
+		{
+			for (size_t i = cluster * ClusterLength; i < std::min(count, (cluster + 1) * ClusterLength); ++i)
+			{
+				order.push_back(i);
+			}
+		}
+	}
+
+	return order;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// CONTAINERS
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename K>
+struct TreeSubject
+{
+	static constexpr const char* Name = "RedBlackTree";
+	static constexpr bool Ranked = true;
+	static constexpr bool FastUpdates = true;
+
+	void     Build    (const std::vector<K>& keys) { Items.Assign(SortedUnique, keys.begin(), keys.end()); }
+	bool     Insert   (const K& key) { return Items.Insert(key); }
+	bool     Delete   (const K& key) { return Items.Delete(key); }
+	bool     Contains (const K& key) const { return Items.Contains(key); }
+	size_t   At       (size_t index) const { return Touch(Items.At(index)); }
+	bool     DeleteAt (size_t index) { return Items.DeleteAt(index); }
+	size_t   Size     () const { return Items.Size(); }
+
+	RedBlackTree<K, DefaultCompare<K>, CountingAllocator<K>> Items;
+};
+
+template <typename K>
+struct SetSubject
+{
+	static constexpr const char* Name = "std::set";
+	static constexpr bool Ranked = false;
+	static constexpr bool FastUpdates = true;
+
+	void     Build    (const std::vector<K>& keys) { Items.insert(keys.begin(), keys.end()); }
+	bool     Insert   (const K& key) { return Items.insert(key).second; }
+	bool     Delete   (const K& key) { return Items.erase(key) != 0; }
+	bool     Contains (const K& key) const { return Items.contains(key); }
+	size_t   At       (size_t) const { return 0; }
+	bool     DeleteAt (size_t) { return false; }
+	size_t   Size     () const { return Items.size(); }
+
+	std::set<K, std::less<>, CountingAllocator<K>> Items;
+};
+
+// Baseline for lookups. Updates move O(n) items, so they only run on small
+// sizes.
+template <typename K>
+struct SortedVectorSubject
+{
+	static constexpr const char* Name = "sorted std::vector";
+	static constexpr bool Ranked = true;
+	static constexpr bool FastUpdates = false;
+
+	void     Build    (const std::vector<K>& keys) { Items.assign(keys.begin(), keys.end()); }
+	bool     Contains (const K& key) const { return std::binary_search(Items.begin(), Items.end(), key); }
+	size_t   At       (size_t index) const { return Touch(Items[index]); }
+	bool     DeleteAt (size_t index) { Items.erase(Items.begin() + index); return true; }
+	size_t   Size     () const { return Items.size(); }
+
+	bool Insert(const K& key)
+	{
+		auto position = std::lower_bound(Items.begin(), Items.end(), key);
+		if (position != Items.end() && *position == key)
+		{
+			return false;
+		}
+
+		Items.insert(position, key);
+		return true;
+	}
+
+	bool Delete(const K& key)
+	{
+		auto position = std::lower_bound(Items.begin(), Items.end(), key);
+		if (position == Items.end() || *position != key)
+		{
+			return false;
+		}
+
+		Items.erase(position);
+		return true;
+	}
+
+	std::vector<K, CountingAllocator<K>> Items;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// SUITE
+//////////////////////////////////////////////////////////////////////////////
+
+struct Settings
+{
+	size_t MinSize = 1000;
+	size_t MaxSize = 1000000;
+	size_t Repetitions = 3;
+	size_t Operations = 1000000;
+	size_t MaxSlowUpdates = 10000;
+	size_t MaxStringSize = 10000000;
+	std::string Filter;
+	std::string JsonFile;
+	std::string CsvFile;
+};
+
+struct Result
+{
+	std::string Key;
+	size_t      Size;
+	std::string Workload;
+	std::string Subject;
+	size_t      Operations;
+	double      Throughput;
+	double      P50;
+	double      P99;
+	std::optional<double> BytesPerItem;
+	size_t      PeakMemory;
+};
+
+class Suite
+{
+public:
+	explicit Suite(const Settings& settings) : m_settings(settings), m_random(42) {}
+
+	template <typename K>
+	void Run(size_t size);
+
+	void WriteJson(std::ostream& out) const;
+	void WriteCsv(std::ostream& out) const;
+private:
+	template <typename K, typename Subject>
+	void RunSubject(const std::vector<K>& keys, const Zipfian& zipfian, bool strings);
+
+	template <typename K, typename Subject, typename Prepare, typename Operation>
+	void Workload(const std::string& name, size_t size, bool measureMemory, std::optional<Subject>& subject, Prepare&& prepare, Operation&& operation);
+
+	const Settings&     m_settings;
+	std::mt19937_64     m_random;
+	std::vector<Result> m_results;
+};
+
+template <typename K>
+void Suite::Run(size_t size)
+{
+	std::vector<K> keys = MakeKeys<K>(size);
+	Zipfian zipfian(size);
+
+	std::cout << "\n" << KeyName<K>() << " keys, " << size << " items\n";
+	std::cout << std::left << std::setw(30) << "Workload" << std::setw(20) << "Container" << std::right
+		<< std::setw(12) << "Mops/s" << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns"
+		<< std::setw(10) << "B/item" << std::setw(12) << "Peak MB" << "\n";
+
+	bool strings = std::is_same_v<K, String>;
+	RunSubject<K, TreeSubject<K>>(keys, zipfian, strings);
+	RunSubject<K, SetSubject<K>>(keys, zipfian, strings);
+	RunSubject<K, SortedVectorSubject<K>>(keys, zipfian, strings);
+}
+
+template <typename K, typename Subject>
+void Suite::RunSubject(const std::vector<K>& keys, const Zipfian& zipfian, bool strings)
+{
+	size_t size = keys.size();
+	bool updates = Subject::FastUpdates || size <= m_settings.MaxSlowUpdates;
+	std::optional<Subject> subject;
+	std::vector<size_t> ranks;
+	std::vector<bool> reads;
+
+	auto build = [&]()
+	{
+		subject.reset();
+		subject.emplace();
+		subject->Build(keys);
+	};
+
+	// Strings are measured with fewer workloads, as their comparisons
+	// dominate whatever the container.
+	std::vector<Pattern> orders = { Pattern::Sequential, Pattern::Random, Pattern::Clustered };
+	std::vector<Pattern> patterns = { Pattern::Sequential, Pattern::Random, Pattern::Zipfian, Pattern::Clustered };
+	if (strings)
+	{
+		orders = { Pattern::Random };
+		patterns = { Pattern::Random, Pattern::Zipfian };
+	}
+
+	for (Pattern pattern : orders)
+	{
+		if (!updates) break;
+
+		std::vector<size_t> order = MakeOrder(pattern, size, m_random);
+		Workload<K>(std::string("Insert/") + PatternName(pattern), size, true, subject,
+			[&]() { subject.reset(); subject.emplace(); return size; },
+			[&](size_t i) { return subject->Insert(keys[order[i]]); });
+	}
+
+	for (Pattern pattern : patterns)
+	{
+		Workload<K>(std::string("Contains/") + PatternName(pattern), size, true, subject,
+			[&]() { if (!subject) build(); ranks = MakeRanks(pattern, size, m_settings.Operations, zipfian, m_random); return ranks.size(); },
+			[&](size_t i) { return subject->Contains(keys[ranks[i]]); });
+	}
+
+	if constexpr (Subject::Ranked)
+	{
+		for (Pattern pattern : patterns)
+		{
+			Workload<K>(std::string("At/") + PatternName(pattern), size, true, subject,
+				[&]() { if (!subject) build(); ranks = MakeRanks(pattern, size, m_settings.Operations, zipfian, m_random); return ranks.size(); },
+				[&](size_t i) { return subject->At(ranks[i]); });
+		}
+
+		// Half of the items are deleted, each at a rank drawn for the
+		// original size and wrapped to the current one.
+		for (Pattern pattern : patterns)
+		{
+			if (!updates || strings) break;
+
+			Workload<K>(std::string("DeleteAt/") + PatternName(pattern), size, false, subject,
+				[&]() { build(); ranks = MakeRanks(pattern, size, std::min(size / 2, m_settings.Operations), zipfian, m_random); return ranks.size(); },
+				[&](size_t i) { return subject->DeleteAt(ranks[i] % subject->Size()); });
+		}
+	}
+
+	// Writes delete the key if it is present and insert it otherwise, so the
+	// size stays about the same.
+	for (size_t readPercent : { 50, 90, 99 })
+	{
+		for (Pattern pattern : { Pattern::Random, Pattern::Zipfian })
+		{
+			if (!updates || strings) break;
+
+			Workload<K>("Mixed " + std::to_string(readPercent) + "% reads/" + PatternName(pattern), size, false, subject,
+				[&]()
+				{
+					build();
+					ranks = MakeRanks(pattern, size, m_settings.Operations, zipfian, m_random);
+					reads.resize(ranks.size());
+					for (size_t i = 0; i < reads.size(); ++i) reads[i] = m_random() % 100 < readPercent;
+					return ranks.size();
+				},
+				[&](size_t i)
+				{
+					const K& key = keys[ranks[i]];
+					return reads[i] ? subject->Contains(key) : subject->Delete(key) || subject->Insert(key);
+				});
+		}
+	}
+}
+
+template <typename K, typename Subject, typename Prepare, typename Operation>
+void Suite::Workload(const std::string& name, size_t size, bool measureMemory, std::optional<Subject>& subject, Prepare&& prepare, Operation&& operation)
+{
+	std::string path = std::string(KeyName<K>()) + "/" + name + "/" + Subject::Name;
+	if (path.find(m_settings.Filter) == std::string::npos)
+	{
+		return;
+	}
+
+	ResetPeakMemory();
+	subject.reset();
+	size_t base = s_allocated;
+	Measurement measurement = Measure(m_settings.Repetitions, prepare, operation);
+
+	Result result;
+	result.Key = KeyName<K>();
+	result.Size = size;
+	result.Workload = name;
+	result.Subject = Subject::Name;
+	result.Operations = measurement.Operations;
+	result.Throughput = measurement.Throughput;
+	result.P50 = measurement.Latency.Percentile(0.5);
+	result.P99 = measurement.Latency.Percentile(0.99);
+	// Workloads that delete items leave freed nodes in the pools, so the
+	// memory per item is only taken after those that build or insert.
+	if (measureMemory && subject && subject->Size())
+	{
+		result.BytesPerItem = (double)(s_allocated - base) / subject->Size();
+	}
+
+	result.PeakMemory = PeakMemory();
+	m_results.push_back(result);
+
+	std::cout << std::left << std::setw(30) << result.Workload << std::setw(20) << result.Subject << std::right << std::fixed
+		<< std::setprecision(2) << std::setw(12) << result.Throughput / 1e6
+		<< std::setprecision(0) << std::setw(10) << result.P50 << std::setw(10) << result.P99
+		<< std::setprecision(1) << std::setw(10);
+	if (result.BytesPerItem)
+	{
+		std::cout << *result.BytesPerItem;
+	}
+	else
+	{
+		std::cout << "-";
+	}
+
+	std::cout << std::setw(12) << result.PeakMemory / 1e6 << "\n" << std::defaultfloat;
+}
+
+void Suite::WriteJson(std::ostream& out) const
+{
+	out << "{\n\t\"results\": [";
+	for (size_t i = 0; i < m_results.size(); ++i)
+	{
+		const Result& result = m_results[i];
+		out << (i ? "," : "") << "\n\t\t{ \"key\": \"" << result.Key << "\", \"size\": " << result.Size
+			<< ", \"workload\": \"" << result.Workload << "\", \"container\": \"" << result.Subject
+			<< "\", \"operations\": " << result.Operations << ", \"ops_per_second\": " << result.Throughput
+			<< ", \"p50_ns\": " << result.P50 << ", \"p99_ns\": " << result.P99
+			<< ", \"bytes_per_item\": ";
+		if (result.BytesPerItem)
+		{
+			out << *result.BytesPerItem;
+		}
+		else
+		{
+			out << "null";
+		}
+
+		out << ", \"peak_rss_bytes\": " << result.PeakMemory << " }";
+	}
+
+	out << "\n\t]\n}\n";
+}
+
+void Suite::WriteCsv(std::ostream& out) const
+{
+	out << "key,size,workload,container,operations,ops_per_second,p50_ns,p99_ns,bytes_per_item,peak_rss_bytes\n";
+	for (const Result& result : m_results)
+	{
+		out << result.Key << "," << result.Size << "," << result.Workload << "," << result.Subject << ","
+			<< result.Operations << "," << result.Throughput << "," << result.P50 << "," << result.P99 << ",";
+		if (result.BytesPerItem)
+		{
+			out << *result.BytesPerItem;
+		}
+
+		out << "," << result.PeakMemory << "\n";
+	}
+}
+
+bool ParseArguments(int argc, char** argv, Settings& settings)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		if (i + 1 == argc)
+		{
+			return false;
+		}
+
+		std::string value = argv[++i];
+		if (option == "--min-size") settings.MinSize = std::stoull(value);
+		else if (option == "--max-size") settings.MaxSize = std::stoull(value);
+		else if (option == "--repetitions") settings.Repetitions = std::stoull(value);
+		else if (option == "--operations") settings.Operations = std::stoull(value);
+		else if (option == "--filter") settings.Filter = value;
+		else if (option == "--json") settings.JsonFile = value;
+		else if (option == "--csv") settings.CsvFile = value;
+		else return false;
+	}
+
+	return settings.MinSize > 0 && settings.Repetitions > 0 && settings.Operations > 0;
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	if (!ParseArguments(argc, argv, settings))
+	{
+		std::cerr << "Usage: " << argv[0] << " [--min-size n] [--max-size n] [--repetitions n] [--operations n]"
+			<< " [--filter text] [--json file] [--csv file]\n";
+		return 1;
+	}
+
+	s_timerOverhead = MeasureTimerOverhead();
+	std::cout << "Timer overhead of " << s_timerOverhead << " ns is subtracted from every operation.\n";
+
+	Suite suite(settings);
+	for (size_t size = settings.MinSize; size <= settings.MaxSize; size *= 10)
+	{
+		suite.Run<int64_t>(size);
+	}
+
+	for (size_t size = settings.MinSize; size <= std::min(settings.MaxSize, settings.MaxStringSize); size *= 10)
+	{
+		suite.Run<String>(size);
+	}
+
+	if (!settings.JsonFile.empty())
+	{
+		std::ofstream json(settings.JsonFile);
+		suite.WriteJson(json);
+	}
+
+	if (!settings.CsvFile.empty())
+	{
+		std::ofstream csv(settings.CsvFile);
+		suite.WriteCsv(csv);
+	}
+}
@@ -0,0 +1,1396 @@
+#ifndef _B_TREE_H
+#define _B_TREE_H
+
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#	include <immintrin.h>
+#endif
+
+// GCC and Clang can compile single functions for instruction sets the rest
+// of the build does not target, so the node search picks the widest one the
+// CPU supports at run time.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#	define BTREE_CPU_DISPATCH
+#	define BTREE_TARGET(features) __attribute__((target(features)))
+#else
+#	define BTREE_TARGET(features)
+#endif
+
+#include "RedBlackTree.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// B TREE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Ordered set with the interface of RedBlackTree, storing many items per
+// node. A node spans a few cache lines and is searched as a whole, so a
+// lookup costs one cache miss per level of a tree that is several times
+// shallower than a binary one. Inner nodes keep the size of every child
+// subtree, which gives the same O(log n) order statistics.
+//
+// Items move between nodes as the tree changes, so unlike with RedBlackTree
+// any insertion or deletion invalidates references to them.
+template <typename T, Comparator<T> Compare = DefaultCompare<T>, typename Allocator = std::allocator<T>>
+class BTree
+{
+	static_assert(std::default_initializable<T> && std::movable<T>, "Nodes keep their items in arrays, which need default constructible and movable items.");
+private:
+	// A leaf fills NodeBytes. Every node other than the root stays at least
+	// half full, so full nodes can be split and two minimal nodes merged.
+	static constexpr size_t NodeBytes = 256;
+	static constexpr size_t HeaderBytes = std::max(sizeof(uint64_t), alignof(T));
+	static constexpr size_t Capacity = std::max<size_t>(3, (NodeBytes - HeaderBytes) / sizeof(T));
+	static constexpr size_t MinCount = (Capacity - 1) / 2;
+
+	// Every inner node has at least two children
+	static constexpr size_t MaxHeight = std::numeric_limits<size_t>::digits;
+
+	struct alignas(64) Leaf
+	{
+		uint32_t Count = 0;
+		bool     IsLeaf = true;
+		T        Keys[Capacity];
+	};
+
+	// Inner nodes extend leaves with their children and the sizes of the
+	// subtrees under them, so the items are handled the same in both.
+	struct Branch : Leaf
+	{
+		Branch() { this->IsLeaf = false; }
+
+		size_t   Sizes[Capacity + 1];
+		Leaf*    Children[Capacity + 1];
+	};
+
+	using LeafPool   = NodePool<Leaf, typename std::allocator_traits<Allocator>::template rebind_alloc<Leaf>>;
+	using BranchPool = NodePool<Branch, typename std::allocator_traits<Allocator>::template rebind_alloc<Branch>>;
+
+	// Keys searched with the natural order of signed integers are compared
+	// with SIMD instructions, a whole node at a time.
+	template <typename K>
+	static constexpr bool SimdSearch = std::is_same_v<K, T> && std::signed_integral<T> && (sizeof(T) == 4 || sizeof(T) == 8)
+		&& (std::is_same_v<Compare, std::compare_three_way> || std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<T>>);
+
+#if defined(BTREE_CPU_DISPATCH) && !defined(__AVX2__)
+	// Until these are initialized, nodes are searched without SIMD
+	inline static const bool s_hasAvx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+	inline static const bool s_hasSse42 = (__builtin_cpu_init(), __builtin_cpu_supports("sse4.2"));
+#endif
+public:
+	// In-order iterator keeping the path of nodes and positions from the root.
+	// In the deepest entry the position is that of the current item, in the
+	// entries above it that of the child the path continues into.
+	class Iterator
+	{
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type        = T;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const T*;
+		using reference         = const T&;
+
+		          Iterator   () = default;
+
+		reference operator*  () const;
+		pointer   operator-> () const;
+
+		Iterator& operator++ ();
+		Iterator  operator++ (int);
+		Iterator& operator-- ();
+		Iterator  operator-- (int);
+
+		bool      operator== (const Iterator& other) const;
+
+		size_t    Index      () const;
+	private:
+		friend class BTree;
+
+		void      PushLeftSpine  (const Leaf* node);
+		void      PushRightSpine (const Leaf* node);
+
+		const BTree*                m_tree = nullptr;
+		size_t                      m_index = 0;
+		size_t                      m_depth = 0;
+		const Leaf*                 m_nodes[MaxHeight];
+		uint32_t                    m_positions[MaxHeight];
+	};
+
+	using value_type             = T;
+	using size_type              = size_t;
+	using iterator               = Iterator;
+	using const_iterator         = Iterator;
+	using reverse_iterator       = std::reverse_iterator<Iterator>;
+	using const_reverse_iterator = std::reverse_iterator<Iterator>;
+
+			 BTree        ();
+	explicit BTree        (const Allocator& allocator);
+	explicit BTree        (const Compare& compare, const Allocator& allocator = Allocator());
+	template <std::input_iterator InputIt>
+			 BTree        (InputIt first, InputIt last, const Compare& compare = Compare(), const Allocator& allocator = Allocator());
+			 BTree        (BTree&& other) noexcept;
+	BTree&   operator=    (BTree&& other) noexcept;
+			 ~BTree       ();
+
+	bool     Insert       (const T& item);
+	bool     Insert       (T&& item);
+	template <typename... Args>
+	bool     Emplace      (Args&&... args);
+	bool     Delete       (const T& item);
+	template <HeterogeneousKey<T, Compare> K>
+	bool     Delete       (const K& key);
+	bool     DeleteAt     (size_t index);
+	void     Clear        ();
+
+	std::pair<size_t, std::reference_wrapper<const T>> Find (const T& item) const;
+	template <HeterogeneousKey<T, Compare> K>
+	std::pair<size_t, std::reference_wrapper<const T>> Find (const K& key) const;
+	const T& At           (size_t index)  const;
+	Iterator LowerBound   (const T& item) const;
+	Iterator UpperBound   (const T& item) const;
+	size_t   Rank         (const T& item) const;
+	bool     Contains     (const T& item) const;
+	template <HeterogeneousKey<T, Compare> K>
+	bool     Contains     (const K& key) const;
+
+	bool     Empty        () const;
+	size_t   Size         () const;
+	size_t   MemoryUsage  () const;
+
+	Iterator begin        () const;
+	Iterator end          () const;
+	reverse_iterator rbegin () const;
+	reverse_iterator rend () const;
+private:
+	template <typename K, typename Create>
+	bool     InsertWith   (const K& key, Create&& create);
+	template <typename Locate, typename Descend>
+	bool     Remove       (Locate&& locate, Descend&& descend);
+	template <typename K>
+	std::pair<size_t, std::reference_wrapper<const T>> FindKey (const K& key) const;
+	template <typename K>
+	bool     ContainsKey  (const K& key) const;
+	template <bool Upper>
+	Iterator Bound        (const T& item) const;
+
+	template <typename K>
+	size_t   LowerIndex   (const Leaf* node, const K& key) const;
+	template <typename K>
+	bool     Matches      (const Leaf* node, size_t index, const K& key) const;
+	static size_t CountLess (const T* keys, size_t count, T key);
+	BTREE_TARGET("avx2")
+	static size_t CountLessAvx2 (const T* keys, size_t count, T key, size_t& i);
+	BTREE_TARGET("sse4.2")
+	static size_t CountLessSse (const T* keys, size_t count, T key, size_t& i);
+	static size_t Offset  (const Branch* branch, size_t index);
+	static size_t SubtreeSize (const Leaf* node);
+
+	void     SplitChild   (Branch* parent, size_t index);
+	Leaf*    Refill       (Branch* parent, size_t index);
+	void     BorrowFromLeft  (Branch* parent, size_t index);
+	void     BorrowFromRight (Branch* parent, size_t index);
+	void     Merge        (Branch* parent, size_t index);
+	void     DestroyNode  (Leaf* node);
+	void     DestroyAll   (Leaf* node);
+
+	[[no_unique_address]] Compare m_compare;
+	LeafPool                    m_leaves;
+	BranchPool                  m_branches;
+	Leaf*                       m_root;
+	size_t                      m_treeSize;
+
+	inline static T s_default;
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+	bool CheckInvariants() const;
+	bool CheckNode(const Leaf* node, const T* low, const T* high, size_t depth, size_t& leafDepth, size_t& size) const;
+#endif
+#ifdef PROVIDE_DATA_STRUCTURE
+	bool CheckContent() const;
+#endif
+
+#ifdef ENABLE_FORCED_CHECKS
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckInvariants(const BTree<U, C, A>& tree);
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckContent(const BTree<U, C, A>& tree);
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// B TREE::ITERATOR MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator::reference BTree<T, Compare, Allocator>::Iterator::operator*() const
+{
+	return m_nodes[m_depth - 1]->Keys[m_positions[m_depth - 1]];
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator::pointer BTree<T, Compare, Allocator>::Iterator::operator->() const
+{
+	return &**this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator& BTree<T, Compare, Allocator>::Iterator::operator++()
+{
+	const Leaf* node = m_nodes[m_depth - 1];
+	uint32_t position = m_positions[m_depth - 1];
+	if (!node->IsLeaf)
+	{
+		// The successor of an inner item is the minimum of the child after it
+		m_positions[m_depth - 1] = position + 1;
+		PushLeftSpine(static_cast<const Branch*>(node)->Children[position + 1]);
+	}
+	else if (position + 1 < node->Count)
+	{
+		++m_positions[m_depth - 1];
+	}
+	else
+	{
+		// Climb until an ancestor has an item after the child we come from
+		do
+		{
+			--m_depth;
+		} while (m_depth > 0 && m_positions[m_depth - 1] == m_nodes[m_depth - 1]->Count);
+	}
+
+	++m_index;
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator BTree<T, Compare, Allocator>::Iterator::operator++(int)
+{
+	Iterator previous = *this;
+	++*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator& BTree<T, Compare, Allocator>::Iterator::operator--()
+{
+	if (m_depth == 0)
+	{
+		// Stepping back from the end lands on the maximum
+		PushRightSpine(m_tree->m_root);
+	}
+	else if (!m_nodes[m_depth - 1]->IsLeaf)
+	{
+		// The predecessor of an inner item is the maximum of the child before
+		// it, whose index equals the position of the item.
+		PushRightSpine(static_cast<const Branch*>(m_nodes[m_depth - 1])->Children[m_positions[m_depth - 1]]);
+	}
+	else if (m_positions[m_depth - 1] > 0)
+	{
+		--m_positions[m_depth - 1];
+	}
+	else
+	{
+		// Climb until an ancestor has an item before the child we come from
+		do
+		{
+			--m_depth;
+		} while (m_depth > 0 && m_positions[m_depth - 1] == 0);
+
+		if (m_depth > 0)
+		{
+			--m_positions[m_depth - 1];
+		}
+	}
+
+	--m_index;
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator BTree<T, Compare, Allocator>::Iterator::operator--(int)
+{
+	Iterator previous = *this;
+	--*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::Iterator::operator==(const Iterator& other) const
+{
+	// Within a tree, the index alone identifies the position
+	return m_index == other.m_index;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t BTree<T, Compare, Allocator>::Iterator::Index() const
+{
+	return m_index;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::Iterator::PushLeftSpine(const Leaf* node)
+{
+	while (true)
+	{
+		m_nodes[m_depth] = node;
+		m_positions[m_depth++] = 0;
+		if (node->IsLeaf)
+		{
+			break;
+		}
+
+		node = static_cast<const Branch*>(node)->Children[0];
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::Iterator::PushRightSpine(const Leaf* node)
+{
+	while (true)
+	{
+		m_nodes[m_depth] = node;
+		if (node->IsLeaf)
+		{
+			m_positions[m_depth++] = node->Count - 1;
+			break;
+		}
+
+		m_positions[m_depth++] = node->Count;
+		node = static_cast<const Branch*>(node)->Children[node->Count];
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// B TREE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline BTree<T, Compare, Allocator>::BTree()
+	: m_compare(), m_leaves(), m_branches(), m_root(nullptr), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline BTree<T, Compare, Allocator>::BTree(const Allocator& allocator)
+	: m_compare(), m_leaves(allocator), m_branches(allocator), m_root(nullptr), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline BTree<T, Compare, Allocator>::BTree(const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_leaves(allocator), m_branches(allocator), m_root(nullptr), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<std::input_iterator InputIt>
+inline BTree<T, Compare, Allocator>::BTree(InputIt first, InputIt last, const Compare& compare, const Allocator& allocator)
+	: BTree(compare, allocator)
+{
+	for (; first != last; ++first)
+	{
+		Insert(*first);
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline BTree<T, Compare, Allocator>::BTree(BTree&& other) noexcept
+	: m_compare(std::move(other.m_compare)), m_leaves(std::move(other.m_leaves)), m_branches(std::move(other.m_branches)),
+	  m_root(std::exchange(other.m_root, nullptr)), m_treeSize(std::exchange(other.m_treeSize, 0))
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline BTree<T, Compare, Allocator>& BTree<T, Compare, Allocator>::operator=(BTree&& other) noexcept
+{
+	if (this != &other)
+	{
+		Clear();
+		m_compare = std::move(other.m_compare);
+		m_leaves = std::move(other.m_leaves);
+		m_branches = std::move(other.m_branches);
+		m_root = std::exchange(other.m_root, nullptr);
+		m_treeSize = std::exchange(other.m_treeSize, 0);
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline BTree<T, Compare, Allocator>::~BTree()
+{
+	Clear();
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::Insert(const T& item)
+{
+	return InsertWith(item, [&]() { return item; });
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::Insert(T&& item)
+{
+	return InsertWith(item, [&]() { return std::move(item); });
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename... Args>
+inline bool BTree<T, Compare, Allocator>::Emplace(Args&&... args)
+{
+	T item(std::forward<Args>(args)...);
+	return InsertWith(item, [&]() { return std::move(item); });
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::Delete(const T& item)
+{
+	return Remove([&](const Leaf* node)
+	{
+		size_t index = LowerIndex(node, item);
+		return std::make_pair(index, Matches(node, index, item));
+	}, [](const Branch*, size_t) {});
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<HeterogeneousKey<T, Compare> K>
+inline bool BTree<T, Compare, Allocator>::Delete(const K& key)
+{
+	return Remove([&](const Leaf* node)
+	{
+		size_t index = LowerIndex(node, key);
+		return std::make_pair(index, Matches(node, index, key));
+	}, [](const Branch*, size_t) {});
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::DeleteAt(size_t index)
+{
+	if (index >= m_treeSize)
+	{
+		return false;
+	}
+
+	// Descends by the subtree sizes instead of comparing, so the item is
+	// located in a single pass.
+	return Remove([&](const Leaf* node)
+	{
+		if (node->IsLeaf)
+		{
+			return std::make_pair(index, true);
+		}
+
+		const Branch* branch = static_cast<const Branch*>(node);
+		size_t rank = index;
+		for (size_t i = 0; i < branch->Count; ++i)
+		{
+			if (rank < branch->Sizes[i])
+			{
+				return std::make_pair(i, false);
+			}
+
+			if (rank == branch->Sizes[i])
+			{
+				return std::make_pair(i, true);
+			}
+
+			rank -= branch->Sizes[i] + 1;
+		}
+
+		return std::make_pair(size_t(branch->Count), false);
+	}, [&](const Branch* branch, size_t child)
+	{
+		index -= Offset(branch, child);
+	});
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::Clear()
+{
+	// With trivially destructible items there is nothing to run per node, so
+	// both pools can be handed back slab by slab.
+	if constexpr (!std::is_trivially_destructible_v<T>)
+	{
+		DestroyAll(m_root);
+	}
+
+	m_leaves.Release();
+	m_branches.Release();
+	m_root = nullptr;
+	m_treeSize = 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::pair<size_t, std::reference_wrapper<const T>> BTree<T, Compare, Allocator>::Find(const T& item) const
+{
+	return FindKey(item);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<HeterogeneousKey<T, Compare> K>
+inline std::pair<size_t, std::reference_wrapper<const T>> BTree<T, Compare, Allocator>::Find(const K& key) const
+{
+	return FindKey(key);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline const T& BTree<T, Compare, Allocator>::At(size_t index) const
+{
+	if (index >= m_treeSize)
+	{
+		return s_default;
+	}
+
+	const Leaf* node = m_root;
+	while (!node->IsLeaf)
+	{
+		const Branch* branch = static_cast<const Branch*>(node);
+		size_t child = 0;
+		while (child < branch->Count && index >= branch->Sizes[child])
+		{
+			if (index == branch->Sizes[child])
+			{
+				return branch->Keys[child];
+			}
+
+			index -= branch->Sizes[child] + 1;
+			++child;
+		}
+
+		node = branch->Children[child];
+	}
+
+	return node->Keys[index];
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator BTree<T, Compare, Allocator>::LowerBound(const T& item) const
+{
+	return Bound<false>(item);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator BTree<T, Compare, Allocator>::UpperBound(const T& item) const
+{
+	return Bound<true>(item);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t BTree<T, Compare, Allocator>::Rank(const T& item) const
+{
+	size_t rank = 0;
+	const Leaf* node = m_root;
+	while (node)
+	{
+		size_t index = LowerIndex(node, item);
+		if (node->IsLeaf)
+		{
+			return rank + index;
+		}
+
+		const Branch* branch = static_cast<const Branch*>(node);
+		rank += Offset(branch, index);
+		if (Matches(branch, index, item))
+		{
+			return rank + branch->Sizes[index];
+		}
+
+		node = branch->Children[index];
+	}
+
+	return rank;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::Contains(const T& item) const
+{
+	return ContainsKey(item);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<HeterogeneousKey<T, Compare> K>
+inline bool BTree<T, Compare, Allocator>::Contains(const K& key) const
+{
+	return ContainsKey(key);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::Empty() const
+{
+	return m_treeSize == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t BTree<T, Compare, Allocator>::Size() const
+{
+	return m_treeSize;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t BTree<T, Compare, Allocator>::MemoryUsage() const
+{
+	return m_leaves.Capacity() * sizeof(Leaf) + m_branches.Capacity() * sizeof(Branch);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator BTree<T, Compare, Allocator>::begin() const
+{
+	Iterator iterator;
+	iterator.m_tree = this;
+	if (m_root)
+	{
+		iterator.PushLeftSpine(m_root);
+	}
+
+	return iterator;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Iterator BTree<T, Compare, Allocator>::end() const
+{
+	Iterator iterator;
+	iterator.m_tree = this;
+	iterator.m_index = m_treeSize;
+	return iterator;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::reverse_iterator BTree<T, Compare, Allocator>::rbegin() const
+{
+	return reverse_iterator(end());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::reverse_iterator BTree<T, Compare, Allocator>::rend() const
+{
+	return reverse_iterator(begin());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename K, typename Create>
+inline bool BTree<T, Compare, Allocator>::InsertWith(const K& key, Create&& create)
+{
+	if (!m_root)
+	{
+		Leaf* leaf = m_leaves.Create();
+		try
+		{
+			leaf->Keys[0] = create();
+		}
+		catch (...)
+		{
+			m_leaves.Destroy(leaf);
+			throw;
+		}
+
+		leaf->Count = 1;
+		m_root = leaf;
+		m_treeSize = 1;
+		return true;
+	}
+
+	// Full nodes are split on the way down, so that there is always room in
+	// the parent for the middle item of a split. The tree only grows at the
+	// root.
+	if (m_root->Count == Capacity)
+	{
+		Branch* root = m_branches.Create();
+		root->Children[0] = m_root;
+		root->Sizes[0] = m_treeSize;
+		m_root = root;
+		SplitChild(root, 0);
+	}
+
+	Branch* path[MaxHeight];
+	size_t  childIndices[MaxHeight];
+	size_t  depth = 0;
+
+	Leaf* node = m_root;
+	while (!node->IsLeaf)
+	{
+		Branch* branch = static_cast<Branch*>(node);
+		size_t index = LowerIndex(branch, key);
+		if (Matches(branch, index, key))
+		{
+			return false;
+		}
+
+		if (branch->Children[index]->Count == Capacity)
+		{
+			SplitChild(branch, index);
+			auto order = CompareOrder(m_compare, key, branch->Keys[index]);
+			if (order == 0)
+			{
+				return false;
+			}
+
+			if (order > 0)
+			{
+				++index;
+			}
+		}
+
+		path[depth] = branch;
+		childIndices[depth++] = index;
+		node = branch->Children[index];
+	}
+
+	size_t index = LowerIndex(node, key);
+	if (Matches(node, index, key))
+	{
+		return false;
+	}
+
+	// The item is only created once it is known to be missing
+	T item = create();
+	std::move_backward(node->Keys + index, node->Keys + node->Count, node->Keys + node->Count + 1);
+	node->Keys[index] = std::move(item);
+	++node->Count;
+
+	for (size_t level = 0; level < depth; ++level)
+	{
+		++path[level]->Sizes[childIndices[level]];
+	}
+
+	++m_treeSize;
+	return true;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename Locate, typename Descend>
+inline bool BTree<T, Compare, Allocator>::Remove(Locate&& locate, Descend&& descend)
+{
+	// Every child is refilled to more than the minimum before descending into
+	// it, so the removal from the leaf never needs any repair upwards. An
+	// item found in an inner node is replaced by its predecessor, the maximum
+	// of the child before it, which is then removed from its leaf instead.
+	Branch* path[MaxHeight];
+	size_t  childIndices[MaxHeight];
+	size_t  depth = 0;
+
+	T*   replaced = nullptr;
+	bool removed = false;
+
+	Leaf* node = m_root;
+	while (node)
+	{
+		if (node->IsLeaf)
+		{
+			if (replaced)
+			{
+				*replaced = std::move(node->Keys[node->Count - 1]);
+				--node->Count;
+				removed = true;
+			}
+			else if (auto [index, found] = locate(node); found)
+			{
+				std::move(node->Keys + index + 1, node->Keys + node->Count, node->Keys + index);
+				--node->Count;
+				removed = true;
+			}
+
+			break;
+		}
+
+		Branch* branch = static_cast<Branch*>(node);
+		auto [index, found] = replaced ? std::make_pair(size_t(branch->Count), false) : locate(branch);
+		if (branch->Children[index]->Count <= MinCount)
+		{
+			// The items of this node may have moved, so look again
+			node = Refill(branch, index);
+			continue;
+		}
+
+		if (found)
+		{
+			replaced = &branch->Keys[index];
+		}
+		else if (!replaced)
+		{
+			descend(branch, index);
+		}
+
+		path[depth] = branch;
+		childIndices[depth++] = index;
+		node = branch->Children[index];
+	}
+
+	if (!removed)
+	{
+		return false;
+	}
+
+	for (size_t level = 0; level < depth; ++level)
+	{
+		--path[level]->Sizes[childIndices[level]];
+	}
+
+	if (m_root->Count == 0)
+	{
+		DestroyNode(m_root);
+		m_root = nullptr;
+	}
+
+	--m_treeSize;
+	return true;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename K>
+inline std::pair<size_t, std::reference_wrapper<const T>> BTree<T, Compare, Allocator>::FindKey(const K& key) const
+{
+	size_t rank = 0;
+	const Leaf* node = m_root;
+	while (node)
+	{
+		size_t index = LowerIndex(node, key);
+		if (node->IsLeaf)
+		{
+			if (Matches(node, index, key))
+			{
+				return std::make_pair(rank + index, std::ref(node->Keys[index]));
+			}
+
+			break;
+		}
+
+		const Branch* branch = static_cast<const Branch*>(node);
+		rank += Offset(branch, index);
+		if (Matches(branch, index, key))
+		{
+			return std::make_pair(rank + branch->Sizes[index], std::ref(branch->Keys[index]));
+		}
+
+		node = branch->Children[index];
+	}
+
+	return std::make_pair(std::numeric_limits<size_t>::max(), std::ref(s_default));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename K>
+inline bool BTree<T, Compare, Allocator>::ContainsKey(const K& key) const
+{
+	const Leaf* node = m_root;
+	while (node)
+	{
+		size_t index = LowerIndex(node, key);
+		if (Matches(node, index, key))
+		{
+			return true;
+		}
+
+		if (node->IsLeaf)
+		{
+			break;
+		}
+
+		node = static_cast<const Branch*>(node)->Children[index];
+	}
+
+	return false;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<bool Upper>
+inline typename BTree<T, Compare, Allocator>::Iterator BTree<T, Compare, Allocator>::Bound(const T& item) const
+{
+	Iterator iterator;
+	iterator.m_tree = this;
+
+	const Leaf* node = m_root;
+	while (node)
+	{
+		size_t index = LowerIndex(node, item);
+		if (Upper && Matches(node, index, item))
+		{
+			++index;
+		}
+
+		iterator.m_nodes[iterator.m_depth] = node;
+		iterator.m_positions[iterator.m_depth++] = (uint32_t)index;
+		if (node->IsLeaf)
+		{
+			iterator.m_index += index;
+			break;
+		}
+
+		iterator.m_index += Offset(static_cast<const Branch*>(node), index);
+		node = static_cast<const Branch*>(node)->Children[index];
+	}
+
+	// Past the end of the leaf, the bound is the first ancestor item after it
+	while (iterator.m_depth > 0 && iterator.m_positions[iterator.m_depth - 1] == iterator.m_nodes[iterator.m_depth - 1]->Count)
+	{
+		--iterator.m_depth;
+	}
+
+	return iterator;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename K>
+inline size_t BTree<T, Compare, Allocator>::LowerIndex(const Leaf* node, const K& key) const
+{
+	if constexpr (SimdSearch<K>)
+	{
+		return CountLess(node->Keys, node->Count, key);
+	}
+	else
+	{
+		// Comparisons may be expensive for other items, so search binary
+		size_t low = 0;
+		size_t count = node->Count;
+		while (count > 0)
+		{
+			size_t half = count / 2;
+			if (CompareLess(m_compare, node->Keys[low + half], key))
+			{
+				low += half + 1;
+				count -= half + 1;
+			}
+			else
+			{
+				count = half;
+			}
+		}
+
+		return low;
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename K>
+inline bool BTree<T, Compare, Allocator>::Matches(const Leaf* node, size_t index, const K& key) const
+{
+	return index < node->Count && CompareOrder(m_compare, key, node->Keys[index]) == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t BTree<T, Compare, Allocator>::CountLess(const T* keys, size_t count, T key)
+{
+	// The keys are sorted, so the number of them less than the key is where
+	// it belongs. Counting them all takes no branches that could mispredict.
+	size_t less = 0;
+	size_t i = 0;
+#if defined(__AVX2__)
+	less = CountLessAvx2(keys, count, key, i);
+#elif defined(BTREE_CPU_DISPATCH)
+	if (s_hasAvx2)
+	{
+		less = CountLessAvx2(keys, count, key, i);
+	}
+	else if (s_hasSse42)
+	{
+		less = CountLessSse(keys, count, key, i);
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	less = CountLessSse(keys, count, key, i);
+#endif
+	for (; i < count; ++i)
+	{
+		less += keys[i] < key;
+	}
+
+	return less;
+}
+
+// Counts whole vectors of keys from i on, leaving the rest to CountLess
+template<typename T, Comparator<T> Compare, typename Allocator>
+BTREE_TARGET("avx2")
+inline size_t BTree<T, Compare, Allocator>::CountLessAvx2([[maybe_unused]] const T* keys, [[maybe_unused]] size_t count, [[maybe_unused]] T key, [[maybe_unused]] size_t& i)
+{
+	size_t less = 0;
+#if defined(__AVX2__) || defined(BTREE_CPU_DISPATCH)
+	if constexpr (sizeof(T) == 8)
+	{
+		__m256i needle = _mm256_set1_epi64x(key);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m256i greater = _mm256_cmpgt_epi64(needle, _mm256_loadu_si256((const __m256i*)(keys + i)));
+			less += std::popcount((unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(greater)));
+		}
+	}
+	else
+	{
+		__m256i needle = _mm256_set1_epi32(key);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i greater = _mm256_cmpgt_epi32(needle, _mm256_loadu_si256((const __m256i*)(keys + i)));
+			less += std::popcount((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(greater)));
+		}
+	}
+#endif
+	return less;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+BTREE_TARGET("sse4.2")
+inline size_t BTree<T, Compare, Allocator>::CountLessSse([[maybe_unused]] const T* keys, [[maybe_unused]] size_t count, [[maybe_unused]] T key, [[maybe_unused]] size_t& i)
+{
+	size_t less = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+	if constexpr (sizeof(T) == 4)
+	{
+		__m128i needle = _mm_set1_epi32(key);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i greater = _mm_cmpgt_epi32(needle, _mm_loadu_si128((const __m128i*)(keys + i)));
+			less += std::popcount((unsigned)_mm_movemask_ps(_mm_castsi128_ps(greater)));
+		}
+	}
+	// 64-bit lanes can only be compared from SSE4.2 on
+#	if defined(__SSE4_2__) || defined(BTREE_CPU_DISPATCH)
+	else
+	{
+		__m128i needle = _mm_set1_epi64x(key);
+		for (; i + 2 <= count; i += 2)
+		{
+			__m128i greater = _mm_cmpgt_epi64(needle, _mm_loadu_si128((const __m128i*)(keys + i)));
+			less += std::popcount((unsigned)_mm_movemask_pd(_mm_castsi128_pd(greater)));
+		}
+	}
+#	endif
+#endif
+	return less;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t BTree<T, Compare, Allocator>::Offset(const Branch* branch, size_t index)
+{
+	// Number of items in the subtree of the branch before its child at index
+	size_t offset = index;
+	for (size_t i = 0; i < index; ++i)
+	{
+		offset += branch->Sizes[i];
+	}
+
+	return offset;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t BTree<T, Compare, Allocator>::SubtreeSize(const Leaf* node)
+{
+	if (node->IsLeaf)
+	{
+		return node->Count;
+	}
+
+	return Offset(static_cast<const Branch*>(node), node->Count) + static_cast<const Branch*>(node)->Sizes[node->Count];
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::SplitChild(Branch* parent, size_t index)
+{
+	// The upper half of the full child moves to a new sibling and its middle
+	// item up into the parent, which is known to have room for it.
+	constexpr size_t middle = Capacity / 2;
+
+	Leaf* child = parent->Children[index];
+	Leaf* sibling;
+	if (child->IsLeaf)
+	{
+		sibling = m_leaves.Create();
+	}
+	else
+	{
+		Branch* branchChild = static_cast<Branch*>(child);
+		Branch* branchSibling = m_branches.Create();
+		std::copy(branchChild->Children + middle + 1, branchChild->Children + Capacity + 1, branchSibling->Children);
+		std::copy(branchChild->Sizes + middle + 1, branchChild->Sizes + Capacity + 1, branchSibling->Sizes);
+		sibling = branchSibling;
+	}
+
+	sibling->Count = Capacity - middle - 1;
+	std::move(child->Keys + middle + 1, child->Keys + Capacity, sibling->Keys);
+	size_t siblingSize = SubtreeSize(sibling);
+
+	std::move_backward(parent->Keys + index, parent->Keys + parent->Count, parent->Keys + parent->Count + 1);
+	std::copy_backward(parent->Children + index + 1, parent->Children + parent->Count + 1, parent->Children + parent->Count + 2);
+	std::copy_backward(parent->Sizes + index + 1, parent->Sizes + parent->Count + 1, parent->Sizes + parent->Count + 2);
+
+	parent->Keys[index] = std::move(child->Keys[middle]);
+	parent->Children[index + 1] = sibling;
+	parent->Sizes[index + 1] = siblingSize;
+	parent->Sizes[index] -= siblingSize + 1;
+	++parent->Count;
+	child->Count = middle;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename BTree<T, Compare, Allocator>::Leaf* BTree<T, Compare, Allocator>::Refill(Branch* parent, size_t index)
+{
+	// Borrow an item through the parent from a sibling that can spare one,
+	// otherwise merge with a sibling. Returns the node to carry on from,
+	// which is the only child once the root runs out of items.
+	if (index > 0 && parent->Children[index - 1]->Count > MinCount)
+	{
+		BorrowFromLeft(parent, index);
+	}
+	else if (index < parent->Count && parent->Children[index + 1]->Count > MinCount)
+	{
+		BorrowFromRight(parent, index);
+	}
+	else
+	{
+		Merge(parent, index < parent->Count ? index : index - 1);
+		if (parent == m_root && parent->Count == 0)
+		{
+			m_root = parent->Children[0];
+			m_branches.Destroy(parent);
+			return m_root;
+		}
+	}
+
+	return parent;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::BorrowFromLeft(Branch* parent, size_t index)
+{
+	Leaf* left = parent->Children[index - 1];
+	Leaf* child = parent->Children[index];
+
+	std::move_backward(child->Keys, child->Keys + child->Count, child->Keys + child->Count + 1);
+	child->Keys[0] = std::move(parent->Keys[index - 1]);
+	parent->Keys[index - 1] = std::move(left->Keys[left->Count - 1]);
+
+	size_t moved = 1;
+	if (!child->IsLeaf)
+	{
+		Branch* branchLeft = static_cast<Branch*>(left);
+		Branch* branchChild = static_cast<Branch*>(child);
+		std::copy_backward(branchChild->Children, branchChild->Children + child->Count + 1, branchChild->Children + child->Count + 2);
+		std::copy_backward(branchChild->Sizes, branchChild->Sizes + child->Count + 1, branchChild->Sizes + child->Count + 2);
+		branchChild->Children[0] = branchLeft->Children[left->Count];
+		branchChild->Sizes[0] = branchLeft->Sizes[left->Count];
+		moved += branchChild->Sizes[0];
+	}
+
+	--left->Count;
+	++child->Count;
+	parent->Sizes[index - 1] -= moved;
+	parent->Sizes[index] += moved;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::BorrowFromRight(Branch* parent, size_t index)
+{
+	Leaf* child = parent->Children[index];
+	Leaf* right = parent->Children[index + 1];
+
+	child->Keys[child->Count] = std::move(parent->Keys[index]);
+	parent->Keys[index] = std::move(right->Keys[0]);
+	std::move(right->Keys + 1, right->Keys + right->Count, right->Keys);
+
+	size_t moved = 1;
+	if (!child->IsLeaf)
+	{
+		Branch* branchChild = static_cast<Branch*>(child);
+		Branch* branchRight = static_cast<Branch*>(right);
+		branchChild->Children[child->Count + 1] = branchRight->Children[0];
+		branchChild->Sizes[child->Count + 1] = branchRight->Sizes[0];
+		moved += branchRight->Sizes[0];
+		std::copy(branchRight->Children + 1, branchRight->Children + right->Count + 1, branchRight->Children);
+		std::copy(branchRight->Sizes + 1, branchRight->Sizes + right->Count + 1, branchRight->Sizes);
+	}
+
+	++child->Count;
+	--right->Count;
+	parent->Sizes[index] += moved;
+	parent->Sizes[index + 1] -= moved;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::Merge(Branch* parent, size_t index)
+{
+	// The child at index takes the separating item and everything of its
+	// right sibling, which is then freed.
+	Leaf* left = parent->Children[index];
+	Leaf* right = parent->Children[index + 1];
+
+	left->Keys[left->Count] = std::move(parent->Keys[index]);
+	std::move(right->Keys, right->Keys + right->Count, left->Keys + left->Count + 1);
+	if (!left->IsLeaf)
+	{
+		Branch* branchLeft = static_cast<Branch*>(left);
+		Branch* branchRight = static_cast<Branch*>(right);
+		std::copy(branchRight->Children, branchRight->Children + right->Count + 1, branchLeft->Children + left->Count + 1);
+		std::copy(branchRight->Sizes, branchRight->Sizes + right->Count + 1, branchLeft->Sizes + left->Count + 1);
+	}
+
+	left->Count += 1 + right->Count;
+	parent->Sizes[index] += 1 + parent->Sizes[index + 1];
+
+	std::move(parent->Keys + index + 1, parent->Keys + parent->Count, parent->Keys + index);
+	std::copy(parent->Children + index + 2, parent->Children + parent->Count + 1, parent->Children + index + 1);
+	std::copy(parent->Sizes + index + 2, parent->Sizes + parent->Count + 1, parent->Sizes + index + 1);
+	--parent->Count;
+
+	DestroyNode(right);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::DestroyNode(Leaf* node)
+{
+	if (node->IsLeaf)
+	{
+		m_leaves.Destroy(node);
+	}
+	else
+	{
+		m_branches.Destroy(static_cast<Branch*>(node));
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void BTree<T, Compare, Allocator>::DestroyAll(Leaf* node)
+{
+	// The height is logarithmic with a large base, so recursion is harmless
+	if (!node)
+	{
+		return;
+	}
+
+	if (!node->IsLeaf)
+	{
+		Branch* branch = static_cast<Branch*>(node);
+		for (size_t i = 0; i <= branch->Count; ++i)
+		{
+			DestroyAll(branch->Children[i]);
+		}
+	}
+
+	DestroyNode(node);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DEBUG FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::CheckInvariants() const
+{
+	if (!m_root)
+	{
+		if (m_treeSize != 0)
+		{
+			printf("Found an empty tree with nonzero size!\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	size_t leafDepth = 0;
+	size_t size = 0;
+	if (!CheckNode(m_root, nullptr, nullptr, 1, leafDepth, size))
+	{
+		return false;
+	}
+
+	if (size != m_treeSize)
+	{
+		printf("Tree size different from the count of items!\n");
+		return false;
+	}
+
+	return true;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::CheckNode(const Leaf* node, const T* low, const T* high, size_t depth, size_t& leafDepth, size_t& size) const
+{
+	if (node->Count > Capacity || node->Count == 0 || (node != m_root && node->Count < MinCount))
+	{
+		printf("Found a node with %d items!\n", (int)node->Count);
+		return false;
+	}
+
+	for (size_t i = 0; i < node->Count; ++i)
+	{
+		const T* previous = i > 0 ? &node->Keys[i - 1] : low;
+		if ((previous && !CompareLess(m_compare, *previous, node->Keys[i])) || (high && !CompareLess(m_compare, node->Keys[i], *high)))
+		{
+			printf("Found items out of order at depth: %d\n", (int)depth);
+			return false;
+		}
+	}
+
+	if (node->IsLeaf)
+	{
+		if (leafDepth != 0 && leafDepth != depth)
+		{
+			printf("Found two leaves at different depths!\n");
+			return false;
+		}
+
+		leafDepth = depth;
+		size = node->Count;
+		return true;
+	}
+
+	const Branch* branch = static_cast<const Branch*>(node);
+	size = node->Count;
+	for (size_t i = 0; i <= node->Count; ++i)
+	{
+		size_t childSize = 0;
+		const T* childLow = i > 0 ? &node->Keys[i - 1] : low;
+		const T* childHigh = i < node->Count ? &node->Keys[i] : high;
+		if (!CheckNode(branch->Children[i], childLow, childHigh, depth + 1, leafDepth, childSize))
+		{
+			return false;
+		}
+
+		if (childSize != branch->Sizes[i])
+		{
+			printf("Found a child size not matching its subtree!\n");
+			return false;
+		}
+
+		size += childSize;
+	}
+
+	return true;
+}
+#endif
+
+#ifdef PROVIDE_DATA_STRUCTURE
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool BTree<T, Compare, Allocator>::CheckContent() const
+{
+	size_t count = 0;
+	for (auto it = begin(); it != end(); ++it, ++count)
+	{
+		if (count > 0 && !CompareLess(m_compare, *std::prev(it), *it))
+		{
+			printf("Found items out of order at index: %d\n", (int)count);
+			return false;
+		}
+
+		if (&At(count) != &*it || Rank(*it) != count)
+		{
+			printf("Found an index not matching the position at index: %d\n", (int)count);
+			return false;
+		}
+	}
+
+	if (count != m_treeSize)
+	{
+		printf("Tree size different from the count of items!\n");
+		return false;
+	}
+
+	return true;
+}
+#endif
+
+#ifdef ENABLE_FORCED_CHECKS
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckInvariants(const BTree<T, Compare, Allocator>& tree)
+{
+	return tree.CheckInvariants();
+}
+
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckContent(const BTree<T, Compare, Allocator>& tree)
+{
+	return tree.CheckContent();
+}
+#endif
+
+#endif
@@ -0,0 +1,643 @@
+#ifndef _CONCURRENT_RED_BLACK_TREE_H
+#define _CONCURRENT_RED_BLACK_TREE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "RedBlackTree.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// CONCURRENT RED BLACK TREE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Ordered set for many concurrent writers as well as readers.
+//
+// The key space is split into ranges, each held by a RedBlackTree of its own
+// with its own lock, so updates of different ranges run in parallel. The
+// ranges adapt to the keys: a shard that grows to twice the average size is
+// split into equal halves, and shards that shrink are merged with a neighbour,
+// keeping their number near the target. Changing the ranges needs exclusive
+// access to the layout, which every operation otherwise holds shared. The
+// layout lock is striped over cache lines, one stripe per hardware thread, so
+// that threads taking it shared do not write to the same line.
+//
+// Every shard publishes its size in an atomic counter on its own cache line,
+// so ranks add up the sizes of the shards before the key's one. With
+// concurrent writers each shard contributes its size at some point during
+// the call, rather than all of them at the same instant.
+template <typename T, Comparator<T> Compare = DefaultCompare<T>, typename Allocator = std::allocator<T>>
+class ConcurrentRedBlackTree
+{
+	static constexpr size_t CacheLineSize = 64;
+
+	// Shards are not split below this size, as their locks and the layout
+	// changes would cost more than the parallelism gains.
+	static constexpr size_t MinShardSize = 1 << 12;
+
+	using Tree = RedBlackTree<T, Compare, Allocator>;
+
+	struct alignas(CacheLineSize) Shard
+	{
+		Shard(const Compare& compare, const Allocator& allocator) : Items(compare, allocator) {}
+
+		mutable std::shared_mutex  Lock;
+		std::atomic<size_t>        Size{ 0 };
+		Tree                       Items;
+
+		// Counts the changes to the items, so a copy can tell it is current
+		uint64_t                   Version = 0;
+	};
+
+	// Copy of a shard cut into pieces that each become a shard
+	struct Split
+	{
+		const Shard*               Source;
+		uint64_t                   Version;
+		std::vector<Tree>          Pieces;
+		std::vector<T>             Bounds;
+	};
+
+	// Reader-writer lock where every thread takes one of the stripes shared,
+	// and exclusive access takes all of them in order.
+	class LayoutLock
+	{
+		struct alignas(CacheLineSize) Stripe
+		{
+			std::shared_mutex Lock;
+		};
+	public:
+		LayoutLock() : m_stripes(std::max(1u, std::thread::hardware_concurrency())) {}
+
+		std::shared_mutex& Local ();
+		void     lock         ();
+		void     unlock       ();
+	private:
+		inline static std::atomic<size_t> s_nextThread{ 0 };
+		std::vector<Stripe> m_stripes;
+	};
+public:
+	using value_type = T;
+	using size_type  = size_t;
+
+			 ConcurrentRedBlackTree ();
+	explicit ConcurrentRedBlackTree (size_t shardCount, const Compare& compare = Compare(), const Allocator& allocator = Allocator());
+			 ConcurrentRedBlackTree (const ConcurrentRedBlackTree&) = delete;
+	ConcurrentRedBlackTree& operator= (const ConcurrentRedBlackTree&) = delete;
+
+	bool     Insert       (const T& item);
+	bool     Insert       (T&& item);
+	bool     Delete       (const T& item);
+	void     Clear        ();
+
+	std::pair<size_t, T> Find (const T& item) const;
+	T        At           (size_t index) const;
+	size_t   Rank         (const T& item) const;
+	bool     Contains     (const T& item) const;
+
+	bool     Empty        () const;
+	size_t   Size         () const;
+	size_t   ShardCount   () const;
+	size_t   MemoryUsage  () const;
+private:
+	template <typename Item>
+	bool     InsertItem   (Item&& item);
+	size_t   ShardIndex   (const T& item) const;
+	size_t   Offset       (size_t shardIndex) const;
+	bool     NeedsRebalance () const;
+	void     Rebalance    ();
+	Split    PrepareSplit (const Shard& shard, size_t splitAbove) const;
+	void     ApplySplit   (size_t index, Split& split, std::vector<Tree>& retired);
+	void     SplitShard   (size_t index);
+	void     MergeShards  (size_t index);
+	size_t   SplitSize    (size_t total) const;
+
+	[[no_unique_address]] Compare m_compare;
+	Allocator                   m_allocator;
+	size_t                      m_targetShards;
+
+	// Shards in key order, where shard i holds the items from m_bounds[i - 1]
+	// up to but excluding m_bounds[i]
+	mutable LayoutLock          m_layoutLock;
+	std::mutex                  m_rebalanceLock;
+	std::vector<std::unique_ptr<Shard>> m_shards;
+	std::vector<T>              m_bounds;
+
+	// Sizes that make an update ask for a rebalance, refreshed by every one
+	alignas(CacheLineSize) std::atomic<size_t> m_splitAbove;
+	std::atomic<size_t>         m_mergeBelow;
+
+#ifdef ENABLE_FORCED_CHECKS
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckInvariants(const ConcurrentRedBlackTree<U, C, A>& tree);
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckContent(const ConcurrentRedBlackTree<U, C, A>& tree);
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// CONCURRENT RED BLACK TREE::LAYOUT LOCK MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::shared_mutex& ConcurrentRedBlackTree<T, Compare, Allocator>::LayoutLock::Local()
+{
+	// Threads are handed out stripes in the order they first get here
+	thread_local size_t thread = s_nextThread.fetch_add(1, std::memory_order_relaxed);
+	return m_stripes[thread % m_stripes.size()].Lock;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void ConcurrentRedBlackTree<T, Compare, Allocator>::LayoutLock::lock()
+{
+	for (Stripe& stripe : m_stripes)
+	{
+		stripe.Lock.lock();
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void ConcurrentRedBlackTree<T, Compare, Allocator>::LayoutLock::unlock()
+{
+	for (Stripe& stripe : m_stripes)
+	{
+		stripe.Lock.unlock();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// CONCURRENT RED BLACK TREE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline ConcurrentRedBlackTree<T, Compare, Allocator>::ConcurrentRedBlackTree()
+	: ConcurrentRedBlackTree(4 * std::max(1u, std::thread::hardware_concurrency()))
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline ConcurrentRedBlackTree<T, Compare, Allocator>::ConcurrentRedBlackTree(size_t shardCount, const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_allocator(allocator), m_targetShards(std::max<size_t>(1, shardCount)), m_splitAbove(MinShardSize), m_mergeBelow(0)
+{
+	m_shards.push_back(std::make_unique<Shard>(m_compare, m_allocator));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool ConcurrentRedBlackTree<T, Compare, Allocator>::Insert(const T& item)
+{
+	return InsertItem(item);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool ConcurrentRedBlackTree<T, Compare, Allocator>::Insert(T&& item)
+{
+	return InsertItem(std::move(item));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool ConcurrentRedBlackTree<T, Compare, Allocator>::Delete(const T& item)
+{
+	bool deleted = false;
+	bool rebalance = false;
+	{
+		std::shared_lock layout(m_layoutLock.Local());
+		Shard& shard = *m_shards[ShardIndex(item)];
+		std::unique_lock lock(shard.Lock);
+
+		deleted = shard.Items.Delete(item);
+		if (deleted)
+		{
+			++shard.Version;
+			size_t size = shard.Items.Size();
+			shard.Size.store(size, std::memory_order_relaxed);
+			rebalance = size < m_mergeBelow.load(std::memory_order_relaxed) && m_shards.size() > 1;
+		}
+	}
+
+	if (rebalance)
+	{
+		Rebalance();
+	}
+
+	return deleted;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void ConcurrentRedBlackTree<T, Compare, Allocator>::Clear()
+{
+	std::unique_lock layout(m_layoutLock);
+
+	m_shards.resize(1);
+	m_bounds.clear();
+	m_shards[0]->Items.Clear();
+	++m_shards[0]->Version;
+	m_shards[0]->Size.store(0, std::memory_order_relaxed);
+	m_splitAbove.store(MinShardSize, std::memory_order_relaxed);
+	m_mergeBelow.store(0, std::memory_order_relaxed);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::pair<size_t, T> ConcurrentRedBlackTree<T, Compare, Allocator>::Find(const T& item) const
+{
+	std::shared_lock layout(m_layoutLock.Local());
+	size_t index = ShardIndex(item);
+	const Shard& shard = *m_shards[index];
+
+	std::shared_lock lock(shard.Lock);
+	auto [rank, found] = shard.Items.Find(item);
+	if (rank == (size_t)-1)
+	{
+		return std::make_pair(rank, T());
+	}
+
+	return std::make_pair(Offset(index) + rank, found.get());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline T ConcurrentRedBlackTree<T, Compare, Allocator>::At(size_t index) const
+{
+	std::shared_lock layout(m_layoutLock.Local());
+
+	// The shard sizes may change until the shard is locked, in which case
+	// the walk over the counters starts over.
+	while (true)
+	{
+		size_t offset = 0;
+		size_t shardIndex = 0;
+		for (; shardIndex < m_shards.size(); ++shardIndex)
+		{
+			size_t size = m_shards[shardIndex]->Size.load(std::memory_order_relaxed);
+			if (index < offset + size)
+			{
+				break;
+			}
+
+			offset += size;
+		}
+
+		if (shardIndex == m_shards.size())
+		{
+			return T();
+		}
+
+		const Shard& shard = *m_shards[shardIndex];
+		std::shared_lock lock(shard.Lock);
+		if (index - offset < shard.Items.Size())
+		{
+			return shard.Items.At(index - offset);
+		}
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t ConcurrentRedBlackTree<T, Compare, Allocator>::Rank(const T& item) const
+{
+	std::shared_lock layout(m_layoutLock.Local());
+	size_t index = ShardIndex(item);
+	const Shard& shard = *m_shards[index];
+
+	std::shared_lock lock(shard.Lock);
+	return Offset(index) + shard.Items.Rank(item);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool ConcurrentRedBlackTree<T, Compare, Allocator>::Contains(const T& item) const
+{
+	std::shared_lock layout(m_layoutLock.Local());
+	const Shard& shard = *m_shards[ShardIndex(item)];
+
+	std::shared_lock lock(shard.Lock);
+	return shard.Items.Contains(item);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool ConcurrentRedBlackTree<T, Compare, Allocator>::Empty() const
+{
+	return Size() == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t ConcurrentRedBlackTree<T, Compare, Allocator>::Size() const
+{
+	std::shared_lock layout(m_layoutLock.Local());
+	return Offset(m_shards.size());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t ConcurrentRedBlackTree<T, Compare, Allocator>::ShardCount() const
+{
+	std::shared_lock layout(m_layoutLock.Local());
+	return m_shards.size();
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t ConcurrentRedBlackTree<T, Compare, Allocator>::MemoryUsage() const
+{
+	std::shared_lock layout(m_layoutLock.Local());
+	size_t memory = 0;
+	for (auto& shard : m_shards)
+	{
+		std::shared_lock lock(shard->Lock);
+		memory += sizeof(Shard) + shard->Items.MemoryUsage();
+	}
+
+	return memory;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename Item>
+inline bool ConcurrentRedBlackTree<T, Compare, Allocator>::InsertItem(Item&& item)
+{
+	bool inserted = false;
+	bool rebalance = false;
+	{
+		std::shared_lock layout(m_layoutLock.Local());
+		Shard& shard = *m_shards[ShardIndex(item)];
+		std::unique_lock lock(shard.Lock);
+
+		inserted = shard.Items.Insert(std::forward<Item>(item));
+		if (inserted)
+		{
+			++shard.Version;
+			size_t size = shard.Items.Size();
+			shard.Size.store(size, std::memory_order_relaxed);
+			rebalance = size > m_splitAbove.load(std::memory_order_relaxed);
+		}
+	}
+
+	// The layout can only change once no operation holds it, so the shard
+	// is rebalanced after its locks are released.
+	if (rebalance)
+	{
+		Rebalance();
+	}
+
+	return inserted;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t ConcurrentRedBlackTree<T, Compare, Allocator>::ShardIndex(const T& item) const
+{
+	return std::upper_bound(m_bounds.begin(), m_bounds.end(), item, [this](const T& a, const T& b)
+	{
+		return CompareLess(m_compare, a, b);
+	}) - m_bounds.begin();
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t ConcurrentRedBlackTree<T, Compare, Allocator>::Offset(size_t shardIndex) const
+{
+	size_t offset = 0;
+	for (size_t i = 0; i < shardIndex; ++i)
+	{
+		offset += m_shards[i]->Size.load(std::memory_order_relaxed);
+	}
+
+	return offset;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool ConcurrentRedBlackTree<T, Compare, Allocator>::NeedsRebalance() const
+{
+	size_t splitAbove = m_splitAbove.load(std::memory_order_relaxed);
+	size_t mergeBelow = m_mergeBelow.load(std::memory_order_relaxed);
+	if (m_shards.size() > m_targetShards)
+	{
+		return true;
+	}
+
+	for (const auto& shard : m_shards)
+	{
+		size_t size = shard->Size.load(std::memory_order_relaxed);
+		if (size > splitAbove || (size < mergeBelow && m_shards.size() > 1))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void ConcurrentRedBlackTree<T, Compare, Allocator>::Rebalance()
+{
+	// Writers that asked for a rebalance at the same time wait here, and
+	// usually find that the one before them has done the work.
+	std::lock_guard rebalance(m_rebalanceLock);
+
+	// Shards to split are copied with just them held shared, so the layout
+	// only needs to be held exclusively to swap in the pieces.
+	std::vector<Split> splits;
+	{
+		std::shared_lock layout(m_layoutLock.Local());
+		if (!NeedsRebalance())
+		{
+			return;
+		}
+
+		size_t splitAbove = SplitSize(Offset(m_shards.size()));
+		for (const auto& shard : m_shards)
+		{
+			if (shard->Size.load(std::memory_order_relaxed) > splitAbove)
+			{
+				splits.push_back(PrepareSplit(*shard, splitAbove));
+			}
+		}
+	}
+
+	// Replaced trees are freed once the layout is released again
+	std::vector<Tree> retired;
+
+	// Holding the layout exclusively, no other thread is inside any shard
+	std::unique_lock layout(m_layoutLock);
+
+	size_t total = Offset(m_shards.size());
+	size_t splitAbove = SplitSize(total);
+	size_t mergeBelow = total / m_targetShards / 4;
+	auto size = [&](size_t index) { return m_shards[index]->Items.Size(); };
+
+	// A copy is dropped if a writer changed its shard after it was taken,
+	// the shard is copied again on the next rebalance then. Should writers
+	// keep a shard changing until it is twice the split size, it is split in
+	// place instead, so that it stays bounded.
+	for (Split& split : splits)
+	{
+		auto shard = std::find_if(m_shards.begin(), m_shards.end(), [&](const auto& shard) { return shard.get() == split.Source; });
+		if (shard != m_shards.end() && (*shard)->Version == split.Version)
+		{
+			ApplySplit(shard - m_shards.begin(), split, retired);
+		}
+	}
+
+	for (size_t i = 0; i < m_shards.size(); ++i)
+	{
+		while (size(i) > 2 * splitAbove)
+		{
+			SplitShard(i);
+		}
+	}
+
+	// Small shards join their smaller neighbour, unless that would make a
+	// shard to be split again right away.
+	for (size_t i = 0; i < m_shards.size() && m_shards.size() > 1;)
+	{
+		size_t neighbour = i == 0 || (i + 1 < m_shards.size() && size(i + 1) < size(i - 1)) ? i + 1 : i - 1;
+		if (size(i) < mergeBelow && size(i) + size(neighbour) <= splitAbove)
+		{
+			MergeShards(std::min(i, neighbour));
+			i = std::min(i, neighbour);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	// Splits beyond the target are made up for by merging the adjacent pair
+	// that is smallest together, which on average is below the split size.
+	while (m_shards.size() > m_targetShards)
+	{
+		size_t smallest = 0;
+		for (size_t i = 1; i + 1 < m_shards.size(); ++i)
+		{
+			if (size(i) + size(i + 1) < size(smallest) + size(smallest + 1))
+			{
+				smallest = i;
+			}
+		}
+
+		MergeShards(smallest);
+	}
+
+	m_splitAbove.store(splitAbove, std::memory_order_relaxed);
+	m_mergeBelow.store(mergeBelow, std::memory_order_relaxed);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename ConcurrentRedBlackTree<T, Compare, Allocator>::Split ConcurrentRedBlackTree<T, Compare, Allocator>::PrepareSplit(const Shard& shard, size_t splitAbove) const
+{
+	Split split{ &shard, 0, {}, {} };
+	std::vector<T> items;
+	{
+		std::shared_lock lock(shard.Lock);
+		split.Version = shard.Version;
+		items.assign(shard.Items.begin(), shard.Items.end());
+	}
+
+	// Equal pieces, as few as keep every one within the split size. The
+	// lowest item of every piece but the first becomes its bound.
+	size_t pieces = items.size() / splitAbove + 1;
+	for (size_t piece = 0; piece < pieces; ++piece)
+	{
+		size_t first = items.size() * piece / pieces;
+		size_t last = items.size() * (piece + 1) / pieces;
+		split.Pieces.emplace_back(SortedUnique, items.begin() + first, items.begin() + last, m_compare, m_allocator);
+		if (piece > 0)
+		{
+			split.Bounds.push_back(items[first]);
+		}
+	}
+
+	return split;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void ConcurrentRedBlackTree<T, Compare, Allocator>::ApplySplit(size_t index, Split& split, std::vector<Tree>& retired)
+{
+	Shard& shard = *m_shards[index];
+	retired.push_back(std::move(shard.Items));
+	shard.Items = std::move(split.Pieces[0]);
+	shard.Size.store(shard.Items.Size(), std::memory_order_relaxed);
+
+	for (size_t piece = 1; piece < split.Pieces.size(); ++piece)
+	{
+		auto upper = std::make_unique<Shard>(m_compare, m_allocator);
+		upper->Items = std::move(split.Pieces[piece]);
+		upper->Size.store(upper->Items.Size(), std::memory_order_relaxed);
+		m_shards.insert(m_shards.begin() + index + piece, std::move(upper));
+	}
+
+	m_bounds.insert(m_bounds.begin() + index, std::make_move_iterator(split.Bounds.begin()), std::make_move_iterator(split.Bounds.end()));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void ConcurrentRedBlackTree<T, Compare, Allocator>::SplitShard(size_t index)
+{
+	// The median becomes the lowest item of the new shard and its bound
+	Shard& shard = *m_shards[index];
+	T median = shard.Items.At(shard.Items.Size() / 2);
+
+	auto upper = std::make_unique<Shard>(m_compare, m_allocator);
+	upper->Items = shard.Items.Split(median);
+	upper->Size.store(upper->Items.Size(), std::memory_order_relaxed);
+	shard.Size.store(shard.Items.Size(), std::memory_order_relaxed);
+
+	m_shards.insert(m_shards.begin() + index + 1, std::move(upper));
+	m_bounds.insert(m_bounds.begin() + index, std::move(median));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void ConcurrentRedBlackTree<T, Compare, Allocator>::MergeShards(size_t index)
+{
+	// The shards hold adjacent ranges, so they are joined in O(log n)
+	Shard& lower = *m_shards[index];
+	Shard& upper = *m_shards[index + 1];
+	if (std::optional<T> pivot = upper.Items.PopMin())
+	{
+		lower.Items = Tree::Join(std::move(lower.Items), *pivot, std::move(upper.Items));
+	}
+
+	lower.Size.store(lower.Items.Size(), std::memory_order_relaxed);
+	m_shards.erase(m_shards.begin() + index + 1);
+	m_bounds.erase(m_bounds.begin() + index);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t ConcurrentRedBlackTree<T, Compare, Allocator>::SplitSize(size_t total) const
+{
+	return std::max(MinShardSize, 2 * (total / m_targetShards));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DEBUG FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef ENABLE_FORCED_CHECKS
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckInvariants(const ConcurrentRedBlackTree<T, Compare, Allocator>& tree)
+{
+	std::unique_lock layout(tree.m_layoutLock);
+
+	bool valid = tree.m_bounds.size() + 1 == tree.m_shards.size();
+	for (size_t i = 0; i < tree.m_shards.size(); ++i)
+	{
+		const auto& shard = *tree.m_shards[i];
+		valid = valid && ForceCheckInvariants(shard.Items) && shard.Size.load() == shard.Items.Size();
+
+		// Every shard stays within its range
+		if (!shard.Items.Empty())
+		{
+			valid = valid && (i == 0 || !CompareLess(tree.m_compare, shard.Items.At(0), tree.m_bounds[i - 1]));
+			valid = valid && (i + 1 == tree.m_shards.size() || CompareLess(tree.m_compare, shard.Items.At(shard.Items.Size() - 1), tree.m_bounds[i]));
+		}
+	}
+
+	return valid;
+}
+
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckContent(const ConcurrentRedBlackTree<T, Compare, Allocator>& tree)
+{
+	std::unique_lock layout(tree.m_layoutLock);
+
+	bool valid = true;
+	for (const auto& shard : tree.m_shards)
+	{
+		valid = valid && ForceCheckContent(shard->Items);
+	}
+
+	return valid;
+}
+#endif
+
+#endif
@@ -0,0 +1,574 @@
+#ifndef _FROZEN_TREE_H
+#define _FROZEN_TREE_H
+
+#include "RedBlackTree.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// FROZEN TREE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Immutable sorted set for trees that are built once and then only searched.
+// The items are kept in a single array in Eytzinger layout: the implicit
+// binary tree with the children of position k at 2k and 2k + 1 (counting
+// from 1), filled level by level. There are no pointers, so the array takes
+// n * sizeof(T) bytes, and the top levels every search passes through share
+// a few cache lines. A View searches an array in this order kept elsewhere,
+// e.g. in a mapped file, without copying or owning it.
+template <typename T, Comparator<T> Compare = DefaultCompare<T>, typename Allocator = std::allocator<T>>
+class FrozenTree
+{
+private:
+	// A search prefetches the descendants a cache line of items further down,
+	// so that the misses of several levels overlap.
+	static constexpr size_t PrefetchStride = std::max<size_t>(1, 64 / sizeof(T));
+public:
+	// In-order iterator, which only needs the current position to step
+	class Iterator
+	{
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type        = T;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const T*;
+		using reference         = const T&;
+
+		          Iterator   () = default;
+
+		reference operator*  () const;
+		pointer   operator-> () const;
+
+		Iterator& operator++ ();
+		Iterator  operator++ (int);
+		Iterator& operator-- ();
+		Iterator  operator-- (int);
+
+		bool      operator== (const Iterator& other) const;
+
+		size_t    Index      () const;
+	private:
+		friend class FrozenTree;
+
+		          Iterator   (const FrozenTree* tree, size_t position, size_t index);
+
+		const FrozenTree*           m_tree = nullptr;
+		size_t                      m_position = 0;
+		size_t                      m_index = 0;
+	};
+
+	using value_type             = T;
+	using size_type              = size_t;
+	using iterator               = Iterator;
+	using const_iterator         = Iterator;
+	using reverse_iterator       = std::reverse_iterator<Iterator>;
+	using const_reverse_iterator = std::reverse_iterator<Iterator>;
+
+			 FrozenTree   ();
+	explicit FrozenTree   (const Compare& compare, const Allocator& allocator = Allocator());
+	template <std::forward_iterator ForwardIt>
+			 FrozenTree   (SortedUniqueTag, ForwardIt first, ForwardIt last, const Compare& compare = Compare(), const Allocator& allocator = Allocator());
+			 FrozenTree   (const FrozenTree& other);
+			 FrozenTree   (FrozenTree&& other) noexcept;
+	FrozenTree& operator= (const FrozenTree& other);
+	FrozenTree& operator= (FrozenTree&& other) noexcept;
+
+	static FrozenTree View (std::span<const T> items, const Compare& compare = Compare());
+	std::span<const T> Items () const;
+
+	std::pair<size_t, std::reference_wrapper<const T>> Find (const T& item) const;
+	template <HeterogeneousKey<T, Compare> K>
+	std::pair<size_t, std::reference_wrapper<const T>> Find (const K& key) const;
+	const T& At           (size_t index)  const;
+	Iterator LowerBound   (const T& item) const;
+	Iterator UpperBound   (const T& item) const;
+	size_t   Rank         (const T& item) const;
+	bool     Contains     (const T& item) const;
+	template <HeterogeneousKey<T, Compare> K>
+	bool     Contains     (const K& key) const;
+
+	bool     Empty        () const;
+	size_t   Size         () const;
+	size_t   MemoryUsage  () const;
+
+	Iterator begin        () const;
+	Iterator end          () const;
+	reverse_iterator rbegin () const;
+	reverse_iterator rend () const;
+private:
+	template <bool Upper, typename K>
+	size_t   Search       (const K& key) const;
+	size_t   LeftSize     (size_t position) const;
+	size_t   RankOf       (size_t position) const;
+	static size_t First   (size_t count);
+	static size_t Last    (size_t count);
+	static size_t Next    (size_t position, size_t count);
+	static size_t Previous (size_t position, size_t count);
+
+	void     Adopt        (const FrozenTree& other);
+
+	[[no_unique_address]] Compare m_compare;
+	std::vector<T, Allocator>   m_items;
+	const T*                    m_data;
+	size_t                      m_size;
+	size_t                      m_height;
+
+	inline static T s_default;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// FROZEN TREE::ITERATOR MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline FrozenTree<T, Compare, Allocator>::Iterator::Iterator(const FrozenTree* tree, size_t position, size_t index)
+	: m_tree(tree), m_position(position), m_index(index)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator::reference FrozenTree<T, Compare, Allocator>::Iterator::operator*() const
+{
+	return m_tree->m_data[m_position - 1];
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator::pointer FrozenTree<T, Compare, Allocator>::Iterator::operator->() const
+{
+	return &**this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator& FrozenTree<T, Compare, Allocator>::Iterator::operator++()
+{
+	m_position = Next(m_position, m_tree->m_size);
+	++m_index;
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator FrozenTree<T, Compare, Allocator>::Iterator::operator++(int)
+{
+	Iterator previous = *this;
+	++*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator& FrozenTree<T, Compare, Allocator>::Iterator::operator--()
+{
+	// Stepping back from the end lands on the maximum
+	m_position = m_position ? Previous(m_position, m_tree->m_size) : Last(m_tree->m_size);
+	--m_index;
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator FrozenTree<T, Compare, Allocator>::Iterator::operator--(int)
+{
+	Iterator previous = *this;
+	--*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool FrozenTree<T, Compare, Allocator>::Iterator::operator==(const Iterator& other) const
+{
+	return m_position == other.m_position;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::Iterator::Index() const
+{
+	return m_index;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// FROZEN TREE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline FrozenTree<T, Compare, Allocator>::FrozenTree()
+	: m_compare(), m_items(), m_data(nullptr), m_size(0), m_height(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline FrozenTree<T, Compare, Allocator>::FrozenTree(const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_items(allocator), m_data(nullptr), m_size(0), m_height(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<std::forward_iterator ForwardIt>
+inline FrozenTree<T, Compare, Allocator>::FrozenTree(SortedUniqueTag, ForwardIt first, ForwardIt last, const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_items(allocator), m_data(nullptr), m_size(0), m_height(0)
+{
+	size_t count = std::distance(first, last);
+	m_height = std::bit_width(count);
+
+	// Walking the positions in order assigns every one its item, then the
+	// items are copied in position order, so each is constructed only once.
+	std::vector<const T*> ordered(count);
+	m_items.reserve(count);
+	for (size_t position = First(count); first != last; ++first)
+	{
+		ordered[position - 1] = &*first;
+		position = Next(position, count);
+	}
+
+	for (const T* item : ordered)
+	{
+		m_items.push_back(*item);
+	}
+
+	m_data = m_items.data();
+	m_size = count;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline FrozenTree<T, Compare, Allocator>::FrozenTree(const FrozenTree& other)
+	: m_compare(other.m_compare), m_items(other.m_items), m_data(nullptr), m_size(0), m_height(0)
+{
+	Adopt(other);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline FrozenTree<T, Compare, Allocator>::FrozenTree(FrozenTree&& other) noexcept
+	: m_compare(std::move(other.m_compare)), m_items(std::move(other.m_items)), m_data(other.m_data), m_size(other.m_size), m_height(other.m_height)
+{
+	// Moving the vector keeps its buffer, so owned items stay where they are
+	other.m_data = nullptr;
+	other.m_size = 0;
+	other.m_height = 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline FrozenTree<T, Compare, Allocator>& FrozenTree<T, Compare, Allocator>::operator=(const FrozenTree& other)
+{
+	if (this != &other)
+	{
+		m_compare = other.m_compare;
+		m_items = other.m_items;
+		Adopt(other);
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline FrozenTree<T, Compare, Allocator>& FrozenTree<T, Compare, Allocator>::operator=(FrozenTree&& other) noexcept
+{
+	if (this != &other)
+	{
+		// A view keeps pointing at the borrowed items, whereas owned items
+		// may be copied by the move if the allocators differ.
+		bool owned = other.m_data == other.m_items.data();
+		m_compare = std::move(other.m_compare);
+		m_items = std::move(other.m_items);
+		m_data = owned ? m_items.data() : other.m_data;
+		m_size = other.m_size;
+		m_height = other.m_height;
+
+		other.m_items.clear();
+		other.m_data = nullptr;
+		other.m_size = 0;
+		other.m_height = 0;
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline FrozenTree<T, Compare, Allocator> FrozenTree<T, Compare, Allocator>::View(std::span<const T> items, const Compare& compare)
+{
+	FrozenTree view(compare);
+	view.m_data = items.data();
+	view.m_size = items.size();
+	view.m_height = std::bit_width(items.size());
+	return view;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::span<const T> FrozenTree<T, Compare, Allocator>::Items() const
+{
+	return std::span<const T>(m_data, m_size);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::pair<size_t, std::reference_wrapper<const T>> FrozenTree<T, Compare, Allocator>::Find(const T& item) const
+{
+	size_t position = Search<false>(item);
+	if (position == 0 || CompareOrder(m_compare, item, m_data[position - 1]) != 0)
+	{
+		return std::make_pair(std::numeric_limits<size_t>::max(), std::ref(s_default));
+	}
+
+	return std::make_pair(RankOf(position), std::ref(m_data[position - 1]));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<HeterogeneousKey<T, Compare> K>
+inline std::pair<size_t, std::reference_wrapper<const T>> FrozenTree<T, Compare, Allocator>::Find(const K& key) const
+{
+	size_t position = Search<false>(key);
+	if (position == 0 || CompareOrder(m_compare, key, m_data[position - 1]) != 0)
+	{
+		return std::make_pair(std::numeric_limits<size_t>::max(), std::ref(s_default));
+	}
+
+	return std::make_pair(RankOf(position), std::ref(m_data[position - 1]));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline const T& FrozenTree<T, Compare, Allocator>::At(size_t index) const
+{
+	if (index >= m_size)
+	{
+		return s_default;
+	}
+
+	size_t position = 1;
+	while (true)
+	{
+		size_t leftSize = LeftSize(position);
+		if (index == leftSize)
+		{
+			return m_data[position - 1];
+		}
+
+		if (index < leftSize)
+		{
+			position = 2 * position;
+		}
+		else
+		{
+			index -= leftSize + 1;
+			position = 2 * position + 1;
+		}
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator FrozenTree<T, Compare, Allocator>::LowerBound(const T& item) const
+{
+	size_t position = Search<false>(item);
+	return Iterator(this, position, RankOf(position));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator FrozenTree<T, Compare, Allocator>::UpperBound(const T& item) const
+{
+	size_t position = Search<true>(item);
+	return Iterator(this, position, RankOf(position));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::Rank(const T& item) const
+{
+	return RankOf(Search<false>(item));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool FrozenTree<T, Compare, Allocator>::Contains(const T& item) const
+{
+	size_t position = Search<false>(item);
+	return position != 0 && CompareOrder(m_compare, item, m_data[position - 1]) == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<HeterogeneousKey<T, Compare> K>
+inline bool FrozenTree<T, Compare, Allocator>::Contains(const K& key) const
+{
+	size_t position = Search<false>(key);
+	return position != 0 && CompareOrder(m_compare, key, m_data[position - 1]) == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool FrozenTree<T, Compare, Allocator>::Empty() const
+{
+	return m_size == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::Size() const
+{
+	return m_size;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::MemoryUsage() const
+{
+	return m_items.capacity() * sizeof(T);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator FrozenTree<T, Compare, Allocator>::begin() const
+{
+	return Iterator(this, First(m_size), 0);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::Iterator FrozenTree<T, Compare, Allocator>::end() const
+{
+	return Iterator(this, 0, m_size);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::reverse_iterator FrozenTree<T, Compare, Allocator>::rbegin() const
+{
+	return reverse_iterator(end());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename FrozenTree<T, Compare, Allocator>::reverse_iterator FrozenTree<T, Compare, Allocator>::rend() const
+{
+	return reverse_iterator(begin());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void FrozenTree<T, Compare, Allocator>::Adopt(const FrozenTree& other)
+{
+	// Called after copying the items, to point at the copy unless the other
+	// tree is a view
+	m_data = other.m_data == other.m_items.data() ? m_items.data() : other.m_data;
+	m_size = other.m_size;
+	m_height = other.m_height;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<bool Upper, typename K>
+inline size_t FrozenTree<T, Compare, Allocator>::Search(const K& key) const
+{
+	// The comparison result is the next bit of the position, so the loop has
+	// no branch depending on the items and runs a fixed number of levels.
+	// The bits appended after the last left turn are all ones, stripping
+	// them and that turn leaves the position of the bound, or 0 if there is
+	// none.
+	const T* items = m_data;
+	size_t count = m_size;
+
+	size_t position = 1;
+	while (position <= count)
+	{
+		RBT_PREFETCH(items + std::min(position * PrefetchStride, count) - 1);
+		if constexpr (Upper)
+		{
+			position = 2 * position + !CompareLess(m_compare, key, items[position - 1]);
+		}
+		else
+		{
+			position = 2 * position + CompareLess(m_compare, items[position - 1], key);
+		}
+	}
+
+	return position >> (std::countr_one(position) + 1);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::LeftSize(size_t position) const
+{
+	// All levels but the last are full, so the size of a subtree follows from
+	// how much of the last level lies under it.
+	size_t below = m_height - std::bit_width(position);
+	if (below == 0)
+	{
+		return 0;
+	}
+
+	size_t width = (size_t)1 << (below - 1);
+	size_t first = position << below;
+	size_t last = first <= m_size ? std::min(m_size - first + 1, width) : 0;
+	return width - 1 + last;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::RankOf(size_t position) const
+{
+	if (position == 0)
+	{
+		return m_size;
+	}
+
+	// Every right turn on the way from the root passes a node and its left
+	// subtree.
+	size_t rank = LeftSize(position);
+	for (size_t level = std::bit_width(position) - 1; level > 0; --level)
+	{
+		if ((position >> (level - 1)) & 1)
+		{
+			rank += LeftSize(position >> level) + 1;
+		}
+	}
+
+	return rank;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::First(size_t count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	size_t position = 1;
+	while (2 * position <= count)
+	{
+		position = 2 * position;
+	}
+
+	return position;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::Last(size_t count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	size_t position = 1;
+	while (2 * position + 1 <= count)
+	{
+		position = 2 * position + 1;
+	}
+
+	return position;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::Next(size_t position, size_t count)
+{
+	// The minimum of the right subtree, or else the first ancestor reached
+	// from a left subtree
+	if (2 * position + 1 <= count)
+	{
+		position = 2 * position + 1;
+		while (2 * position <= count)
+		{
+			position = 2 * position;
+		}
+
+		return position;
+	}
+
+	return position >> (std::countr_one(position) + 1);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t FrozenTree<T, Compare, Allocator>::Previous(size_t position, size_t count)
+{
+	// The maximum of the left subtree, or else the first ancestor reached
+	// from a right subtree
+	if (2 * position <= count)
+	{
+		position = 2 * position;
+		while (2 * position + 1 <= count)
+		{
+			position = 2 * position + 1;
+		}
+
+		return position;
+	}
+
+	return position >> (std::countr_zero(position) + 1);
+}
+
+#endif
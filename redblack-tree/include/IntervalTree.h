@@ -0,0 +1,276 @@
+#ifndef _INTERVAL_TREE_H
+#define _INTERVAL_TREE_H
+
+#include "RedBlackTree.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// INTERVAL DEFINITION
+//////////////////////////////////////////////////////////////////////////////
+
+// Closed interval [Low, High]. Intervals are ordered by their low and then by
+// their high endpoint.
+template <typename T>
+struct Interval
+{
+	T Low;
+	T High;
+
+	auto operator<=> (const Interval& other) const = default;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// INTERVAL TREE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Set of intervals stored as a RedBlackTree ordered by the low endpoints,
+// where every node also keeps the greatest high endpoint in its subtree. That
+// maximum is maintained by the tree itself as an augmentation, so it stays
+// correct through every rotation, fixup, join and split.
+template <typename T, typename Allocator = std::allocator<Interval<T>>>
+class IntervalTree
+{
+	static_assert(std::numeric_limits<T>::is_specialized, "Endpoints need std::numeric_limits for the empty maximum.");
+public:
+	using value_type = Interval<T>;
+private:
+	struct EndAugmentation
+	{
+		using Value = T;
+
+		static constexpr Value Identity() { return std::numeric_limits<T>::lowest(); }
+		static constexpr Value Lift(const value_type& interval) { return interval.High; }
+		static constexpr Value Combine(const Value& a, const Value& b) { return a < b ? b : a; }
+	};
+
+	using Tree = RedBlackTree<value_type, DefaultCompare<value_type>, Allocator, EndAugmentation>;
+	using Node = typename Tree::Node;
+public:
+	using size_type      = size_t;
+	using iterator       = typename Tree::Iterator;
+	using const_iterator = typename Tree::Iterator;
+
+			 IntervalTree ();
+	explicit IntervalTree (const Allocator& allocator);
+	template <std::input_iterator InputIt>
+			 IntervalTree (InputIt first, InputIt last, const Allocator& allocator = Allocator());
+
+	bool     Insert       (const T& low, const T& high);
+	bool     Delete       (const T& low, const T& high);
+	void     Clear        ();
+
+	template <typename Visit>
+	void     ForEachOverlapping (const T& low, const T& high, Visit&& visit) const;
+	std::vector<value_type> Overlapping (const T& low, const T& high) const;
+	std::vector<value_type> Stabbing    (const T& point) const;
+	bool     Overlaps     (const T& low, const T& high) const;
+	bool     Contains     (const T& low, const T& high) const;
+
+	bool     Empty        () const;
+	size_t   Size         () const;
+	size_t   MemoryUsage  () const;
+
+	const_iterator begin  () const;
+	const_iterator end    () const;
+private:
+	static const T& MaxHigh (const Node* node);
+
+	Tree                        m_tree;
+
+#ifdef ENABLE_FORCED_CHECKS
+	template <typename U, typename A> friend bool ForceCheckInvariants(const IntervalTree<U, A>& tree);
+	template <typename U, typename A> friend bool ForceCheckContent(const IntervalTree<U, A>& tree);
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// INTERVAL TREE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, typename Allocator>
+inline IntervalTree<T, Allocator>::IntervalTree()
+	: m_tree()
+{}
+
+template<typename T, typename Allocator>
+inline IntervalTree<T, Allocator>::IntervalTree(const Allocator& allocator)
+	: m_tree(allocator)
+{}
+
+template<typename T, typename Allocator>
+template<std::input_iterator InputIt>
+inline IntervalTree<T, Allocator>::IntervalTree(InputIt first, InputIt last, const Allocator& allocator)
+	: m_tree(allocator)
+{
+	std::vector<value_type> intervals;
+	for (; first != last; ++first)
+	{
+		const value_type& interval = *first;
+		if (!(interval.High < interval.Low))
+		{
+			intervals.push_back(interval);
+		}
+	}
+
+	m_tree.Assign(intervals.begin(), intervals.end());
+}
+
+template<typename T, typename Allocator>
+inline bool IntervalTree<T, Allocator>::Insert(const T& low, const T& high)
+{
+	// An interval ending before it starts would be empty
+	if (high < low)
+	{
+		return false;
+	}
+
+	return m_tree.Insert(value_type{ low, high });
+}
+
+template<typename T, typename Allocator>
+inline bool IntervalTree<T, Allocator>::Delete(const T& low, const T& high)
+{
+	return m_tree.Delete(value_type{ low, high });
+}
+
+template<typename T, typename Allocator>
+inline void IntervalTree<T, Allocator>::Clear()
+{
+	m_tree.Clear();
+}
+
+template<typename T, typename Allocator>
+template<typename Visit>
+inline void IntervalTree<T, Allocator>::ForEachOverlapping(const T& low, const T& high, Visit&& visit) const
+{
+	// An in-order walk that skips every subtree ending before low. Since the
+	// intervals are ordered by their low endpoints, the walk is over at the
+	// first one starting after high. Every subtree entered holds an interval
+	// reaching low, so the nodes visited beyond the results are only those
+	// on the paths to them and to the two bounds.
+	const Node* path[Tree::MaxHeight];
+	size_t depth = 0;
+
+	const Node* node = m_tree.m_root;
+	while (true)
+	{
+		while (node && !(MaxHigh(node) < low))
+		{
+			path[depth++] = node;
+			node = node->Left;
+		}
+
+		if (depth == 0)
+		{
+			break;
+		}
+
+		node = path[--depth];
+		if (high < node->Item.Low)
+		{
+			break;
+		}
+
+		if (!(node->Item.High < low))
+		{
+			visit(node->Item);
+		}
+
+		node = node->Right;
+	}
+}
+
+template<typename T, typename Allocator>
+inline std::vector<typename IntervalTree<T, Allocator>::value_type> IntervalTree<T, Allocator>::Overlapping(const T& low, const T& high) const
+{
+	std::vector<value_type> found;
+	ForEachOverlapping(low, high, [&](const value_type& interval) { found.push_back(interval); });
+	return found;
+}
+
+template<typename T, typename Allocator>
+inline std::vector<typename IntervalTree<T, Allocator>::value_type> IntervalTree<T, Allocator>::Stabbing(const T& point) const
+{
+	return Overlapping(point, point);
+}
+
+template<typename T, typename Allocator>
+inline bool IntervalTree<T, Allocator>::Overlaps(const T& low, const T& high) const
+{
+	// If the left subtree reaches low but holds no overlap, its interval
+	// reaching low starts after high, and so does everything to the right.
+	// One side is enough at every level.
+	const Node* node = m_tree.m_root;
+	while (node)
+	{
+		if (!(high < node->Item.Low) && !(node->Item.High < low))
+		{
+			return true;
+		}
+
+		node = node->Left && !(MaxHigh(node->Left) < low) ? node->Left : node->Right;
+	}
+
+	return false;
+}
+
+template<typename T, typename Allocator>
+inline bool IntervalTree<T, Allocator>::Contains(const T& low, const T& high) const
+{
+	return m_tree.Contains(value_type{ low, high });
+}
+
+template<typename T, typename Allocator>
+inline bool IntervalTree<T, Allocator>::Empty() const
+{
+	return m_tree.Empty();
+}
+
+template<typename T, typename Allocator>
+inline size_t IntervalTree<T, Allocator>::Size() const
+{
+	return m_tree.Size();
+}
+
+template<typename T, typename Allocator>
+inline size_t IntervalTree<T, Allocator>::MemoryUsage() const
+{
+	return m_tree.MemoryUsage();
+}
+
+template<typename T, typename Allocator>
+inline typename IntervalTree<T, Allocator>::const_iterator IntervalTree<T, Allocator>::begin() const
+{
+	return m_tree.begin();
+}
+
+template<typename T, typename Allocator>
+inline typename IntervalTree<T, Allocator>::const_iterator IntervalTree<T, Allocator>::end() const
+{
+	return m_tree.end();
+}
+
+template<typename T, typename Allocator>
+inline const T& IntervalTree<T, Allocator>::MaxHigh(const Node* node)
+{
+	return node->Aggregate;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DEBUG FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef ENABLE_FORCED_CHECKS
+template <typename T, typename Allocator>
+inline bool ForceCheckInvariants(const IntervalTree<T, Allocator>& tree)
+{
+	return ForceCheckInvariants(tree.m_tree);
+}
+
+template <typename T, typename Allocator>
+inline bool ForceCheckContent(const IntervalTree<T, Allocator>& tree)
+{
+	return ForceCheckContent(tree.m_tree);
+}
+#endif
+
+#endif
@@ -0,0 +1,587 @@
+#ifndef _PERSISTENT_NODE_H
+#define _PERSISTENT_NODE_H
+
+#include "RedBlackTree.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// PERSISTENT NODE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Node of a left-leaning red-black tree whose published versions are never
+// modified. Insert and Delete work like the ones of RedBlackTree, but every
+// node is handed to an owner before it is changed, and the owner returns a
+// node that may be written to, copying it if some published version can still
+// reach it. Only the O(log n) nodes on the way and their siblings are copied,
+// the rest is shared between the versions.
+//
+// The owner decides through the stamp every node carries whether a node is
+// private to the current change, and has to provide:
+//   Node* Own     (Node* node);    - a writable node with the same content
+//   Node* Create  (const T& item); - a new red leaf
+//   void  Discard (Node* node);    - drops a writable node unlinked from the tree
+template <typename T, typename StampType>
+struct PersistentNode
+{
+	static constexpr size_t MaxHeight = LeftLeaningNode<PersistentNode>::MaxHeight;
+	static constexpr size_t BlackBit = LeftLeaningNode<PersistentNode>::BlackBit;
+
+	PersistentNode(const T& item, size_t sizeAndColour, PersistentNode* left, PersistentNode* right, size_t stamp)
+		: Item(item), SizeAndColour(sizeAndColour), Left(left), Right(right), Stamp(stamp)
+	{}
+
+	T                          Item;
+	size_t                     SizeAndColour;
+	PersistentNode*            Left;
+	PersistentNode*            Right;
+	StampType                  Stamp;
+
+	size_t LeftSize() const { return SizeAndColour & ~BlackBit; }
+	void   AddLeftSize      (size_t count) { SizeAndColour += count; }
+	void   SubtractLeftSize (size_t count) { SizeAndColour -= count; }
+
+	bool IsBlack() const { return SizeAndColour & BlackBit; }
+	bool IsRed()   const { return !IsBlack(); }
+
+	void SetBlack(bool black) { SizeAndColour = black ? SizeAndColour | BlackBit : SizeAndColour & ~BlackBit; }
+	void FlipColour() { SizeAndColour ^= BlackBit; }
+
+	bool IsLeftBlack() const { return !Left || Left->IsBlack(); }
+	bool IsLeftRed()   const { return Left && Left->IsRed(); }
+
+	bool IsRightBlack() const { return !Right || Right->IsBlack(); }
+	bool IsRightRed()   const { return Right && Right->IsRed(); }
+
+	// All of the modifying functions expect the node passed in to be
+	// writable already and make writable whatever else they touch.
+	template <typename Owner>
+	static void     MoveRedUp    (Owner& owner, PersistentNode* node);
+	template <typename Owner>
+	static void     SwitchColours(Owner& owner, PersistentNode* node);
+	template <typename Owner>
+	static void     Fixup        (Owner& owner, PersistentNode*& node);
+	template <typename Owner>
+	static void     RotateLeft   (Owner& owner, PersistentNode*& node);
+	template <typename Owner>
+	static void     RotateRight  (Owner& owner, PersistentNode*& node);
+	template <typename Owner>
+	static void     MoveRedLeft  (Owner& owner, PersistentNode*& node);
+	template <typename Owner>
+	static void     MoveRedRight (Owner& owner, PersistentNode*& node);
+
+	template <typename Owner, typename Compare>
+	static bool     Insert       (Owner& owner, PersistentNode*& root, const T& item, const Compare& compare);
+	template <typename Owner, typename K, typename Compare>
+	static bool     Delete       (Owner& owner, PersistentNode*& root, const K& item, const Compare& compare);
+
+	template <typename K, typename Compare>
+	static const PersistentNode* Find (const PersistentNode* node, const K& item, const Compare& compare, size_t& index);
+	static const PersistentNode* At   (const PersistentNode* node, size_t index);
+	static size_t   Size         (const PersistentNode* node);
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+	static bool     CheckInvariants (const PersistentNode* root);
+#endif
+#ifdef PROVIDE_DATA_STRUCTURE
+	template <typename Compare>
+	static bool     CheckContent (const PersistentNode* root, const Compare& compare, size_t size);
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// PERSISTENT NODE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename T, typename StampType>
+template <typename Owner>
+inline void PersistentNode<T, StampType>::MoveRedUp (Owner& owner, PersistentNode* node)
+{
+	if (node->IsLeftRed() && node->IsRightRed())
+	{
+		SwitchColours(owner, node);
+	}
+}
+
+template <typename T, typename StampType>
+template <typename Owner>
+inline void PersistentNode<T, StampType>::SwitchColours (Owner& owner, PersistentNode* node)
+{
+	// The colours of both children change, so the sibling off the path has
+	// to be copied as well.
+	if (node->Left)
+	{
+		node->Left = owner.Own(node->Left);
+		node->Left->FlipColour();
+	}
+
+	if (node->Right)
+	{
+		node->Right = owner.Own(node->Right);
+		node->Right->FlipColour();
+	}
+
+	node->FlipColour();
+}
+
+template <typename T, typename StampType>
+template <typename Owner>
+inline void PersistentNode<T, StampType>::Fixup (Owner& owner, PersistentNode*& node)
+{
+	if (node->IsRightRed() && node->IsLeftBlack())
+	{
+		RotateLeft(owner, node);
+	}
+
+	if (node->IsLeftRed() && node->Left->IsLeftRed())
+	{
+		RotateRight(owner, node);
+	}
+
+	MoveRedUp(owner, node);
+}
+
+template <typename T, typename StampType>
+template <typename Owner>
+inline void PersistentNode<T, StampType>::RotateLeft (Owner& owner, PersistentNode*& node)
+{
+	PersistentNode* newTop = owner.Own(node->Right);
+
+	node->Right = newTop->Left;
+	newTop->Left = node;
+
+	bool colourTemp = node->IsBlack();
+	node->SetBlack(newTop->IsBlack());
+	newTop->SetBlack(colourTemp);
+
+	newTop->AddLeftSize(node->LeftSize() + 1);
+
+	node = newTop;
+}
+
+template <typename T, typename StampType>
+template <typename Owner>
+inline void PersistentNode<T, StampType>::RotateRight (Owner& owner, PersistentNode*& node)
+{
+	PersistentNode* newTop = owner.Own(node->Left);
+
+	node->Left = newTop->Right;
+	newTop->Right = node;
+
+	bool colourTemp = node->IsBlack();
+	node->SetBlack(newTop->IsBlack());
+	newTop->SetBlack(colourTemp);
+
+	node->SubtractLeftSize(newTop->LeftSize() + 1);
+
+	node = newTop;
+}
+
+template <typename T, typename StampType>
+template <typename Owner>
+inline void PersistentNode<T, StampType>::MoveRedLeft (Owner& owner, PersistentNode*& node)
+{
+	SwitchColours(owner, node);
+	if (node->Right && node->Right->IsLeftRed())
+	{
+		RotateRight(owner, node->Right);
+		RotateLeft(owner, node);
+		SwitchColours(owner, node);
+	}
+}
+
+template <typename T, typename StampType>
+template <typename Owner>
+inline void PersistentNode<T, StampType>::MoveRedRight (Owner& owner, PersistentNode*& node)
+{
+	SwitchColours(owner, node);
+	if (node->Left && node->Left->IsLeftRed())
+	{
+		RotateRight(owner, node);
+		SwitchColours(owner, node);
+	}
+}
+
+template <typename T, typename StampType>
+template <typename Owner, typename Compare>
+inline bool PersistentNode<T, StampType>::Insert (Owner& owner, PersistentNode*& root, const T& item, const Compare& compare)
+{
+	// Search first, so that nothing is copied when the item is present
+	bool   wentLeft[MaxHeight];
+	size_t depth = 0;
+	for (const PersistentNode* node = root; node;)
+	{
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order == 0)
+		{
+			return false;
+		}
+
+		wentLeft[depth++] = order < 0;
+		node = order < 0 ? node->Left : node->Right;
+	}
+
+	// Then make the whole path writable, every node on it changes size
+	PersistentNode** path[MaxHeight + 1];
+	PersistentNode** link = &root;
+	for (size_t level = 0; level < depth; ++level)
+	{
+		*link = owner.Own(*link);
+		path[level] = link;
+		link = wentLeft[level] ? &(*link)->Left : &(*link)->Right;
+	}
+
+	*link = owner.Create(item);
+	path[depth] = link;
+
+	// Same as RedBlackTree::Node::Insert from here on
+	bool balanced = false;
+	while (depth > 0)
+	{
+		PersistentNode* child = *path[depth];
+		PersistentNode* node = *path[--depth];
+
+		if (wentLeft[depth])
+		{
+			node->AddLeftSize(1);
+		}
+
+		if (!balanced)
+		{
+			if (child->IsBlack())
+			{
+				balanced = true;
+			}
+			else
+			{
+				Fixup(owner, node);
+				*path[depth] = node;
+			}
+		}
+	}
+
+	return true;
+}
+
+template <typename T, typename StampType>
+template <typename Owner, typename K, typename Compare>
+inline bool PersistentNode<T, StampType>::Delete (Owner& owner, PersistentNode*& root, const K& item, const Compare& compare)
+{
+	// The restructuring on the way down would copy nodes even for a missing
+	// item, so make sure there is something to delete first.
+	size_t index;
+	if (!Find(root, item, compare, index))
+	{
+		return false;
+	}
+
+	PersistentNode** path[MaxHeight];
+	bool   wentLeft[MaxHeight];
+	size_t depth = 0;
+
+	size_t firstModified = MaxHeight;
+	auto markModified = [&]() { if (firstModified == MaxHeight) firstModified = depth; };
+
+	bool deleted = false;
+
+	// The same top-down pass as RedBlackTree::Node::Delete, making each node
+	// writable when it is reached.
+	PersistentNode** link = &root;
+	while (*link)
+	{
+		PersistentNode* node = *link = owner.Own(*link);
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order < 0)
+		{
+			if (node->Left && node->Left->IsBlack() && node->Left->IsLeftBlack())
+			{
+				MoveRedLeft(owner, *link);
+				markModified();
+			}
+
+			path[depth] = link;
+			wentLeft[depth++] = true;
+			link = &(*link)->Left;
+			continue;
+		}
+
+		bool equal = order == 0;
+		if (node->IsLeftRed())
+		{
+			RotateRight(owner, *link);
+			markModified();
+			node = *link;
+			equal = false;
+		}
+
+		if (equal && !node->Right)
+		{
+			owner.Discard(node);
+			*link = nullptr;
+			deleted = true;
+			break;
+		}
+
+		if (node->IsRightBlack() && node->Right && node->Right->IsLeftBlack())
+		{
+			MoveRedRight(owner, *link);
+			markModified();
+			if (*link != node)
+			{
+				node = *link;
+				equal = false;
+			}
+		}
+
+		path[depth] = link;
+		wentLeft[depth++] = false;
+		link = &node->Right;
+
+		if (equal)
+		{
+			size_t targetDepth = depth - 1;
+			PersistentNode* rightMin;
+			while (true)
+			{
+				*link = owner.Own(*link);
+				if ((*link)->IsLeftBlack() && (*link)->Left && (*link)->Left->IsLeftBlack())
+				{
+					MoveRedLeft(owner, *link);
+					markModified();
+				}
+
+				rightMin = *link;
+				if (!rightMin->Left)
+				{
+					*link = nullptr;
+					break;
+				}
+
+				path[depth] = link;
+				wentLeft[depth++] = true;
+				link = &rightMin->Left;
+			}
+
+			PersistentNode* target = *path[targetDepth];
+			rightMin->Left = target->Left;
+			rightMin->Right = target->Right;
+			rightMin->SizeAndColour = target->SizeAndColour;
+			*path[targetDepth] = rightMin;
+			if (targetDepth + 1 < depth)
+			{
+				path[targetDepth + 1] = &rightMin->Right;
+			}
+
+			owner.Discard(target);
+			deleted = true;
+			break;
+		}
+	}
+
+	bool balanced = false;
+	while (depth > 0)
+	{
+		PersistentNode* node = *path[--depth];
+
+		if (deleted && wentLeft[depth])
+		{
+			node->SubtractLeftSize(1);
+		}
+
+		if (!balanced)
+		{
+			PersistentNode* child = wentLeft[depth] ? node->Left : node->Right;
+			if (depth < firstModified && (!child || child->IsBlack()))
+			{
+				balanced = true;
+			}
+			else
+			{
+				Fixup(owner, node);
+				*path[depth] = node;
+			}
+		}
+	}
+
+	return deleted;
+}
+
+template <typename T, typename StampType>
+template <typename K, typename Compare>
+inline const PersistentNode<T, StampType>* PersistentNode<T, StampType>::Find (const PersistentNode* node, const K& item, const Compare& compare, size_t& index)
+{
+	index = 0;
+	while (node)
+	{
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order == 0)
+		{
+			index += node->LeftSize();
+			return node;
+		}
+
+		if (order < 0)
+		{
+			node = node->Left;
+		}
+		else
+		{
+			index += node->LeftSize() + 1;
+			node = node->Right;
+		}
+	}
+
+	index = (size_t)-1;
+	return nullptr;
+}
+
+template <typename T, typename StampType>
+inline const PersistentNode<T, StampType>* PersistentNode<T, StampType>::At (const PersistentNode* node, size_t index)
+{
+	while (node)
+	{
+		if (node->LeftSize() == index)
+		{
+			return node;
+		}
+
+		if (index < node->LeftSize())
+		{
+			node = node->Left;
+		}
+		else
+		{
+			index -= node->LeftSize() + 1;
+			node = node->Right;
+		}
+	}
+
+	return nullptr;
+}
+
+template <typename T, typename StampType>
+inline size_t PersistentNode<T, StampType>::Size (const PersistentNode* node)
+{
+	// A version carries no size of its own, but the right spine adds it up
+	size_t size = 0;
+	for (; node; node = node->Right)
+	{
+		size += node->LeftSize() + 1;
+	}
+
+	return size;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DEBUG FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+template <typename T, typename StampType>
+inline bool PersistentNode<T, StampType>::CheckInvariants (const PersistentNode* root)
+{
+	struct StackFrame
+	{
+		const PersistentNode* node;
+		size_t blackDepth;
+	};
+
+	size_t blackDepth = (size_t)-1;
+	std::vector<StackFrame> stack;
+	if (root)
+	{
+		stack.push_back({ root, 0 });
+	}
+
+	while (!stack.empty())
+	{
+		StackFrame currentFrame = stack.back();
+		const PersistentNode* currentNode = currentFrame.node;
+		stack.pop_back();
+
+		if (currentNode != root && currentNode->IsRed() && (currentNode->IsLeftRed() || currentNode->IsRightRed()))
+		{
+			printf("Found two neighbouring red edges!\n");
+			return false;
+		}
+
+		if (currentNode->IsLeftBlack() && currentNode->IsRightRed())
+		{
+			printf("Found a single red edge going right!\n");
+			return false;
+		}
+
+		if (!currentNode->Left || !currentNode->Right)
+		{
+			if (blackDepth == (size_t)-1)
+			{
+				blackDepth = currentFrame.blackDepth;
+			}
+			else if (currentFrame.blackDepth != blackDepth)
+			{
+				printf("Found two paths from root to leaf with different black node counts!\n");
+				return false;
+			}
+		}
+
+		if (currentNode->Left)
+		{
+			stack.push_back({ currentNode->Left, currentFrame.blackDepth + currentNode->Left->IsBlack() });
+		}
+
+		if (currentNode->Right)
+		{
+			stack.push_back({ currentNode->Right, currentFrame.blackDepth + currentNode->Right->IsBlack() });
+		}
+	}
+
+	return true;
+}
+#endif
+
+#ifdef PROVIDE_DATA_STRUCTURE
+template <typename T, typename StampType>
+template <typename Compare>
+inline bool PersistentNode<T, StampType>::CheckContent (const PersistentNode* root, const Compare& compare, size_t size)
+{
+	// In-order walk, checking the order of the items and every left size
+	std::vector<std::pair<const PersistentNode*, size_t>> stack;
+	const PersistentNode* previous = nullptr;
+	size_t count = 0;
+
+	for (const PersistentNode* node = root; node || !stack.empty();)
+	{
+		for (; node; node = node->Left)
+		{
+			stack.emplace_back(node, count);
+		}
+
+		auto [current, countBefore] = stack.back();
+		stack.pop_back();
+
+		if (count - countBefore != current->LeftSize())
+		{
+			printf("Found a node with left subtree size not matching its left subtree!\n");
+			return false;
+		}
+
+		if (previous && !CompareLess(compare, previous->Item, current->Item))
+		{
+			printf("Found items out of order at index: %d\n", (int)count);
+			return false;
+		}
+
+		previous = current;
+		++count;
+		node = current->Right;
+	}
+
+	if (count != size || count != Size(root))
+	{
+		printf("Tree size different from the count of items!\n");
+		return false;
+	}
+
+	return true;
+}
+#endif
+
+#endif
@@ -0,0 +1,452 @@
+#ifndef _PERSISTENT_RED_BLACK_TREE_H
+#define _PERSISTENT_RED_BLACK_TREE_H
+
+#include <atomic>
+
+#include "PersistentNode.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// PERSISTENT RED BLACK TREE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Red-black tree whose copies share all of their nodes. Nodes are reference
+// counted, and Insert and Delete copy just the O(log n) nodes they change if
+// those are shared with another tree, so taking a snapshot is O(1) and
+// modifying either side later leaves the other one untouched.
+//
+// Like any standard container, a single tree may be read from any number of
+// threads, but not modified while doing so. Different trees sharing nodes may
+// be used from different threads freely, as shared nodes are never modified.
+template <typename T, Comparator<T> Compare = DefaultCompare<T>, typename Allocator = std::allocator<T>>
+class PersistentRedBlackTree
+{
+	// The stamp counts the trees and nodes pointing at a node. A node only
+	// this tree can reach has a count of one and can be changed in place.
+	using Node = PersistentNode<T, std::atomic<size_t>>;
+	using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+	using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+	struct Owner
+	{
+		PersistentRedBlackTree& Tree;
+
+		Node* Own     (Node* node);
+		Node* Create  (const T& item);
+		void  Discard (Node* node);
+	};
+public:
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = T;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const T*;
+		using reference         = const T&;
+
+		          Iterator   ();
+		          Iterator   (const Iterator& other);
+		Iterator& operator=  (const Iterator& other);
+
+		reference operator*  () const;
+		pointer   operator-> () const;
+
+		Iterator& operator++ ();
+		Iterator  operator++ (int);
+
+		bool      operator== (const Iterator& other) const;
+
+		size_t    Index      () const;
+	private:
+		friend class PersistentRedBlackTree;
+
+		void      PushLeftSpine (const Node* node);
+
+		size_t                      m_index;
+		size_t                      m_depth;
+		const Node*                 m_path[Node::MaxHeight];
+	};
+
+	using value_type             = T;
+	using size_type              = size_t;
+	using iterator               = Iterator;
+	using const_iterator         = Iterator;
+
+			 PersistentRedBlackTree ();
+	explicit PersistentRedBlackTree (const Compare& compare, const Allocator& allocator = Allocator());
+			 PersistentRedBlackTree (const PersistentRedBlackTree& other);
+			 PersistentRedBlackTree (PersistentRedBlackTree&& other) noexcept;
+	PersistentRedBlackTree& operator= (const PersistentRedBlackTree& other);
+	PersistentRedBlackTree& operator= (PersistentRedBlackTree&& other) noexcept;
+			 ~PersistentRedBlackTree();
+
+	bool     Insert       (const T& item);
+	bool     Delete       (const T& item);
+	void     Clear        ();
+
+	PersistentRedBlackTree Snapshot () const;
+
+	std::pair<size_t, std::reference_wrapper<const T>> Find (const T& item) const;
+	const T& At           (size_t index)  const;
+	bool     Contains     (const T& item) const;
+
+	bool     Empty        () const;
+	size_t   Size         () const;
+
+	Iterator begin        () const;
+	Iterator end          () const;
+private:
+	void     Release      (Node* node);
+
+	[[no_unique_address]] Compare m_compare;
+	[[no_unique_address]] NodeAllocator m_allocator;
+	Node*                       m_root;
+	size_t                      m_treeSize;
+
+	inline static T s_default;
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckInvariants(const PersistentRedBlackTree<U, C, A>& tree);
+#endif
+#ifdef PROVIDE_DATA_STRUCTURE
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckContent(const PersistentRedBlackTree<U, C, A>& tree);
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// PERSISTENT RED BLACK TREE::OWNER MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Node* PersistentRedBlackTree<T, Compare, Allocator>::Owner::Own(Node* node)
+{
+	// Nobody else can reach a node counted once, so nobody else can start
+	// sharing it while it is being changed either.
+	if (node->Stamp.load(std::memory_order_acquire) == 1)
+	{
+		return node;
+	}
+
+	Node* copy = Create(node->Item);
+	copy->SizeAndColour = node->SizeAndColour;
+	copy->Left = node->Left;
+	copy->Right = node->Right;
+	if (copy->Left)
+	{
+		copy->Left->Stamp.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (copy->Right)
+	{
+		copy->Right->Stamp.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Tree.Release(node);
+	return copy;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Node* PersistentRedBlackTree<T, Compare, Allocator>::Owner::Create(const T& item)
+{
+	Node* node = NodeTraits::allocate(Tree.m_allocator, 1);
+	try
+	{
+		NodeTraits::construct(Tree.m_allocator, node, item, 0, nullptr, nullptr, 1);
+	}
+	catch (...)
+	{
+		NodeTraits::deallocate(Tree.m_allocator, node, 1);
+		throw;
+	}
+
+	return node;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void PersistentRedBlackTree<T, Compare, Allocator>::Owner::Discard(Node* node)
+{
+	// The children of a discarded node have been linked elsewhere already
+	NodeTraits::destroy(Tree.m_allocator, node);
+	NodeTraits::deallocate(Tree.m_allocator, node, 1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// PERSISTENT RED BLACK TREE::ITERATOR MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>::Iterator::Iterator()
+	: m_index(0), m_depth(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>::Iterator::Iterator(const Iterator& other)
+	: m_index(other.m_index), m_depth(other.m_depth)
+{
+	std::copy(other.m_path, other.m_path + other.m_depth, m_path);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Iterator& PersistentRedBlackTree<T, Compare, Allocator>::Iterator::operator=(const Iterator& other)
+{
+	m_index = other.m_index;
+	m_depth = other.m_depth;
+	std::copy(other.m_path, other.m_path + other.m_depth, m_path);
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Iterator::reference PersistentRedBlackTree<T, Compare, Allocator>::Iterator::operator*() const
+{
+	return m_path[m_depth - 1]->Item;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Iterator::pointer PersistentRedBlackTree<T, Compare, Allocator>::Iterator::operator->() const
+{
+	return &m_path[m_depth - 1]->Item;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Iterator& PersistentRedBlackTree<T, Compare, Allocator>::Iterator::operator++()
+{
+	const Node* node = m_path[m_depth - 1];
+	if (node->Right)
+	{
+		PushLeftSpine(node->Right);
+	}
+	else
+	{
+		const Node* child;
+		do
+		{
+			child = m_path[--m_depth];
+		} while (m_depth > 0 && m_path[m_depth - 1]->Right == child);
+	}
+
+	++m_index;
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Iterator PersistentRedBlackTree<T, Compare, Allocator>::Iterator::operator++(int)
+{
+	Iterator previous = *this;
+	++*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool PersistentRedBlackTree<T, Compare, Allocator>::Iterator::operator==(const Iterator& other) const
+{
+	const Node* current = m_depth ? m_path[m_depth - 1] : nullptr;
+	const Node* otherCurrent = other.m_depth ? other.m_path[other.m_depth - 1] : nullptr;
+	return current == otherCurrent;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t PersistentRedBlackTree<T, Compare, Allocator>::Iterator::Index() const
+{
+	return m_index;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void PersistentRedBlackTree<T, Compare, Allocator>::Iterator::PushLeftSpine(const Node* node)
+{
+	for (; node; node = node->Left)
+	{
+		m_path[m_depth++] = node;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// PERSISTENT RED BLACK TREE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>::PersistentRedBlackTree()
+	: m_compare(), m_allocator(), m_root(nullptr), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>::PersistentRedBlackTree(const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_allocator(allocator), m_root(nullptr), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>::PersistentRedBlackTree(const PersistentRedBlackTree& other)
+	: m_compare(other.m_compare), m_allocator(other.m_allocator), m_root(other.m_root), m_treeSize(other.m_treeSize)
+{
+	if (m_root)
+	{
+		m_root->Stamp.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>::PersistentRedBlackTree(PersistentRedBlackTree&& other) noexcept
+	: m_compare(std::move(other.m_compare)), m_allocator(std::move(other.m_allocator)), m_root(std::exchange(other.m_root, nullptr)), m_treeSize(std::exchange(other.m_treeSize, 0))
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>& PersistentRedBlackTree<T, Compare, Allocator>::operator=(const PersistentRedBlackTree& other)
+{
+	if (this != &other)
+	{
+		PersistentRedBlackTree copy(other);
+		*this = std::move(copy);
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>& PersistentRedBlackTree<T, Compare, Allocator>::operator=(PersistentRedBlackTree&& other) noexcept
+{
+	if (this != &other)
+	{
+		Clear();
+		m_compare = std::move(other.m_compare);
+		m_allocator = std::move(other.m_allocator);
+		m_root = std::exchange(other.m_root, nullptr);
+		m_treeSize = std::exchange(other.m_treeSize, 0);
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator>::~PersistentRedBlackTree()
+{
+	Clear();
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool PersistentRedBlackTree<T, Compare, Allocator>::Insert(const T& item)
+{
+	Owner owner{ *this };
+	bool inserted = Node::Insert(owner, m_root, item, m_compare);
+	m_treeSize += inserted;
+	return inserted;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool PersistentRedBlackTree<T, Compare, Allocator>::Delete(const T& item)
+{
+	Owner owner{ *this };
+	bool deleted = Node::Delete(owner, m_root, item, m_compare);
+	m_treeSize -= deleted;
+	return deleted;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void PersistentRedBlackTree<T, Compare, Allocator>::Clear()
+{
+	Release(std::exchange(m_root, nullptr));
+	m_treeSize = 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline PersistentRedBlackTree<T, Compare, Allocator> PersistentRedBlackTree<T, Compare, Allocator>::Snapshot() const
+{
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::pair<size_t, std::reference_wrapper<const T>> PersistentRedBlackTree<T, Compare, Allocator>::Find(const T& item) const
+{
+	size_t index;
+	const Node* node = Node::Find(m_root, item, m_compare, index);
+	return std::make_pair(index, std::cref(node ? node->Item : s_default));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline const T& PersistentRedBlackTree<T, Compare, Allocator>::At(size_t index) const
+{
+	const Node* node = Node::At(m_root, index);
+	return node ? node->Item : s_default;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool PersistentRedBlackTree<T, Compare, Allocator>::Contains(const T& item) const
+{
+	size_t index;
+	return Node::Find(m_root, item, m_compare, index) != nullptr;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool PersistentRedBlackTree<T, Compare, Allocator>::Empty() const
+{
+	return m_treeSize == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t PersistentRedBlackTree<T, Compare, Allocator>::Size() const
+{
+	return m_treeSize;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Iterator PersistentRedBlackTree<T, Compare, Allocator>::begin() const
+{
+	Iterator iterator;
+	iterator.PushLeftSpine(m_root);
+	return iterator;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename PersistentRedBlackTree<T, Compare, Allocator>::Iterator PersistentRedBlackTree<T, Compare, Allocator>::end() const
+{
+	Iterator iterator;
+	iterator.m_index = m_treeSize;
+	return iterator;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void PersistentRedBlackTree<T, Compare, Allocator>::Release(Node* node)
+{
+	// Freeing a node releases its children in turn. Nodes still pending are
+	// at most one per level plus the two children just added.
+	Node*  pending[Node::MaxHeight + 2];
+	size_t count = 0;
+
+	auto release = [&](Node* released)
+	{
+		if (released && released->Stamp.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			pending[count++] = released;
+		}
+	};
+
+	release(node);
+	while (count > 0)
+	{
+		Node* freed = pending[--count];
+		release(freed->Left);
+		release(freed->Right);
+		NodeTraits::destroy(m_allocator, freed);
+		NodeTraits::deallocate(m_allocator, freed, 1);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DEBUG FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckInvariants(const PersistentRedBlackTree<T, Compare, Allocator>& tree)
+{
+	return PersistentRedBlackTree<T, Compare, Allocator>::Node::CheckInvariants(tree.m_root);
+}
+#endif
+
+#ifdef PROVIDE_DATA_STRUCTURE
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckContent(const PersistentRedBlackTree<T, Compare, Allocator>& tree)
+{
+	return PersistentRedBlackTree<T, Compare, Allocator>::Node::CheckContent(tree.m_root, tree.m_compare, tree.m_treeSize);
+}
+#endif
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef _RCU_RED_BLACK_TREE_H
+#define _RCU_RED_BLACK_TREE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "PersistentNode.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// RCU RED BLACK TREE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Red-black tree for many concurrent readers and one writer at a time.
+//
+// Writers never modify a node a reader may see. They copy the nodes they
+// change, publish the new root through an atomic pointer and retire the
+// replaced nodes, which are only freed once no reader can hold them any more
+// (epoch-based reclamation). Readers take no locks and perform no atomic
+// read-modify-write operations; each one announces the epoch it started in
+// through a slot on a cache line of its own.
+template <typename T, Comparator<T> Compare = DefaultCompare<T>, typename Allocator = std::allocator<T>>
+class RcuRedBlackTree
+{
+	static constexpr size_t   CacheLineSize = 64;
+	static constexpr uint64_t Idle = std::numeric_limits<uint64_t>::max();
+
+	// The stamp is the epoch a node was created in, nodes of the current
+	// epoch are not published yet and can be changed in place.
+	using Node = PersistentNode<T, uint64_t>;
+	using Pool = NodePool<Node, typename std::allocator_traits<Allocator>::template rebind_alloc<Node>>;
+
+	struct Owner
+	{
+		RcuRedBlackTree& Tree;
+		uint64_t         Epoch;
+
+		Node* Own     (Node* node);
+		Node* Create  (const T& item);
+		void  Discard (Node* node);
+	};
+
+	struct alignas(CacheLineSize) ReaderSlot
+	{
+		std::atomic<uint64_t>  Epoch{ Idle };
+		std::atomic<bool>      Claimed{ true };
+		ReaderSlot*            Next = nullptr;
+	};
+public:
+	// A reader registers with the tree once and can then be used for any
+	// number of lookups from its thread. Items are returned by value, as the
+	// nodes may be reclaimed as soon as the lookup returns.
+	class Reader
+	{
+	public:
+		explicit  Reader     (const RcuRedBlackTree& tree);
+		          Reader     (const Reader&) = delete;
+		Reader&   operator=  (const Reader&) = delete;
+		          ~Reader    ();
+
+		std::pair<size_t, T> Find (const T& item) const;
+		T         At         (size_t index)  const;
+		bool      Contains   (const T& item) const;
+		size_t    Size       () const;
+		bool      Empty      () const;
+	private:
+		const Node* Pin      () const;
+		void      Unpin      () const;
+
+		const RcuRedBlackTree*      m_tree;
+		ReaderSlot*                 m_slot;
+	};
+
+			 RcuRedBlackTree ();
+	explicit RcuRedBlackTree (const Compare& compare, const Allocator& allocator = Allocator());
+			 RcuRedBlackTree (const RcuRedBlackTree&) = delete;
+	RcuRedBlackTree& operator= (const RcuRedBlackTree&) = delete;
+			 ~RcuRedBlackTree();
+
+	bool     Insert       (const T& item);
+	bool     Delete       (const T& item);
+	void     Clear        ();
+
+	size_t   Size         () const;
+	bool     Empty        () const;
+private:
+	void     Publish      (Node* root);
+	void     Reclaim      ();
+	void     DestroyNodes ();
+
+	[[no_unique_address]] Compare m_compare;
+
+	// Read by every reader, written once per change
+	alignas(CacheLineSize) std::atomic<Node*> m_root;
+	std::atomic<uint64_t>       m_epoch;
+	mutable std::atomic<ReaderSlot*> m_readers;
+
+	// Only touched by the writer
+	alignas(CacheLineSize) std::mutex m_writeLock;
+	Pool                        m_pool;
+	std::vector<std::pair<uint64_t, Node*>> m_retired;
+	std::atomic<size_t>         m_treeSize;
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckInvariants(const RcuRedBlackTree<U, C, A>& tree);
+#endif
+#ifdef PROVIDE_DATA_STRUCTURE
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckContent(const RcuRedBlackTree<U, C, A>& tree);
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// RCU RED BLACK TREE::OWNER MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RcuRedBlackTree<T, Compare, Allocator>::Node* RcuRedBlackTree<T, Compare, Allocator>::Owner::Own(Node* node)
+{
+	if (node->Stamp == Epoch)
+	{
+		return node;
+	}
+
+	Node* copy = Tree.m_pool.Create(node->Item, node->SizeAndColour, node->Left, node->Right, Epoch);
+	Tree.m_retired.emplace_back(Epoch, node);
+	return copy;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RcuRedBlackTree<T, Compare, Allocator>::Node* RcuRedBlackTree<T, Compare, Allocator>::Owner::Create(const T& item)
+{
+	return Tree.m_pool.Create(item, 0, nullptr, nullptr, Epoch);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void RcuRedBlackTree<T, Compare, Allocator>::Owner::Discard(Node* node)
+{
+	// Writable nodes were never published, so nobody else can hold them
+	Tree.m_pool.Destroy(node);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// RCU RED BLACK TREE::READER MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RcuRedBlackTree<T, Compare, Allocator>::Reader::Reader(const RcuRedBlackTree& tree)
+	: m_tree(&tree), m_slot(nullptr)
+{
+	// Reuse the slot of a reader that is gone, or add a new one
+	for (ReaderSlot* slot = tree.m_readers.load(std::memory_order_acquire); slot; slot = slot->Next)
+	{
+		bool claimed = false;
+		if (!slot->Claimed.load(std::memory_order_relaxed) && slot->Claimed.compare_exchange_strong(claimed, true, std::memory_order_acquire))
+		{
+			m_slot = slot;
+			return;
+		}
+	}
+
+	m_slot = new ReaderSlot();
+	m_slot->Next = tree.m_readers.load(std::memory_order_relaxed);
+	while (!tree.m_readers.compare_exchange_weak(m_slot->Next, m_slot, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RcuRedBlackTree<T, Compare, Allocator>::Reader::~Reader()
+{
+	m_slot->Claimed.store(false, std::memory_order_release);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::pair<size_t, T> RcuRedBlackTree<T, Compare, Allocator>::Reader::Find(const T& item) const
+{
+	size_t index;
+	const Node* node = Node::Find(Pin(), item, m_tree->m_compare, index);
+	std::pair<size_t, T> result(index, node ? node->Item : T());
+	Unpin();
+	return result;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline T RcuRedBlackTree<T, Compare, Allocator>::Reader::At(size_t index) const
+{
+	const Node* node = Node::At(Pin(), index);
+	T result = node ? node->Item : T();
+	Unpin();
+	return result;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RcuRedBlackTree<T, Compare, Allocator>::Reader::Contains(const T& item) const
+{
+	size_t index;
+	bool result = Node::Find(Pin(), item, m_tree->m_compare, index) != nullptr;
+	Unpin();
+	return result;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RcuRedBlackTree<T, Compare, Allocator>::Reader::Size() const
+{
+	size_t result = Node::Size(Pin());
+	Unpin();
+	return result;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RcuRedBlackTree<T, Compare, Allocator>::Reader::Empty() const
+{
+	return Size() == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline const typename RcuRedBlackTree<T, Compare, Allocator>::Node* RcuRedBlackTree<T, Compare, Allocator>::Reader::Pin() const
+{
+	// Announce the epoch before loading the root. The fence pairs with the
+	// one in Publish: either the writer sees the announcement, or this reader
+	// sees the root published before the writer looked.
+	m_slot->Epoch.store(m_tree->m_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return m_tree->m_root.load(std::memory_order_acquire);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void RcuRedBlackTree<T, Compare, Allocator>::Reader::Unpin() const
+{
+	m_slot->Epoch.store(Idle, std::memory_order_release);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// RCU RED BLACK TREE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RcuRedBlackTree<T, Compare, Allocator>::RcuRedBlackTree()
+	: RcuRedBlackTree(Compare())
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RcuRedBlackTree<T, Compare, Allocator>::RcuRedBlackTree(const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_root(nullptr), m_epoch(1), m_readers(nullptr), m_pool(allocator), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RcuRedBlackTree<T, Compare, Allocator>::~RcuRedBlackTree()
+{
+	DestroyNodes();
+
+	for (ReaderSlot* slot = m_readers.load(std::memory_order_acquire); slot;)
+	{
+		delete std::exchange(slot, slot->Next);
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RcuRedBlackTree<T, Compare, Allocator>::Insert(const T& item)
+{
+	std::lock_guard<std::mutex> lock(m_writeLock);
+
+	Owner owner{ *this, m_epoch.load(std::memory_order_relaxed) };
+	Node* root = m_root.load(std::memory_order_relaxed);
+	if (!Node::Insert(owner, root, item, m_compare))
+	{
+		return false;
+	}
+
+	m_treeSize.fetch_add(1, std::memory_order_relaxed);
+	Publish(root);
+	return true;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RcuRedBlackTree<T, Compare, Allocator>::Delete(const T& item)
+{
+	std::lock_guard<std::mutex> lock(m_writeLock);
+
+	Owner owner{ *this, m_epoch.load(std::memory_order_relaxed) };
+	Node* root = m_root.load(std::memory_order_relaxed);
+	if (!Node::Delete(owner, root, item, m_compare))
+	{
+		return false;
+	}
+
+	m_treeSize.fetch_sub(1, std::memory_order_relaxed);
+	Publish(root);
+	return true;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void RcuRedBlackTree<T, Compare, Allocator>::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_writeLock);
+
+	uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+	std::vector<Node*> stack;
+	if (Node* root = m_root.load(std::memory_order_relaxed))
+	{
+		stack.push_back(root);
+	}
+
+	// Every node of the current version is retired as a whole
+	while (!stack.empty())
+	{
+		Node* node = stack.back();
+		stack.pop_back();
+		m_retired.emplace_back(epoch, node);
+
+		if (node->Left)
+		{
+			stack.push_back(node->Left);
+		}
+
+		if (node->Right)
+		{
+			stack.push_back(node->Right);
+		}
+	}
+
+	m_treeSize.store(0, std::memory_order_relaxed);
+	Publish(nullptr);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RcuRedBlackTree<T, Compare, Allocator>::Size() const
+{
+	return m_treeSize.load(std::memory_order_relaxed);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RcuRedBlackTree<T, Compare, Allocator>::Empty() const
+{
+	return Size() == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void RcuRedBlackTree<T, Compare, Allocator>::Publish(Node* root)
+{
+	// Nodes retired in this epoch may still be in use by readers which
+	// announced it, readers announcing the next one see the new root.
+	m_root.store(root, std::memory_order_release);
+	m_epoch.store(m_epoch.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	Reclaim();
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void RcuRedBlackTree<T, Compare, Allocator>::Reclaim()
+{
+	uint64_t oldestEpoch = Idle;
+	for (ReaderSlot* slot = m_readers.load(std::memory_order_acquire); slot; slot = slot->Next)
+	{
+		oldestEpoch = std::min(oldestEpoch, slot->Epoch.load(std::memory_order_acquire));
+	}
+
+	// Nodes are retired in epoch order
+	auto reclaimable = m_retired.begin();
+	for (; reclaimable != m_retired.end() && reclaimable->first < oldestEpoch; ++reclaimable)
+	{
+		m_pool.Destroy(reclaimable->second);
+	}
+
+	m_retired.erase(m_retired.begin(), reclaimable);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void RcuRedBlackTree<T, Compare, Allocator>::DestroyNodes()
+{
+	// No reader may be left at this point, so the current version can be
+	// taken apart in place, like RedBlackTree::Node::DestroyAll does.
+	if constexpr (!std::is_trivially_destructible_v<T>)
+	{
+		Node* node = m_root.load(std::memory_order_relaxed);
+		while (node)
+		{
+			if (node->Left)
+			{
+				Node* left = node->Left;
+				node->Left = left->Right;
+				left->Right = node;
+				node = left;
+			}
+			else
+			{
+				m_pool.Destroy(std::exchange(node, node->Right));
+			}
+		}
+
+		for (auto& [epoch, retired] : m_retired)
+		{
+			m_pool.Destroy(retired);
+		}
+	}
+
+	m_pool.Release();
+	m_retired.clear();
+	m_root.store(nullptr, std::memory_order_relaxed);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DEBUG FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckInvariants(const RcuRedBlackTree<T, Compare, Allocator>& tree)
+{
+	return RcuRedBlackTree<T, Compare, Allocator>::Node::CheckInvariants(tree.m_root.load(std::memory_order_acquire));
+}
+#endif
+
+#ifdef PROVIDE_DATA_STRUCTURE
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckContent(const RcuRedBlackTree<T, Compare, Allocator>& tree)
+{
+	return RcuRedBlackTree<T, Compare, Allocator>::Node::CheckContent(tree.m_root.load(std::memory_order_acquire), tree.m_compare, tree.Size());
+}
+#endif
+
+#endif
@@ -0,0 +1,436 @@
+#ifndef _RED_BLACK_MAP_H
+#define _RED_BLACK_MAP_H
+
+#include <tuple>
+
+#include "RedBlackTree.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// RED BLACK MAP DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Ordered map from keys to values, stored as a RedBlackTree of key-value
+// pairs ordered by the key alone. Keys are immutable once inserted, values
+// can be changed in place without touching the tree structure.
+template <typename K, typename V, Comparator<K> Compare = DefaultCompare<K>, typename Allocator = std::allocator<std::pair<const K, V>>>
+class RedBlackMap
+{
+public:
+	using key_type    = K;
+	using mapped_type = V;
+	using value_type  = std::pair<const K, V>;
+private:
+	// Orders the pairs by their keys and lets the tree look them up by key.
+	// The result is whatever the key comparator returns, so three-way
+	// comparators still cost a single call per level.
+	struct KeyCompare
+	{
+		using is_transparent = void;
+
+		static const K& KeyOf (const value_type& entry) { return entry.first; }
+		template <typename A>
+		static const A& KeyOf (const A& key) { return key; }
+
+		template <typename A, typename B>
+		auto operator() (const A& a, const B& b) const -> decltype(std::declval<const Compare&>()(KeyOf(a), KeyOf(b)))
+		{
+			return Base(KeyOf(a), KeyOf(b));
+		}
+
+		[[no_unique_address]] Compare Base;
+	};
+
+	using Tree = RedBlackTree<value_type, KeyCompare, Allocator>;
+public:
+	// Iterates the pairs in key order with mutable access to the values
+	class Iterator
+	{
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type        = RedBlackMap::value_type;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = value_type*;
+		using reference         = value_type&;
+
+		          Iterator   () = default;
+
+		reference operator*  () const;
+		pointer   operator-> () const;
+
+		Iterator& operator++ ();
+		Iterator  operator++ (int);
+		Iterator& operator-- ();
+		Iterator  operator-- (int);
+
+		bool      operator== (const Iterator& other) const;
+
+		size_t    Index      () const;
+	private:
+		friend class RedBlackMap;
+
+		explicit  Iterator   (const typename Tree::Iterator& iterator);
+
+		typename Tree::Iterator     m_iterator;
+	};
+
+	using size_type              = size_t;
+	using iterator               = Iterator;
+	using const_iterator         = typename Tree::Iterator;
+
+			 RedBlackMap  ();
+	explicit RedBlackMap  (const Allocator& allocator);
+	explicit RedBlackMap  (const Compare& compare, const Allocator& allocator = Allocator());
+
+	V&       operator[]   (const K& key);
+	V&       operator[]   (K&& key);
+	template <typename... Args>
+	std::pair<std::reference_wrapper<V>, bool> TryEmplace (const K& key, Args&&... args);
+	template <typename... Args>
+	std::pair<std::reference_wrapper<V>, bool> TryEmplace (K&& key, Args&&... args);
+	template <typename M>
+	bool     InsertOrAssign (const K& key, M&& value);
+	template <typename M>
+	bool     InsertOrAssign (K&& key, M&& value);
+	bool     Delete       (const K& key);
+	template <HeterogeneousKey<K, Compare> Key>
+	bool     Delete       (const Key& key);
+	bool     DeleteAt     (size_t index);
+	void     Clear        ();
+
+	std::pair<size_t, V*> Find (const K& key);
+	std::pair<size_t, const V*> Find (const K& key) const;
+	template <HeterogeneousKey<K, Compare> Key>
+	std::pair<size_t, V*> Find (const Key& key);
+	template <HeterogeneousKey<K, Compare> Key>
+	std::pair<size_t, const V*> Find (const Key& key) const;
+	const value_type& At  (size_t index) const;
+	bool     Contains     (const K& key) const;
+	template <HeterogeneousKey<K, Compare> Key>
+	bool     Contains     (const Key& key) const;
+
+	bool     Empty        () const;
+	size_t   Size         () const;
+	size_t   MemoryUsage  () const;
+
+	Iterator begin        ();
+	Iterator end          ();
+	const_iterator begin  () const;
+	const_iterator end    () const;
+private:
+	template <typename Key, typename... Args>
+	std::pair<std::reference_wrapper<V>, bool> Emplace (Key&& key, Args&&... args);
+	template <typename Key, typename M>
+	bool     Assign       (Key&& key, M&& value);
+	template <typename Key>
+	std::pair<size_t, V*> FindValue (const Key& key) const;
+
+	Tree                        m_tree;
+
+#ifdef ENABLE_FORCED_CHECKS
+	template <typename U, typename W, Comparator<U> C, typename A> friend bool ForceCheckInvariants(const RedBlackMap<U, W, C, A>& map);
+	template <typename U, typename W, Comparator<U> C, typename A> friend bool ForceCheckContent(const RedBlackMap<U, W, C, A>& map);
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// RED BLACK MAP::ITERATOR MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+// The pairs live in nodes the map owns and are never const objects, only the
+// tree hands them out as const so the keys cannot be changed. The values can
+// be given back their mutability.
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline RedBlackMap<K, V, Compare, Allocator>::Iterator::Iterator(const typename Tree::Iterator& iterator)
+	: m_iterator(iterator)
+{}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::Iterator::reference RedBlackMap<K, V, Compare, Allocator>::Iterator::operator*() const
+{
+	return const_cast<reference>(*m_iterator);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::Iterator::pointer RedBlackMap<K, V, Compare, Allocator>::Iterator::operator->() const
+{
+	return &**this;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::Iterator& RedBlackMap<K, V, Compare, Allocator>::Iterator::operator++()
+{
+	++m_iterator;
+	return *this;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::Iterator RedBlackMap<K, V, Compare, Allocator>::Iterator::operator++(int)
+{
+	Iterator previous = *this;
+	++m_iterator;
+	return previous;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::Iterator& RedBlackMap<K, V, Compare, Allocator>::Iterator::operator--()
+{
+	--m_iterator;
+	return *this;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::Iterator RedBlackMap<K, V, Compare, Allocator>::Iterator::operator--(int)
+{
+	Iterator previous = *this;
+	--m_iterator;
+	return previous;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline bool RedBlackMap<K, V, Compare, Allocator>::Iterator::operator==(const Iterator& other) const
+{
+	return m_iterator == other.m_iterator;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline size_t RedBlackMap<K, V, Compare, Allocator>::Iterator::Index() const
+{
+	return m_iterator.Index();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// RED BLACK MAP MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline RedBlackMap<K, V, Compare, Allocator>::RedBlackMap()
+	: m_tree()
+{}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline RedBlackMap<K, V, Compare, Allocator>::RedBlackMap(const Allocator& allocator)
+	: m_tree(allocator)
+{}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline RedBlackMap<K, V, Compare, Allocator>::RedBlackMap(const Compare& compare, const Allocator& allocator)
+	: m_tree(KeyCompare{ compare }, allocator)
+{}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline V& RedBlackMap<K, V, Compare, Allocator>::operator[](const K& key)
+{
+	return Emplace(key).first;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline V& RedBlackMap<K, V, Compare, Allocator>::operator[](K&& key)
+{
+	return Emplace(std::move(key)).first;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<typename... Args>
+inline std::pair<std::reference_wrapper<V>, bool> RedBlackMap<K, V, Compare, Allocator>::TryEmplace(const K& key, Args&&... args)
+{
+	return Emplace(key, std::forward<Args>(args)...);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<typename... Args>
+inline std::pair<std::reference_wrapper<V>, bool> RedBlackMap<K, V, Compare, Allocator>::TryEmplace(K&& key, Args&&... args)
+{
+	return Emplace(std::move(key), std::forward<Args>(args)...);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<typename M>
+inline bool RedBlackMap<K, V, Compare, Allocator>::InsertOrAssign(const K& key, M&& value)
+{
+	return Assign(key, std::forward<M>(value));
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<typename M>
+inline bool RedBlackMap<K, V, Compare, Allocator>::InsertOrAssign(K&& key, M&& value)
+{
+	return Assign(std::move(key), std::forward<M>(value));
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline bool RedBlackMap<K, V, Compare, Allocator>::Delete(const K& key)
+{
+	return m_tree.Delete(key);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<HeterogeneousKey<K, Compare> Key>
+inline bool RedBlackMap<K, V, Compare, Allocator>::Delete(const Key& key)
+{
+	return m_tree.Delete(key);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline bool RedBlackMap<K, V, Compare, Allocator>::DeleteAt(size_t index)
+{
+	return m_tree.DeleteAt(index);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline void RedBlackMap<K, V, Compare, Allocator>::Clear()
+{
+	m_tree.Clear();
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline std::pair<size_t, V*> RedBlackMap<K, V, Compare, Allocator>::Find(const K& key)
+{
+	return FindValue(key);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline std::pair<size_t, const V*> RedBlackMap<K, V, Compare, Allocator>::Find(const K& key) const
+{
+	return FindValue(key);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<HeterogeneousKey<K, Compare> Key>
+inline std::pair<size_t, V*> RedBlackMap<K, V, Compare, Allocator>::Find(const Key& key)
+{
+	return FindValue(key);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<HeterogeneousKey<K, Compare> Key>
+inline std::pair<size_t, const V*> RedBlackMap<K, V, Compare, Allocator>::Find(const Key& key) const
+{
+	return FindValue(key);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline const typename RedBlackMap<K, V, Compare, Allocator>::value_type& RedBlackMap<K, V, Compare, Allocator>::At(size_t index) const
+{
+	return m_tree.At(index);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline bool RedBlackMap<K, V, Compare, Allocator>::Contains(const K& key) const
+{
+	return m_tree.Contains(key);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<HeterogeneousKey<K, Compare> Key>
+inline bool RedBlackMap<K, V, Compare, Allocator>::Contains(const Key& key) const
+{
+	return m_tree.Contains(key);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline bool RedBlackMap<K, V, Compare, Allocator>::Empty() const
+{
+	return m_tree.Empty();
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline size_t RedBlackMap<K, V, Compare, Allocator>::Size() const
+{
+	return m_tree.Size();
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline size_t RedBlackMap<K, V, Compare, Allocator>::MemoryUsage() const
+{
+	return m_tree.MemoryUsage();
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::Iterator RedBlackMap<K, V, Compare, Allocator>::begin()
+{
+	return Iterator(m_tree.begin());
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::Iterator RedBlackMap<K, V, Compare, Allocator>::end()
+{
+	return Iterator(m_tree.end());
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::const_iterator RedBlackMap<K, V, Compare, Allocator>::begin() const
+{
+	return m_tree.begin();
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline typename RedBlackMap<K, V, Compare, Allocator>::const_iterator RedBlackMap<K, V, Compare, Allocator>::end() const
+{
+	return m_tree.end();
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<typename Key, typename... Args>
+inline std::pair<std::reference_wrapper<V>, bool> RedBlackMap<K, V, Compare, Allocator>::Emplace(Key&& key, Args&&... args)
+{
+	// A single descent by key, the pair is only constructed once the key is
+	// known to be missing, so neither the key nor the arguments are consumed
+	// if it is found.
+	auto [node, inserted] = m_tree.InsertWith(key, [&]()
+	{
+		return m_tree.m_pool.Create(std::piecewise_construct, std::forward_as_tuple(std::forward<Key>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+	});
+
+	return std::make_pair(std::ref(node->Item.second), inserted);
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<typename Key, typename M>
+inline bool RedBlackMap<K, V, Compare, Allocator>::Assign(Key&& key, M&& value)
+{
+	// An existing value is assigned in its node, the tree stays as it is
+	auto [node, inserted] = m_tree.InsertWith(key, [&]()
+	{
+		return m_tree.m_pool.Create(std::forward<Key>(key), std::forward<M>(value));
+	});
+
+	if (!inserted)
+	{
+		node->Item.second = std::forward<M>(value);
+	}
+
+	return inserted;
+}
+
+template<typename K, typename V, Comparator<K> Compare, typename Allocator>
+template<typename Key>
+inline std::pair<size_t, V*> RedBlackMap<K, V, Compare, Allocator>::FindValue(const Key& key) const
+{
+	auto [index, entry] = m_tree.Find(key);
+	if (index == std::numeric_limits<size_t>::max())
+	{
+		return std::make_pair(index, nullptr);
+	}
+
+	return std::make_pair(index, &const_cast<value_type&>(entry.get()).second);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DEBUG FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef ENABLE_FORCED_CHECKS
+template <typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline bool ForceCheckInvariants(const RedBlackMap<K, V, Compare, Allocator>& map)
+{
+	return ForceCheckInvariants(map.m_tree);
+}
+
+template <typename K, typename V, Comparator<K> Compare, typename Allocator>
+inline bool ForceCheckContent(const RedBlackMap<K, V, Compare, Allocator>& map)
+{
+	return ForceCheckContent(map.m_tree);
+}
+#endif
+
+#endif
@@ -0,0 +1,728 @@
+#ifndef _RED_BLACK_MULTISET_H
+#define _RED_BLACK_MULTISET_H
+
+#include "RedBlackTree.h"
+
+//////////////////////////////////////////////////////////////////////////////
+// RED BLACK MULTISET DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Left-leaning red-black tree that keeps equal items in a single node with a
+// count. The left subtree sizes add up the counts, so indices and ranks
+// include every occurrence. Adding or removing occurrences of an item that
+// is already contained only changes counts along one path.
+template <typename T, Comparator<T> Compare = DefaultCompare<T>, typename Allocator = std::allocator<T>>
+class RedBlackMultiset
+{
+private:
+	struct Node;
+	static constexpr size_t MaxHeight = LeftLeaningNode<Node>::MaxHeight;
+	using Pool = NodePool<Node, typename std::allocator_traits<Allocator>::template rebind_alloc<Node>>;
+
+	// Shares the balancing of RedBlackTree, with every node counting for
+	// all occurrences of its item in the left subtree sizes.
+	struct Node : LeftLeaningNode<Node>
+	{
+		template <typename U>
+		explicit Node(U&& item, size_t count)
+			: Item(std::forward<U>(item)), Count(count)
+		{}
+
+		using Base = LeftLeaningNode<Node>;
+		using Base::Link;
+		using Base::Unlink;
+
+		T                          Item;
+		size_t                     Count;
+
+		size_t Weight() const { return Count; }
+		void   Update() {}
+
+		template <typename Create>
+		static std::pair<Node*, bool> Insert (Node*& root, const T& item, size_t count, const Compare& compare, Create&& create);
+		static std::pair<size_t, bool> Delete (Pool& pool, Node*& root, const T& item, size_t count, const Compare& compare);
+		static const Node* Find      (const Node* node, const T& item, const Compare& compare, size_t& rank);
+		static const Node* At        (const Node* node, size_t& index);
+
+		inline static T s_default;
+	};
+public:
+	// In-order iterator visiting every occurrence of an item, works like the
+	// one of RedBlackTree with the position inside the current node added.
+	class Iterator
+	{
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type        = T;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const T*;
+		using reference         = const T&;
+
+		          Iterator   ();
+		          Iterator   (const Iterator& other);
+		Iterator& operator=  (const Iterator& other);
+
+		reference operator*  () const;
+		pointer   operator-> () const;
+
+		Iterator& operator++ ();
+		Iterator  operator++ (int);
+		Iterator& operator-- ();
+		Iterator  operator-- (int);
+
+		bool      operator== (const Iterator& other) const;
+
+		size_t    Index      () const;
+	private:
+		friend class RedBlackMultiset;
+
+		void      PushLeftSpine  (const Node* node);
+
+		const RedBlackMultiset*     m_tree;
+		size_t                      m_index;
+		size_t                      m_repeat;
+		size_t                      m_depth;
+		const Node*                 m_path[MaxHeight];
+	};
+
+	using value_type             = T;
+	using size_type              = size_t;
+	using iterator               = Iterator;
+	using const_iterator         = Iterator;
+	using reverse_iterator       = std::reverse_iterator<Iterator>;
+	using const_reverse_iterator = std::reverse_iterator<Iterator>;
+
+			 RedBlackMultiset ();
+	explicit RedBlackMultiset (const Allocator& allocator);
+	explicit RedBlackMultiset (const Compare& compare, const Allocator& allocator = Allocator());
+	template <std::input_iterator InputIt>
+			 RedBlackMultiset (InputIt first, InputIt last, const Compare& compare = Compare(), const Allocator& allocator = Allocator());
+			 RedBlackMultiset (RedBlackMultiset&& other) noexcept;
+	RedBlackMultiset& operator= (RedBlackMultiset&& other) noexcept;
+			 ~RedBlackMultiset();
+
+	size_t   Insert       (const T& item, size_t count = 1);
+	size_t   Insert       (T&& item, size_t count = 1);
+	size_t   Delete       (const T& item, size_t count = 1);
+	size_t   DeleteAll    (const T& item);
+	void     Clear        ();
+
+	std::pair<size_t, std::reference_wrapper<const T>> Find (const T& item) const;
+	size_t   Count        (const T& item) const;
+	const T& At           (size_t index)  const;
+	size_t   Rank         (const T& item) const;
+	bool     Contains     (const T& item) const;
+
+	bool     Empty        () const;
+	size_t   Size         () const;
+	size_t   UniqueSize   () const;
+	size_t   MemoryUsage  () const;
+
+	Iterator begin        () const;
+	Iterator end          () const;
+	reverse_iterator rbegin () const;
+	reverse_iterator rend () const;
+private:
+	template <typename U>
+	size_t   Add          (U&& item, size_t count);
+
+	[[no_unique_address]] Compare m_compare;
+	Pool                        m_pool;
+	Node*                       m_root;
+	size_t                      m_treeSize;
+	size_t                      m_uniqueSize;
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+	bool CheckInvariants() const;
+#endif
+#ifdef PROVIDE_DATA_STRUCTURE
+	bool CheckContent() const;
+#endif
+#ifdef ENABLE_FORCED_CHECKS
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckInvariants(const RedBlackMultiset<U, C, A>& tree);
+	template <typename U, Comparator<U> C, typename A> friend bool ForceCheckContent(const RedBlackMultiset<U, C, A>& tree);
+#endif
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// RED BLACK MULTISET::NODE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename Create>
+inline std::pair<typename RedBlackMultiset<T, Compare, Allocator>::Node*, bool> RedBlackMultiset<T, Compare, Allocator>::Node::Insert (Node*& root, const T& item, size_t count, const Compare& compare, Create&& create)
+{
+	// The nodes the search turns left at, which are only touched on the way
+	// down of Link, as the tree is left as it is if the item is contained.
+	Node*  leftTurns[MaxHeight];
+	size_t turns = 0;
+
+	auto [node, inserted] = Link(root, [&](Node* node)
+	{
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order < 0)
+		{
+			leftTurns[turns++] = node;
+		}
+
+		return order;
+	}, std::forward<Create>(create));
+
+	// A duplicate only adds to its node's count and to the left sizes of the
+	// nodes above it, the shape of the tree stays the same.
+	if (!inserted)
+	{
+		node->Count += count;
+		for (size_t i = 0; i < turns; ++i)
+		{
+			leftTurns[i]->AddLeftSize(count);
+		}
+	}
+
+	return std::make_pair(node, inserted);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::pair<size_t, bool> RedBlackMultiset<T, Compare, Allocator>::Node::Delete (Pool& pool, Node*& root, const T& item, size_t count, const Compare& compare)
+{
+	Node*  leftTurns[MaxHeight];
+	size_t turns = 0;
+
+	// Search first, occurrences beyond the deleted ones stay in the node
+	Node* node = root;
+	while (node)
+	{
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order == 0)
+		{
+			break;
+		}
+
+		if (order < 0)
+		{
+			leftTurns[turns++] = node;
+		}
+
+		node = order < 0 ? node->Left : node->Right;
+	}
+
+	if (!node)
+	{
+		return std::make_pair(0, false);
+	}
+
+	if (node->Count > count)
+	{
+		node->Count -= count;
+		for (size_t i = 0; i < turns; ++i)
+		{
+			leftTurns[i]->SubtractLeftSize(count);
+		}
+
+		return std::make_pair(count, false);
+	}
+
+	// The last occurrence goes, so the node is unlinked as in RedBlackTree,
+	// with the left sizes losing its whole count.
+	size_t removed = node->Count;
+	pool.Destroy(Unlink(root, [&](const Node* node)
+	{
+		return CompareOrder(compare, item, node->Item);
+	}, [](const Node*) {}));
+
+	return std::make_pair(removed, true);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline const typename RedBlackMultiset<T, Compare, Allocator>::Node* RedBlackMultiset<T, Compare, Allocator>::Node::Find (const Node* node, const T& item, const Compare& compare, size_t& rank)
+{
+	// The rank is found along the way whether the item is contained or not
+	rank = 0;
+	while (node)
+	{
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order == 0)
+		{
+			rank += node->LeftSize();
+			return node;
+		}
+
+		if (order < 0)
+		{
+			node = node->Left;
+		}
+		else
+		{
+			rank += node->LeftSize() + node->Count;
+			node = node->Right;
+		}
+	}
+
+	return nullptr;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline const typename RedBlackMultiset<T, Compare, Allocator>::Node* RedBlackMultiset<T, Compare, Allocator>::Node::At (const Node* node, size_t& index)
+{
+	// Leaves the position of the occurrence inside the found node in index
+	while (node)
+	{
+		if (index < node->LeftSize())
+		{
+			node = node->Left;
+		}
+		else if (index - node->LeftSize() < node->Count)
+		{
+			index -= node->LeftSize();
+			return node;
+		}
+		else
+		{
+			index -= node->LeftSize() + node->Count;
+			node = node->Right;
+		}
+	}
+
+	return nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// RED BLACK MULTISET::ITERATOR MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RedBlackMultiset<T, Compare, Allocator>::Iterator::Iterator()
+	: m_tree(nullptr), m_index(0), m_repeat(0), m_depth(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RedBlackMultiset<T, Compare, Allocator>::Iterator::Iterator(const Iterator& other)
+	: m_tree(other.m_tree), m_index(other.m_index), m_repeat(other.m_repeat), m_depth(other.m_depth)
+{
+	std::copy(other.m_path, other.m_path + other.m_depth, m_path);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator& RedBlackMultiset<T, Compare, Allocator>::Iterator::operator=(const Iterator& other)
+{
+	m_tree = other.m_tree;
+	m_index = other.m_index;
+	m_repeat = other.m_repeat;
+	m_depth = other.m_depth;
+	std::copy(other.m_path, other.m_path + other.m_depth, m_path);
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator::reference RedBlackMultiset<T, Compare, Allocator>::Iterator::operator*() const
+{
+	return m_path[m_depth - 1]->Item;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator::pointer RedBlackMultiset<T, Compare, Allocator>::Iterator::operator->() const
+{
+	return &m_path[m_depth - 1]->Item;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator& RedBlackMultiset<T, Compare, Allocator>::Iterator::operator++()
+{
+	++m_index;
+
+	const Node* node = m_path[m_depth - 1];
+	if (++m_repeat < node->Count)
+	{
+		return *this;
+	}
+
+	m_repeat = 0;
+	Node::Next(m_path, m_depth);
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator RedBlackMultiset<T, Compare, Allocator>::Iterator::operator++(int)
+{
+	Iterator previous = *this;
+	++*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator& RedBlackMultiset<T, Compare, Allocator>::Iterator::operator--()
+{
+	--m_index;
+
+	if (m_repeat > 0)
+	{
+		--m_repeat;
+		return *this;
+	}
+
+	Node::Previous(m_path, m_depth, m_tree->m_root);
+	m_repeat = m_path[m_depth - 1]->Count - 1;
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator RedBlackMultiset<T, Compare, Allocator>::Iterator::operator--(int)
+{
+	Iterator previous = *this;
+	--*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RedBlackMultiset<T, Compare, Allocator>::Iterator::operator==(const Iterator& other) const
+{
+	const Node* current = m_depth ? m_path[m_depth - 1] : nullptr;
+	const Node* otherCurrent = other.m_depth ? other.m_path[other.m_depth - 1] : nullptr;
+	return current == otherCurrent && m_repeat == other.m_repeat;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::Iterator::Index() const
+{
+	return m_index;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void RedBlackMultiset<T, Compare, Allocator>::Iterator::PushLeftSpine(const Node* node)
+{
+	Node::PushLeftSpine(m_path, m_depth, node);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// RED BLACK MULTISET MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RedBlackMultiset<T, Compare, Allocator>::RedBlackMultiset()
+	: m_compare(), m_pool(), m_root(nullptr), m_treeSize(0), m_uniqueSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RedBlackMultiset<T, Compare, Allocator>::RedBlackMultiset(const Allocator& allocator)
+	: m_compare(), m_pool(allocator), m_root(nullptr), m_treeSize(0), m_uniqueSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RedBlackMultiset<T, Compare, Allocator>::RedBlackMultiset(const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_pool(allocator), m_root(nullptr), m_treeSize(0), m_uniqueSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<std::input_iterator InputIt>
+inline RedBlackMultiset<T, Compare, Allocator>::RedBlackMultiset(InputIt first, InputIt last, const Compare& compare, const Allocator& allocator)
+	: RedBlackMultiset(compare, allocator)
+{
+	for (; first != last; ++first)
+	{
+		Insert(*first);
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RedBlackMultiset<T, Compare, Allocator>::RedBlackMultiset(RedBlackMultiset&& other) noexcept
+	: m_compare(std::move(other.m_compare)), m_pool(std::move(other.m_pool)), m_root(std::exchange(other.m_root, nullptr)), m_treeSize(std::exchange(other.m_treeSize, 0)), m_uniqueSize(std::exchange(other.m_uniqueSize, 0))
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RedBlackMultiset<T, Compare, Allocator>& RedBlackMultiset<T, Compare, Allocator>::operator=(RedBlackMultiset&& other) noexcept
+{
+	if (this != &other)
+	{
+		Clear();
+		m_compare = std::move(other.m_compare);
+		m_pool = std::move(other.m_pool);
+		m_root = std::exchange(other.m_root, nullptr);
+		m_treeSize = std::exchange(other.m_treeSize, 0);
+		m_uniqueSize = std::exchange(other.m_uniqueSize, 0);
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline RedBlackMultiset<T, Compare, Allocator>::~RedBlackMultiset()
+{
+	Clear();
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::Insert(const T& item, size_t count)
+{
+	return Add(item, count);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::Insert(T&& item, size_t count)
+{
+	return Add(std::move(item), count);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::Delete(const T& item, size_t count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	auto [removed, erased] = Node::Delete(m_pool, m_root, item, count, m_compare);
+	m_treeSize -= removed;
+	m_uniqueSize -= erased;
+	return removed;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::DeleteAll(const T& item)
+{
+	return Delete(item, std::numeric_limits<size_t>::max());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline void RedBlackMultiset<T, Compare, Allocator>::Clear()
+{
+	if constexpr (!std::is_trivially_destructible_v<T>)
+	{
+		Node::DestroyAll(m_pool, m_root);
+	}
+
+	m_pool.Release();
+	m_root = nullptr;
+	m_treeSize = 0;
+	m_uniqueSize = 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackMultiset<T, Compare, Allocator>::Find(const T& item) const
+{
+	// The index is the one of the first occurrence
+	size_t rank;
+	const Node* node = Node::Find(m_root, item, m_compare, rank);
+	if (!node)
+	{
+		return std::make_pair((size_t)-1, std::cref(Node::s_default));
+	}
+
+	return std::make_pair(rank, std::cref(node->Item));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::Count(const T& item) const
+{
+	size_t rank;
+	const Node* node = Node::Find(m_root, item, m_compare, rank);
+	return node ? node->Count : 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline const T& RedBlackMultiset<T, Compare, Allocator>::At(size_t index) const
+{
+	const Node* node = Node::At(m_root, index);
+	return node ? node->Item : Node::s_default;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::Rank(const T& item) const
+{
+	size_t rank;
+	Node::Find(m_root, item, m_compare, rank);
+	return rank;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RedBlackMultiset<T, Compare, Allocator>::Contains(const T& item) const
+{
+	size_t rank;
+	return Node::Find(m_root, item, m_compare, rank) != nullptr;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RedBlackMultiset<T, Compare, Allocator>::Empty() const
+{
+	return m_treeSize == 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::Size() const
+{
+	return m_treeSize;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::UniqueSize() const
+{
+	return m_uniqueSize;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::MemoryUsage() const
+{
+	return m_pool.Capacity() * sizeof(Node);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator RedBlackMultiset<T, Compare, Allocator>::begin() const
+{
+	Iterator iterator;
+	iterator.m_tree = this;
+	iterator.PushLeftSpine(m_root);
+	return iterator;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::Iterator RedBlackMultiset<T, Compare, Allocator>::end() const
+{
+	Iterator iterator;
+	iterator.m_tree = this;
+	iterator.m_index = m_treeSize;
+	return iterator;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::reverse_iterator RedBlackMultiset<T, Compare, Allocator>::rbegin() const
+{
+	return reverse_iterator(end());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline typename RedBlackMultiset<T, Compare, Allocator>::reverse_iterator RedBlackMultiset<T, Compare, Allocator>::rend() const
+{
+	return reverse_iterator(begin());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator>
+template<typename U>
+inline size_t RedBlackMultiset<T, Compare, Allocator>::Add(U&& item, size_t count)
+{
+	if (count == 0)
+	{
+		return Count(item);
+	}
+
+	// The item is only moved into a node if it is not contained yet
+	auto [node, inserted] = Node::Insert(m_root, item, count, m_compare, [&]() { return m_pool.Create(std::forward<U>(item), count); });
+	m_treeSize += count;
+	m_uniqueSize += inserted;
+	return node->Count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// DEBUG FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef PROVIDE_INVARIANT_CHECKS
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RedBlackMultiset<T, Compare, Allocator>::CheckInvariants() const
+{
+	// Returns the black height of the subtree, or -1 if it is broken
+	auto check = [](auto& self, const Node* node, bool isRoot) -> size_t
+	{
+		if (!node)
+		{
+			return 0;
+		}
+
+		if (!isRoot && node->IsRed() && (node->IsLeftRed() || node->IsRightRed()))
+		{
+			printf("Found two neighbouring red edges!\n");
+			return (size_t)-1;
+		}
+
+		if (node->IsLeftBlack() && node->IsRightRed())
+		{
+			printf("Found a single red edge going right!\n");
+			return (size_t)-1;
+		}
+
+		if (node->Count == 0)
+		{
+			printf("Found a node without occurrences!\n");
+			return (size_t)-1;
+		}
+
+		size_t left = self(self, node->Left, false);
+		size_t right = self(self, node->Right, false);
+		if (left == (size_t)-1 || right == (size_t)-1 || left != right)
+		{
+			if (left != right)
+			{
+				printf("Found two paths from root to leaf with different black node counts!\n");
+			}
+
+			return (size_t)-1;
+		}
+
+		return left + node->IsBlack();
+	};
+
+	return check(check, m_root, true) != (size_t)-1;
+}
+#endif
+
+#ifdef PROVIDE_DATA_STRUCTURE
+template<typename T, Comparator<T> Compare, typename Allocator>
+inline bool RedBlackMultiset<T, Compare, Allocator>::CheckContent() const
+{
+	// In-order walk, checking the order of the items and every left size
+	std::vector<std::pair<const Node*, size_t>> stack;
+	const Node* previous = nullptr;
+	size_t count = 0;
+	size_t unique = 0;
+
+	for (const Node* node = m_root; node || !stack.empty();)
+	{
+		for (; node; node = node->Left)
+		{
+			stack.emplace_back(node, count);
+		}
+
+		auto [current, countBefore] = stack.back();
+		stack.pop_back();
+
+		if (count - countBefore != current->LeftSize())
+		{
+			printf("Found a node with left subtree size not matching its left subtree!\n");
+			return false;
+		}
+
+		if (previous && !CompareLess(m_compare, previous->Item, current->Item))
+		{
+			printf("Found items out of order at index: %d\n", (int)count);
+			return false;
+		}
+
+		previous = current;
+		count += current->Count;
+		++unique;
+		node = current->Right;
+	}
+
+	if (count != m_treeSize || unique != m_uniqueSize)
+	{
+		printf("Tree size different from the count of items!\n");
+		return false;
+	}
+
+	return true;
+}
+#endif
+
+#ifdef ENABLE_FORCED_CHECKS
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckInvariants(const RedBlackMultiset<T, Compare, Allocator>& tree)
+{
+	return tree.CheckInvariants();
+}
+
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool ForceCheckContent(const RedBlackMultiset<T, Compare, Allocator>& tree)
+{
+	return tree.CheckContent();
+}
+#endif
+
+#endif
@@ -1,15 +1,41 @@
 #ifndef _RED_BLACK_TREE_H
 #define _RED_BLACK_TREE_H
 
+#include <algorithm>
+#include <bit>
+#include <compare>
+#include <concepts>
+#include <functional>
+#include <future>
+#include <iosfwd>
+#include <iterator>
+#include <limits>
 #include <memory>
+#include <new>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 //////////////////////////////////////////////////////////////////////////////
 // DEBUG PREPARATION
 //////////////////////////////////////////////////////////////////////////////
 
+#if defined(__GNUC__) || defined(__clang__)
+#	define RBT_PREFETCH(address) __builtin_prefetch(address)
+#elif defined(_MSC_VER)
+#	include <xmmintrin.h>
+#	define RBT_PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+#	define RBT_PREFETCH(address) ((void)0)
+#endif
+
 #if defined(RUNTIME_REFERENCE_DATA_STRUCTURE) || defined(ENABLE_FORCED_CHECKS)
 #	include <vector>
-#	include <algorithm>
 #	define PROVIDE_DATA_STRUCTURE
 #endif
 
@@ -39,121 +65,790 @@
 // ACCEPTED TYPE CONSTRAINT DEFINITION
 //////////////////////////////////////////////////////////////////////////////
 
+// A comparator either returns the result of a three-way comparison, like
+// std::compare_three_way, or tells whether the first argument is less than
+// the second, like std::less.
+template <typename Compare, typename T, typename U = T>
+concept ThreeWayComparator = requires(const Compare& compare, const T& a, const U& b)
+{
+	{ compare(a, b) } -> std::convertible_to<std::partial_ordering>;
+	{ compare(b, a) } -> std::convertible_to<std::partial_ordering>;
+};
+
+template <typename Compare, typename T, typename U = T>
+concept Comparator = ThreeWayComparator<Compare, T, U> || requires(const Compare& compare, const T& a, const U& b)
+{
+	{ compare(a, b) } -> std::convertible_to<bool>;
+	{ compare(b, a) } -> std::convertible_to<bool>;
+};
+
+// Transparent comparators allow lookups with any type they can compare with
+// the items, e.g. std::string_view for std::string items.
+template <typename Compare>
+concept TransparentComparator = requires
+{
+	typename Compare::is_transparent;
+};
+
+template <typename K, typename T, typename Compare>
+concept HeterogeneousKey = TransparentComparator<Compare> && Comparator<Compare, T, K>;
+
+// Items comparable with <=> use a single three-way comparison per tree level,
+// anything else falls back to operator<.
+template <typename T>
+using DefaultCompare = std::conditional_t<std::three_way_comparable<T>, std::compare_three_way, std::less<>>;
+
+// Compares through either kind of comparator. The result can be tested
+// against 0 like the result of <=>.
+template <typename Compare, typename A, typename B>
+inline auto CompareOrder(const Compare& compare, const A& a, const B& b)
+{
+	if constexpr (ThreeWayComparator<Compare, A, B>)
+	{
+		return compare(a, b);
+	}
+	else
+	{
+		if (compare(a, b))
+		{
+			return std::weak_ordering::less;
+		}
+
+		return compare(b, a) ? std::weak_ordering::greater : std::weak_ordering::equivalent;
+	}
+}
+
+template <typename Compare, typename A, typename B>
+inline bool CompareLess(const Compare& compare, const A& a, const B& b)
+{
+	if constexpr (ThreeWayComparator<Compare, A, B>)
+	{
+		return compare(a, b) < 0;
+	}
+	else
+	{
+		return compare(a, b);
+	}
+}
+
+// Marks an input range as already sorted and free of duplicates, so that it
+// can be turned into a tree without comparing the items at all.
+struct SortedUniqueTag {};
+inline constexpr SortedUniqueTag SortedUnique{};
+
+// An augmentation keeps a value per node summarizing its whole subtree. The
+// values form a monoid: Combine has to be associative, Identity neutral to
+// it, and Lift maps a single item to a value. Combine is always given the
+// values of its arguments in item order, so it need not be commutative.
+template <typename Augment, typename T>
+concept Augmentation = requires(const T& item, const typename Augment::Value& a, const typename Augment::Value& b)
+{
+	{ Augment::Identity() } -> std::convertible_to<typename Augment::Value>;
+	{ Augment::Lift(item) } -> std::convertible_to<typename Augment::Value>;
+	{ Augment::Combine(a, b) } -> std::convertible_to<typename Augment::Value>;
+};
+
+// The default, which keeps nothing and takes no space in the nodes
+struct NoAugmentation
+{
+	struct Value {};
+
+	static constexpr Value Identity() { return {}; }
+	template <typename T>
+	static constexpr Value Lift(const T&) { return {}; }
+	static constexpr Value Combine(Value, Value) { return {}; }
+};
+
+template <typename T>
+struct SumAugmentation
+{
+	using Value = T;
+
+	static constexpr Value Identity() { return Value(); }
+	static constexpr Value Lift(const T& item) { return item; }
+	static constexpr Value Combine(const Value& a, const Value& b) { return a + b; }
+};
+
+template <typename T>
+struct MinAugmentation
+{
+	using Value = T;
+
+	static constexpr Value Identity() { return std::numeric_limits<T>::max(); }
+	static constexpr Value Lift(const T& item) { return item; }
+	static constexpr Value Combine(const Value& a, const Value& b) { return std::min(a, b); }
+};
+
 template <typename T>
-concept Comparable = requires(T a, T b)
+struct MaxAugmentation
 {
-	a < b;
-	a == b;
+	using Value = T;
+
+	static constexpr Value Identity() { return std::numeric_limits<T>::lowest(); }
+	static constexpr Value Lift(const T& item) { return item; }
+	static constexpr Value Combine(const Value& a, const Value& b) { return std::max(a, b); }
 };
 
 //////////////////////////////////////////////////////////////////////////////
-// RED BLACK TREE DECLARATION
+// NODE POOL DECLARATION
 //////////////////////////////////////////////////////////////////////////////
 
-template <Comparable T>
-class RedBlackTree
+// Slab allocator handing out fixed-size objects. Freed objects are kept on an
+// intrusive free list and reused before a new slab is requested, and all slabs
+// can be returned to the allocator at once without visiting the objects.
+template <typename T, typename Allocator = std::allocator<T>>
+class NodePool
 {
 private:
-	struct Node
+	union Slot
 	{
-		Node(const T& item)
-			: Item(item), Black(false), LeftSize(0), Left(nullptr), Right(nullptr)
-		{}
+		Slot*         Next;
+		alignas(T) unsigned char Storage[sizeof(T)];
+	};
 
-		T                          Item;
-		bool                       Black;
-		size_t                     LeftSize;
-		std::unique_ptr<Node>      Left;
-		std::unique_ptr<Node>      Right;
+	struct SlabHeader
+	{
+		Slot*  NextSlab;
+		size_t SlotCount;
+	};
+
+	using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+	using SlotTraits    = std::allocator_traits<SlotAllocator>;
+
+	static constexpr size_t HeaderSlots  = (sizeof(SlabHeader) + sizeof(Slot) - 1) / sizeof(Slot);
+	static constexpr size_t MinSlabSlots = 64;
+	static constexpr size_t MaxSlabSlots = 65536;
+public:
+	explicit NodePool     (const Allocator& allocator = Allocator());
+	         NodePool     (NodePool&& other) noexcept;
+	NodePool& operator=   (NodePool&& other) noexcept;
+	         ~NodePool    ();
+
+	template <typename... Args>
+	T*       Create       (Args&&... args);
+	void     Destroy      (T* object);
+	void     Release      ();
+	bool     Adopt        (NodePool& other);
+
+	size_t   Capacity     () const;
+	Allocator GetAllocator () const;
+private:
+	Slot*    AllocateSlab ();
+
+	SlotAllocator               m_allocator;
+	Slot*                       m_slabs;
+	Slot*                       m_freeList;
+	Slot*                       m_next;
+	Slot*                       m_end;
+	size_t                      m_capacity;
+};
 
-		bool IsBlack() const { return Black; }
-		bool IsRed()   const { return !Black; }
+// Immutable copy of a tree in a flat layout, defined in FrozenTree.h
+template <typename T, Comparator<T> Compare, typename Allocator>
+class FrozenTree;
 
-		bool IsLeftBlack() const { return !Left || Left->IsBlack(); }
-		bool IsLeftRed()   const { return Left && Left->IsRed(); }
+//////////////////////////////////////////////////////////////////////////////
+// LEFT LEANING NODE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Links, colour and left subtree size of a node of a left-leaning red-black
+// tree, along with the balancing and in-order stepping every such tree
+// shares. Node derives from it and provides Weight(), the number of items
+// the node counts for in the left subtree sizes, and Update(), which is
+// called whenever the children of the node changed.
+template <typename Node>
+struct LeftLeaningNode
+{
+	// Upper bound on the height of a left-leaning red-black tree addressable
+	// with size_t, used to size the explicit paths of the iterative updates.
+	static constexpr size_t MaxHeight = 2 * std::numeric_limits<size_t>::digits;
+
+	// The colour lives in the most significant bit of the left subtree
+	// size, which no tree can reach, instead of in a separate padded bool.
+	static constexpr size_t BlackBit = (size_t)1 << (std::numeric_limits<size_t>::digits - 1);
+
+	size_t                     SizeAndColour = 0;
+	Node*                      Left = nullptr;
+	Node*                      Right = nullptr;
+
+	size_t LeftSize() const { return SizeAndColour & ~BlackBit; }
+	void   AddLeftSize      (size_t count) { SizeAndColour += count; }
+	void   SubtractLeftSize (size_t count) { SizeAndColour -= count; }
+	void   SetLeftSize      (size_t count) { SizeAndColour = (SizeAndColour & BlackBit) | count; }
+
+	bool IsBlack() const { return SizeAndColour & BlackBit; }
+	bool IsRed()   const { return !IsBlack(); }
 
-		bool IsRightBlack() const { return !Right || Right->IsBlack(); }
-		bool IsRightRed()   const { return Right && Right->IsRed(); }
+	void SetBlack(bool black) { SizeAndColour = black ? SizeAndColour | BlackBit : SizeAndColour & ~BlackBit; }
+	void FlipColour() { SizeAndColour ^= BlackBit; }
 
-		void MoveRedUp()
+	bool IsLeftBlack() const { return !Left || Left->IsBlack(); }
+	bool IsLeftRed()   const { return Left && Left->IsRed(); }
+
+	bool IsRightBlack() const { return !Right || Right->IsBlack(); }
+	bool IsRightRed()   const { return Right && Right->IsRed(); }
+
+	void MoveRedUp()
+	{
+		if (IsLeftRed() && IsRightRed())
 		{
-			if (IsLeftRed() && IsRightRed())
-			{
-				SwitchColours();
-			}
+			SwitchColours();
 		}
+	}
 
-		void SwitchColours()
+	void SwitchColours()
+	{
+		if (Left)
 		{
-			if (Left)
-			{
-				Left->Black = !Left->Black;
-			}
+			Left->FlipColour();
+		}
+
+		if (Right)
+		{
+			Right->FlipColour();
+		}
+
+		FlipColour();
+	}
+
+	static void     Fixup        (Node*& node);
+	static void     RotateLeft   (Node*& node);
+	static void     RotateRight  (Node*& node);
+	static void     MoveRedLeft  (Node*& node);
+	static void     MoveRedRight (Node*& node);
+
+	template <typename Locate, typename Create>
+	static std::pair<Node*, bool> Link (Node*& root, Locate&& locate, Create&& create);
+	template <typename Locate, typename Descend>
+	static Node*    Unlink       (Node*& root, Locate&& locate, Descend&& descend);
+	template <typename Pool>
+	static void     DestroyAll   (Pool& pool, Node* node);
+
+	static void     PushLeftSpine  (const Node** path, size_t& depth, const Node* node);
+	static void     PushRightSpine (const Node** path, size_t& depth, const Node* node);
+	static void     Next         (const Node** path, size_t& depth);
+	static void     Previous     (const Node** path, size_t& depth, const Node* root);
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// RED BLACK TREE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename T, Comparator<T> Compare = DefaultCompare<T>, typename Allocator = std::allocator<T>, Augmentation<T> Augment = NoAugmentation>
+class RedBlackTree
+{
+private:
+	// Subtrees at least this large are split between two threads by the set
+	// operations.
+	static constexpr size_t ParallelThreshold = 1 << 16;
+
+	struct Node;
+	static constexpr size_t MaxHeight = LeftLeaningNode<Node>::MaxHeight;
+	using Pool = NodePool<Node, typename std::allocator_traits<Allocator>::template rebind_alloc<Node>>;
+
+	// A subtree detached from the tree, along with what the joins need to
+	// know about it without walking it.
+	struct Subtree
+	{
+		Node*  Root;
+		size_t BlackHeight;
+		size_t Size;
+	};
+
+	struct Node : LeftLeaningNode<Node>
+	{
+		template <typename... Args>
+		explicit Node(Args&&... args)
+			: Item(std::forward<Args>(args)...), Aggregate(Augment::Lift(Item))
+		{}
 
-			if (Right)
+		using Base = LeftLeaningNode<Node>;
+		using Base::Left;
+		using Base::Right;
+		using Base::BlackBit;
+		using Base::Fixup;
+		using Base::Link;
+		using Base::Unlink;
+		using Base::DestroyAll;
+
+		static constexpr bool IsAugmented = !std::is_same_v<Augment, NoAugmentation>;
+
+		T                          Item;
+		[[no_unique_address]] typename Augment::Value Aggregate;
+
+		// Every node holds a single item
+		size_t Weight() const { return 1; }
+
+		// Recomputes the aggregate from the children, which have to be up to
+		// date already. Whatever changes the children of a node calls this.
+		void Update()
+		{
+			if constexpr (IsAugmented)
 			{
-				Right->Black = !Right->Black;
+				Aggregate = Augment::Combine(Augment::Combine(AggregateOf(Left), Augment::Lift(Item)), AggregateOf(Right));
 			}
-
-			Black = !Black;
 		}
 
-		static void     Fixup        (std::unique_ptr<Node>& node);
-		static void     RotateLeft   (std::unique_ptr<Node>& node);
-		static void     RotateRight  (std::unique_ptr<Node>& node);
-		static void     MoveRedLeft  (std::unique_ptr<Node>& node);
-		static void     MoveRedRight (std::unique_ptr<Node>& node);
-
-		static bool     Insert       (std::unique_ptr<Node>& node, const T& item);
-		static bool     Delete       (std::unique_ptr<Node>& node, const T& item);
-		static bool     DeleteMin    (std::unique_ptr<Node>& node);
-		static std::pair<size_t, std::reference_wrapper<const T>> Find (const Node* node, const T& item);
+		static typename Augment::Value AggregateOf(const Node* node) { return node ? node->Aggregate : Augment::Identity(); }
+
+		template <typename K, typename Create>
+		static std::pair<Node*, bool> Insert (Node*& root, const K& item, const Compare& compare, Create&& create);
+		template <typename K>
+		static bool     Delete       (Pool& pool, Node*& root, const K& item, const Compare& compare);
+		static void     MoveItems    (Node* node, std::vector<T>& items);
+		template <typename InputIt>
+		static Node*    Build        (Pool& pool, InputIt& first, size_t count, size_t capacity);
+		template <typename K>
+		static std::pair<size_t, std::reference_wrapper<const T>> Find (const Node* node, const K& item, const Compare& compare);
+		static void     FindMany     (const Node* root, std::span<const T> items, std::span<size_t> indices, const Compare& compare);
 		static const T& At           (const Node* node, size_t index);
-		static bool     Contains     (const Node* node, const T& item);
+		static size_t   Rank         (const Node* node, const T& item, const Compare& compare);
+		template <typename K>
+		static bool     Contains     (const Node* node, const K& item, const Compare& compare);
+
+		static Subtree  MakeSubtree  (Node* root, size_t size);
+		static void     Blacken      (Subtree& tree);
+		static std::pair<Subtree, Subtree> Children (const Subtree& tree);
+		static Subtree  Join         (Subtree left, Node* pivot, Subtree right);
+		static Subtree  Concatenate  (Subtree left, Subtree right);
+		template <typename K>
+		static std::tuple<Subtree, Node*, Subtree> Split (const Subtree& tree, const K& item, const Compare& compare);
+		static std::pair<Subtree, Node*> SplitMax (const Subtree& tree);
+		static Subtree  Union        (Subtree a, Subtree b, const Compare& compare, std::vector<Node*>& discarded, size_t forkDepth);
+		static Subtree  Intersection (Subtree a, Subtree b, const Compare& compare, std::vector<Node*>& discarded, size_t forkDepth);
+		static Subtree  Difference   (Subtree a, Subtree b, const Compare& compare, std::vector<Node*>& discarded, size_t forkDepth);
+		static Subtree  Difference   (Subtree a, std::span<const T> b, const Compare& compare, std::vector<Node*>& discarded, size_t forkDepth);
+		template <typename First, typename Second>
+		static void     ForkJoin     (bool fork, First&& first, Second&& second);
 
 		inline static T s_default;
 	};
 public:
+	// In-order iterator. Instead of parent pointers, which would grow every
+	// node, it keeps the path from the root to the current node, so stepping
+	// costs amortized O(1) and a full scan touches every node at most twice.
+	class Iterator
+	{
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type        = T;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const T*;
+		using reference         = const T&;
+
+		          Iterator   ();
+		          Iterator   (const Iterator& other);
+		Iterator& operator=  (const Iterator& other);
+
+		reference operator*  () const;
+		pointer   operator-> () const;
+
+		Iterator& operator++ ();
+		Iterator  operator++ (int);
+		Iterator& operator-- ();
+		Iterator  operator-- (int);
+
+		bool      operator== (const Iterator& other) const;
+
+		size_t    Index      () const;
+	private:
+		friend class RedBlackTree;
+
+		void      PushLeftSpine  (const Node* node);
+		void      PushRightSpine (const Node* node);
+
+		const RedBlackTree*         m_tree;
+		size_t                      m_index;
+		size_t                      m_depth;
+		const Node*                 m_path[MaxHeight];
+	};
+
+	// Owns a node extracted from the tree. Its item can be changed in place
+	// and the node inserted again, without destroying and constructing the
+	// item or going through the pool. The node stays in the tree's pool, so
+	// the handle has to be inserted or destroyed before the tree is cleared,
+	// moved from or destroyed.
+	class NodeHandle
+	{
+	public:
+		          NodeHandle ();
+		          NodeHandle (NodeHandle&& other) noexcept;
+		NodeHandle& operator= (NodeHandle&& other) noexcept;
+		          ~NodeHandle();
+
+		bool      Empty      () const;
+		explicit  operator bool () const;
+		T&        Item       () const;
+	private:
+		friend class RedBlackTree;
+
+		          NodeHandle (Pool* pool, Node* node);
+
+		Pool*                       m_pool;
+		Node*                       m_node;
+	};
+
+	// Search cursor for lookups that tend to land near the previous one. It
+	// keeps the path to the last node it visited, along with the range of
+	// items each subtree on it covers, and starts the next search from the
+	// lowest subtree that can hold the key. Nearby keys then only climb and
+	// descend a few levels instead of starting at the root. A finger is used
+	// from one thread and is invalidated by any change to the tree, like an
+	// iterator, until Reset.
+	class Finger
+	{
+	public:
+		explicit  Finger     (const RedBlackTree& tree);
+
+		std::pair<size_t, std::reference_wrapper<const T>> Find (const T& item);
+		template <HeterogeneousKey<T, Compare> K>
+		std::pair<size_t, std::reference_wrapper<const T>> Find (const K& key);
+		bool      Contains   (const T& item);
+		template <HeterogeneousKey<T, Compare> K>
+		bool      Contains   (const K& key);
+		void      Reset      ();
+	private:
+		// Subtree on the path, with the count of items before it and the
+		// nearest ancestors bounding it from below and above
+		struct Level
+		{
+			const Node*             Root;
+			size_t                  Offset;
+			const Node*             Low;
+			const Node*             High;
+		};
+
+		template <typename K>
+		std::pair<size_t, std::reference_wrapper<const T>> Search (const K& key);
+
+		const RedBlackTree*         m_tree;
+		size_t                      m_depth;
+		Level                       m_path[MaxHeight];
+	};
+
+	using value_type             = T;
+	using size_type              = size_t;
+	using iterator               = Iterator;
+	using const_iterator         = Iterator;
+	using reverse_iterator       = std::reverse_iterator<Iterator>;
+	using const_reverse_iterator = std::reverse_iterator<Iterator>;
+	using aggregate_type         = typename Augment::Value;
+	using node_type              = NodeHandle;
+
 			 RedBlackTree ();
+	explicit RedBlackTree (const Allocator& allocator);
+	explicit RedBlackTree (const Compare& compare, const Allocator& allocator = Allocator());
+	template <std::input_iterator InputIt>
+			 RedBlackTree (InputIt first, InputIt last, const Compare& compare = Compare(), const Allocator& allocator = Allocator());
+	template <std::input_iterator InputIt>
+			 RedBlackTree (SortedUniqueTag, InputIt first, InputIt last, const Compare& compare = Compare(), const Allocator& allocator = Allocator());
+			 RedBlackTree (RedBlackTree&& other) noexcept;
+	RedBlackTree& operator= (RedBlackTree&& other) noexcept;
+			 ~RedBlackTree();
 
 	bool     Insert       (const T& item);
+	bool     Insert       (T&& item);
+	bool     Insert       (Iterator hint, const T& item);
+	bool     Insert       (Iterator hint, T&& item);
+	bool     Insert       (NodeHandle&& handle);
+	bool     InsertAt     (size_t index, const T& item);
+	bool     InsertAt     (size_t index, T&& item);
+	template <typename... Args>
+	bool     Emplace      (Args&&... args);
 	bool     Delete       (const T& item);
+	template <HeterogeneousKey<T, Compare> K>
+	bool     Delete       (const K& key);
+	bool     Delete       (Iterator position);
 	bool     DeleteAt     (size_t index);
+	NodeHandle Extract    (const T& item);
+	template <HeterogeneousKey<T, Compare> K>
+	NodeHandle Extract    (const K& key);
+	std::optional<T> ExtractAt (size_t index);
+	std::optional<T> PopMin ();
+	std::optional<T> PopMax ();
 	void     Clear        ();
 
+	template <std::input_iterator InputIt>
+	void     Assign       (InputIt first, InputIt last);
+	template <std::input_iterator InputIt>
+	void     Assign       (SortedUniqueTag, InputIt first, InputIt last);
+
+	static RedBlackTree Join (RedBlackTree&& left, const T& pivot, RedBlackTree&& right);
+	RedBlackTree Split    (const T& item);
+	void     Union        (RedBlackTree&& other);
+	void     Intersection (RedBlackTree&& other);
+	void     Difference   (RedBlackTree&& other);
+	size_t   InsertBatch  (std::span<const T> items);
+	size_t   DeleteBatch  (std::span<const T> items);
+
 	std::pair<size_t, std::reference_wrapper<const T>> Find (const T& item) const;
+	template <HeterogeneousKey<T, Compare> K>
+	std::pair<size_t, std::reference_wrapper<const T>> Find (const K& key) const;
+	// Looks up the first min(items.size(), indices.size()) items
+	void     FindMany     (std::span<const T> items, std::span<size_t> indices) const;
 	const T& At           (size_t index)  const;
+	Iterator LowerBound   (const T& item) const;
+	Iterator UpperBound   (const T& item) const;
+	size_t   Rank         (const T& item) const;
+	size_t   CountRange   (const T& low, const T& high) const;
+	std::ranges::subrange<Iterator> Range (const T& low, const T& high) const;
+	aggregate_type Aggregate () const;
+	aggregate_type Aggregate (const T& low, const T& high) const;
 	bool     Contains     (const T& item) const;
+	template <HeterogeneousKey<T, Compare> K>
+	bool     Contains     (const K& key) const;
 
 	bool     Empty        () const;
 	size_t   Size         () const;
+	size_t   MemoryUsage  () const;
+	FrozenTree<T, Compare, Allocator> Freeze () const;
+
+	Iterator begin        () const;
+	Iterator end          () const;
+	reverse_iterator rbegin () const;
+	reverse_iterator rend () const;
 private:
-	std::unique_ptr<Node>       m_root;
+	template <bool Upper>
+	Iterator Bound        (const T& item) const;
+	template <typename K, typename Create>
+	std::pair<Node*, bool> InsertWith (const K& key, Create&& create);
+	template <typename Create>
+	bool     InsertNear   (size_t index, const T& item, Create&& create);
+	Node*    UnlinkAt     (size_t index);
+	template <typename K>
+	Node*    UnlinkKey    (const K& key);
+
+	Subtree  Whole        ();
+	Subtree  Adopt        (RedBlackTree& other);
+	void     Assume       (const Subtree& tree, std::vector<Node*>& discarded);
+	static Node* Relocate (Pool& from, Pool& to, const Subtree& tree);
+	static Node* BuildFrom (Pool& pool, std::vector<T>& items);
+	void     SortUnique   (std::vector<T>& items) const;
+	static void SortBatch (std::span<T> items, const Compare& compare, size_t forkDepth);
+	static size_t ForkDepth ();
+
+	[[no_unique_address]] Compare m_compare;
+	Pool                        m_pool;
+	Node*                       m_root;
 	size_t                      m_treeSize;
-	T                           m_default;
 
 #ifdef PROVIDE_DATA_STRUCTURE
+	void ReferenceInsert (const T& item);
+	template <typename K>
+	void ReferenceDelete (const K& item);
+	void ReferenceRebuild ();
 	bool CheckContent () const;
+	static size_t CheckLeftSizes(const Node* node, bool& consistent);
+	static void CheckAggregates(const Node* node, bool& consistent);
 	std::vector<T> m_reference;
 #endif
 #ifdef PROVIDE_INVARIANT_CHECKS
 	bool CheckInvariants() const;
 #endif
+	template <typename K, typename V, Comparator<K> C, typename A> friend class RedBlackMap;
+	template <typename U, typename A> friend class IntervalTree;
+	template <typename U, Comparator<U> C, typename A, Augmentation<U> G> friend bool ReadTree(std::istream& in, RedBlackTree<U, C, A, G>& tree);
+
 #ifdef ENABLE_FORCED_CHECKS
-	template <typename U> friend bool ForceCheckInvariants(const RedBlackTree<U>& tree);
-	template <typename U> friend bool ForceCheckContent(const RedBlackTree<U>& tree);
+	template <typename U, Comparator<U> C, typename A, Augmentation<U> G> friend bool ForceCheckInvariants(const RedBlackTree<U, C, A, G>& tree);
+	template <typename U, Comparator<U> C, typename A, Augmentation<U> G> friend bool ForceCheckContent(const RedBlackTree<U, C, A, G>& tree);
 #endif
 #ifdef ENABLE_TREE_DUMP
-	template<typename U> friend void DumpTreeToFile(const std::string& filename, const RedBlackTree<U>& tree);
+	template <typename U, Comparator<U> C, typename A, Augmentation<U> G> friend void DumpTreeToFile(const std::string& filename, const RedBlackTree<U, C, A, G>& tree);
 #endif
 };
 
 //////////////////////////////////////////////////////////////////////////////
-// REDBLACKTREE::NODE MEMDER FUNCTION DEFINITIONS
+// NODE POOL MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, typename Allocator>
+inline NodePool<T, Allocator>::NodePool(const Allocator& allocator)
+	: m_allocator(allocator), m_slabs(nullptr), m_freeList(nullptr), m_next(nullptr), m_end(nullptr), m_capacity(0)
+{}
+
+template<typename T, typename Allocator>
+inline NodePool<T, Allocator>::NodePool(NodePool&& other) noexcept
+	: m_allocator(std::move(other.m_allocator))
+	, m_slabs(std::exchange(other.m_slabs, nullptr))
+	, m_freeList(std::exchange(other.m_freeList, nullptr))
+	, m_next(std::exchange(other.m_next, nullptr))
+	, m_end(std::exchange(other.m_end, nullptr))
+	, m_capacity(std::exchange(other.m_capacity, 0))
+{}
+
+template<typename T, typename Allocator>
+inline NodePool<T, Allocator>& NodePool<T, Allocator>::operator=(NodePool&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		m_allocator = std::move(other.m_allocator);
+		m_slabs = std::exchange(other.m_slabs, nullptr);
+		m_freeList = std::exchange(other.m_freeList, nullptr);
+		m_next = std::exchange(other.m_next, nullptr);
+		m_end = std::exchange(other.m_end, nullptr);
+		m_capacity = std::exchange(other.m_capacity, 0);
+	}
+
+	return *this;
+}
+
+template<typename T, typename Allocator>
+inline NodePool<T, Allocator>::~NodePool()
+{
+	Release();
+}
+
+template<typename T, typename Allocator>
+template<typename... Args>
+inline T* NodePool<T, Allocator>::Create(Args&&... args)
+{
+	Slot* slot = m_freeList;
+	if (slot)
+	{
+		m_freeList = slot->Next;
+	}
+	else
+	{
+		if (m_next == m_end)
+		{
+			m_next = AllocateSlab();
+		}
+
+		slot = m_next++;
+	}
+
+	try
+	{
+		return ::new (static_cast<void*>(slot->Storage)) T(std::forward<Args>(args)...);
+	}
+	catch (...)
+	{
+		slot->Next = m_freeList;
+		m_freeList = slot;
+		throw;
+	}
+}
+
+template<typename T, typename Allocator>
+inline void NodePool<T, Allocator>::Destroy(T* object)
+{
+	object->~T();
+
+	Slot* slot = reinterpret_cast<Slot*>(object);
+	slot->Next = m_freeList;
+	m_freeList = slot;
+}
+
+template<typename T, typename Allocator>
+inline void NodePool<T, Allocator>::Release()
+{
+	while (m_slabs)
+	{
+		SlabHeader* header = reinterpret_cast<SlabHeader*>(m_slabs);
+		Slot* nextSlab = header->NextSlab;
+		SlotTraits::deallocate(m_allocator, m_slabs, header->SlotCount);
+		m_slabs = nextSlab;
+	}
+
+	m_freeList = nullptr;
+	m_next = nullptr;
+	m_end = nullptr;
+	m_capacity = 0;
+}
+
+template<typename T, typename Allocator>
+inline bool NodePool<T, Allocator>::Adopt(NodePool& other)
+{
+	// Objects can only change hands if both allocators can free each
+	// other's memory, all of the other pool's slabs are taken over then.
+	if (!(m_allocator == other.m_allocator))
+	{
+		return false;
+	}
+
+	if (other.m_slabs)
+	{
+		Slot* lastSlab = other.m_slabs;
+		while (reinterpret_cast<SlabHeader*>(lastSlab)->NextSlab)
+		{
+			lastSlab = reinterpret_cast<SlabHeader*>(lastSlab)->NextSlab;
+		}
+
+		reinterpret_cast<SlabHeader*>(lastSlab)->NextSlab = m_slabs;
+		m_slabs = other.m_slabs;
+	}
+
+	// The unused rest of the other pool's newest slab joins the free list
+	for (Slot* slot = other.m_next; slot != other.m_end; ++slot)
+	{
+		slot->Next = m_freeList;
+		m_freeList = slot;
+	}
+
+	if (other.m_freeList)
+	{
+		Slot* lastFree = other.m_freeList;
+		while (lastFree->Next)
+		{
+			lastFree = lastFree->Next;
+		}
+
+		lastFree->Next = m_freeList;
+		m_freeList = other.m_freeList;
+	}
+
+	m_capacity += other.m_capacity;
+
+	other.m_slabs = nullptr;
+	other.m_freeList = nullptr;
+	other.m_next = nullptr;
+	other.m_end = nullptr;
+	other.m_capacity = 0;
+	return true;
+}
+
+template<typename T, typename Allocator>
+inline size_t NodePool<T, Allocator>::Capacity() const
+{
+	return m_capacity;
+}
+
+template<typename T, typename Allocator>
+inline Allocator NodePool<T, Allocator>::GetAllocator() const
+{
+	return Allocator(m_allocator);
+}
+
+template<typename T, typename Allocator>
+inline typename NodePool<T, Allocator>::Slot* NodePool<T, Allocator>::AllocateSlab()
+{
+	// Slabs grow geometrically, so a pool of n objects is spread over
+	// O(log n) allocations until the maximum slab size is reached.
+	size_t objectCount = m_capacity < MinSlabSlots ? MinSlabSlots : m_capacity;
+	if (objectCount > MaxSlabSlots)
+	{
+		objectCount = MaxSlabSlots;
+	}
+
+	size_t slotCount = objectCount + HeaderSlots;
+	Slot* slab = SlotTraits::allocate(m_allocator, slotCount);
+
+	::new (static_cast<void*>(slab)) SlabHeader{ m_slabs, slotCount };
+	m_slabs = slab;
+
+	m_end = slab + slotCount;
+	m_capacity += objectCount;
+	return slab + HeaderSlots;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// LEFT LEANING NODE MEMBER FUNCTION DEFINITIONS
 //////////////////////////////////////////////////////////////////////////////
 
-template<Comparable T>
-inline void RedBlackTree<T>::Node::Fixup (std::unique_ptr<Node>& node)
+template<typename Node>
+inline void LeftLeaningNode<Node>::Fixup (Node*& node)
 {
 	if (node->IsRightRed() && node->IsLeftBlack())
 	{
@@ -168,367 +863,2188 @@ inline void RedBlackTree<T>::Node::Fixup (std::unique_ptr<Node>& node)
 	node->MoveRedUp();
 }
 
-template<Comparable T>
-inline void RedBlackTree<T>::Node::RotateLeft (std::unique_ptr<Node>& node)
+template<typename Node>
+inline void LeftLeaningNode<Node>::RotateLeft (Node*& node)
 {
-	std::unique_ptr<Node> newTop = std::move(node->Right);
+	Node* newTop = node->Right;
 
 	// Do the actual rotation
-	node->Right = std::move(newTop->Left);
-	newTop->Left = std::move(node);
+	node->Right = newTop->Left;
+	newTop->Left = node;
 
 	// Fix colours
-	bool colourTemp = newTop->Left->Black;
-	newTop->Left->Black = newTop->Black;
-	newTop->Black = colourTemp;
+	bool colourTemp = newTop->Left->IsBlack();
+	newTop->Left->SetBlack(newTop->IsBlack());
+	newTop->SetBlack(colourTemp);
 
 	// Fix left-subtree sizes
 	// node's left subtree count will stay the same
 	// but newTop's leftsubtree size will have to increase
-	// by node's left subtree size + 1
-	newTop->LeftSize += newTop->Left->LeftSize + 1;
+	// by node's left subtree size and node's own weight
+	newTop->AddLeftSize(newTop->Left->LeftSize() + newTop->Left->Weight());
+
+	// The old top is below newTop now, so it is updated first
+	newTop->Left->Update();
+	newTop->Update();
+
+	node = newTop;
+}
+
+template<typename Node>
+inline void LeftLeaningNode<Node>::RotateRight (Node*& node)
+{
+	Node* newTop = node->Left;
+
+	// Do the actual rotation
+	node->Left = newTop->Right;
+	newTop->Right = node;
+
+	// Fix colours
+	bool colourTemp = newTop->Right->IsBlack();
+	newTop->Right->SetBlack(newTop->IsBlack());
+	newTop->SetBlack(colourTemp);
+
+	// Fix left-subtree sizes
+	// newTop's left subtree size stays the same
+	// but node's left subtree size decreases by newTop's leftSize and weight
+	newTop->Right->SubtractLeftSize(newTop->LeftSize() + newTop->Weight());
+
+	newTop->Right->Update();
+	newTop->Update();
+
+	node = newTop;
+}
+
+template<typename Node>
+inline void LeftLeaningNode<Node>::MoveRedLeft (Node*& node)
+{
+	node->SwitchColours();
+	if (node->Right && node->Right->IsLeftRed())
+	{
+		RotateRight(node->Right);
+		RotateLeft(node);
+		node->SwitchColours();
+	}
+}
+
+template<typename Node>
+inline void LeftLeaningNode<Node>::MoveRedRight (Node*& node)
+{
+	node->SwitchColours();
+	if (node->Left && node->Left->IsLeftRed())
+	{
+		RotateRight(node);
+		node->SwitchColours();
+	}
+}
+
+// Links the node made by create at the place located by locate, which
+// returns where the new item lies relative to the item of a node, or
+// returns the node already holding it. The tree is left untouched until
+// create is called at the bottom, so create may also return nullptr to
+// abandon the insertion, which then returns nullptr as well.
+template<typename Node>
+template<typename Locate, typename Create>
+inline std::pair<Node*, bool> LeftLeaningNode<Node>::Link (Node*& root, Locate&& locate, Create&& create)
+{
+	// Remember every link on the way down, so that the tree can be repaired
+	// bottom-up without recursion.
+	Node** path[MaxHeight];
+	size_t depth = 0;
+
+	Node** link = &root;
+	while (*link)
+	{
+		Node* node = *link;
+		auto order = locate(node);
+		if (order == 0)
+		{
+			return std::make_pair(node, false);
+		}
+
+		path[depth++] = link;
+		link = order < 0 ? &node->Left : &node->Right;
+	}
+
+	// The node is only created once the item is known to be missing
+	Node* inserted = create();
+	if (!inserted)
+	{
+		return std::make_pair(nullptr, false);
+	}
+
+	*link = inserted;
+	path[depth] = link;
+
+	// Walk back up, updating left subtree sizes. Nothing is modified on the
+	// way down, so once the subtree we come from has a black root, none of the
+	// remaining Fixup calls can change anything and only sizes (and
+	// aggregates) need updating.
+	size_t weight = inserted->Weight();
+	bool balanced = false;
+	while (depth > 0)
+	{
+		Node** childLink = path[depth];
+		Node* node = *path[--depth];
+
+		if (childLink == &node->Left)
+		{
+			node->AddLeftSize(weight);
+		}
+
+		if (!balanced)
+		{
+			if ((*childLink)->IsBlack())
+			{
+				balanced = true;
+			}
+			else
+			{
+				Fixup(node);
+				*path[depth] = node;
+			}
+		}
+
+		node->Update();
+	}
+
+	return std::make_pair(inserted, true);
+}
+
+// Unlinks the node located by locate, which returns where the wanted item
+// lies relative to the item of a node, and gives it back with its item
+// untouched, or nullptr if there is none. Rotations on the way down can
+// change the node at the top of a subtree, but never the subtree's items,
+// so locate is asked again after each one. descend is called for every node
+// the search continues to the right of.
+template<typename Node>
+template<typename Locate, typename Descend>
+inline Node* LeftLeaningNode<Node>::Unlink (Node*& root, Locate&& locate, Descend&& descend)
+{
+	Node** path[MaxHeight];
+	bool   wentLeft[MaxHeight];
+	size_t depth = 0;
+
+	// Index of the topmost level restructured on the way down. Above it the
+	// nodes are untouched, which allows the upward pass to stop early.
+	size_t firstModified = MaxHeight;
+	auto markModified = [&]() { if (firstModified == MaxHeight) firstModified = depth; };
+
+	// The levels above the removed node lose its weight, the ones between it
+	// and the successor taking its place lose the successor's.
+	Node* removed = nullptr;
+	Node* successor = nullptr;
+	size_t targetDepth = MaxHeight;
+
+	Node** link = &root;
+	while (*link)
+	{
+		Node* node = *link;
+		auto order = locate(node);
+		if (order < 0)
+		{
+			if (node->Left && node->Left->IsBlack() && node->Left->IsLeftBlack())
+			{
+				MoveRedLeft(*link);
+				markModified();
+			}
+
+			path[depth] = link;
+			wentLeft[depth++] = true;
+			link = &(*link)->Left;
+			continue;
+		}
+
+		// Rotations at this level only ever bring a smaller item to the top,
+		// so locate needs no repeating to know it is not the item.
+		bool equal = order == 0;
+		if (node->IsLeftRed())
+		{
+			RotateRight(*link);
+			markModified();
+			node = *link;
+			equal = false;
+		}
+
+		if (equal && !node->Right)
+		{
+			*link = nullptr;
+			removed = node;
+			targetDepth = depth;
+			break;
+		}
+
+		if (node->IsRightBlack() && node->Right && node->Right->IsLeftBlack())
+		{
+			MoveRedRight(*link);
+			markModified();
+			if (*link != node)
+			{
+				node = *link;
+				equal = false;
+			}
+		}
+
+		if (!equal)
+		{
+			descend(node);
+		}
+
+		path[depth] = link;
+		wentLeft[depth++] = false;
+		link = &node->Right;
+
+		if (equal)
+		{
+			// The node has a right subtree, unlink the minimum of it
+			targetDepth = depth - 1;
+			Node* rightMin;
+			while (true)
+			{
+				if ((*link)->IsLeftBlack() && (*link)->Left && (*link)->Left->IsLeftBlack())
+				{
+					MoveRedLeft(*link);
+					markModified();
+				}
+
+				rightMin = *link;
+				if (!rightMin->Left)
+				{
+					*link = rightMin->Right;
+					break;
+				}
+
+				path[depth] = link;
+				wentLeft[depth++] = true;
+				link = &rightMin->Left;
+			}
+
+			// Then relink the minimum in place of the deleted node, so that
+			// no item has to be copied or moved. The deleted node cannot have
+			// been moved by the transformations below it.
+			Node* target = *path[targetDepth];
+			rightMin->Left = target->Left;
+			rightMin->Right = target->Right;
+			rightMin->SizeAndColour = target->SizeAndColour;
+			*path[targetDepth] = rightMin;
+			if (targetDepth + 1 < depth)
+			{
+				path[targetDepth + 1] = &rightMin->Right;
+			}
+
+			removed = target;
+			successor = rightMin;
+			break;
+		}
+	}
+
+	// Walk back up, restoring the invariants. Levels above the topmost
+	// restructured one were valid before the deletion, so as soon as the
+	// subtree we come from has a black root, the rest needs no Fixup.
+	bool balanced = false;
+	while (depth > 0)
+	{
+		Node* node = *path[--depth];
+
+		if (removed && wentLeft[depth])
+		{
+			node->SubtractLeftSize(depth < targetDepth ? removed->Weight() : successor->Weight());
+		}
+
+		if (!balanced)
+		{
+			Node* child = wentLeft[depth] ? node->Left : node->Right;
+			if (depth < firstModified && (!child || child->IsBlack()))
+			{
+				balanced = true;
+			}
+			else
+			{
+				Fixup(node);
+				*path[depth] = node;
+			}
+		}
+
+		if (removed)
+		{
+			node->Update();
+		}
+	}
+
+	return removed;
+}
+
+template<typename Node>
+template<typename Pool>
+inline void LeftLeaningNode<Node>::DestroyAll (Pool& pool, Node* node)
+{
+	// Flatten the tree into a right-leaning list on the fly, so that no stack
+	// proportional to the tree height is needed.
+	while (node)
+	{
+		if (node->Left)
+		{
+			Node* left = node->Left;
+			node->Left = left->Right;
+			left->Right = node;
+			node = left;
+		}
+		else
+		{
+			Node* right = node->Right;
+			pool.Destroy(node);
+			node = right;
+		}
+	}
+}
+
+template<typename Node>
+inline void LeftLeaningNode<Node>::PushLeftSpine (const Node** path, size_t& depth, const Node* node)
+{
+	for (; node; node = node->Left)
+	{
+		path[depth++] = node;
+	}
+}
+
+template<typename Node>
+inline void LeftLeaningNode<Node>::PushRightSpine (const Node** path, size_t& depth, const Node* node)
+{
+	for (; node; node = node->Right)
+	{
+		path[depth++] = node;
+	}
+}
+
+// Moves a path from the root to the next node in order, or empties it after
+// the last one.
+template<typename Node>
+inline void LeftLeaningNode<Node>::Next (const Node** path, size_t& depth)
+{
+	const Node* node = path[depth - 1];
+	if (node->Right)
+	{
+		PushLeftSpine(path, depth, node->Right);
+	}
+	else
+	{
+		// Climb until we leave a left subtree, its parent is the successor
+		const Node* child;
+		do
+		{
+			child = path[--depth];
+		} while (depth > 0 && path[depth - 1]->Right == child);
+	}
+}
+
+// Moves a path from the root to the previous node in order, where an empty
+// path steps back from the end to the maximum.
+template<typename Node>
+inline void LeftLeaningNode<Node>::Previous (const Node** path, size_t& depth, const Node* root)
+{
+	if (depth == 0)
+	{
+		PushRightSpine(path, depth, root);
+	}
+	else if (path[depth - 1]->Left)
+	{
+		PushRightSpine(path, depth, path[depth - 1]->Left);
+	}
+	else
+	{
+		// Climb until we leave a right subtree, its parent is the predecessor
+		const Node* child;
+		do
+		{
+			child = path[--depth];
+		} while (depth > 0 && path[depth - 1]->Left == child);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// REDBLACKTREE::NODE MEMDER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K, typename Create>
+inline std::pair<typename RedBlackTree<T, Compare, Allocator, Augment>::Node*, bool> RedBlackTree<T, Compare, Allocator, Augment>::Node::Insert (Node*& root, const K& item, const Compare& compare, Create&& create)
+{
+	return Link(root, [&](const Node* node)
+	{
+		return CompareOrder(compare, item, node->Item);
+	}, std::forward<Create>(create));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Node::Delete (Pool& pool, Node*& root, const K& item, const Compare& compare)
+{
+	Node* removed = Unlink(root, [&](const Node* node)
+	{
+		return CompareOrder(compare, item, node->Item);
+	}, [](const Node*) {});
+
+	if (!removed)
+	{
+		return false;
+	}
+
+	pool.Destroy(removed);
+	return true;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Node::MoveItems (Node* node, std::vector<T>& items)
+{
+	Node*  path[MaxHeight];
+	size_t depth = 0;
+	while (node || depth > 0)
+	{
+		for (; node; node = node->Left)
+		{
+			path[depth++] = node;
+		}
+
+		node = path[--depth];
+		items.push_back(std::move(node->Item));
+		node = node->Right;
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename InputIt>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Node* RedBlackTree<T, Compare, Allocator, Augment>::Node::Build (Pool& pool, InputIt& first, size_t count, size_t capacity)
+{
+	// Builds the LLRB equivalent of a 2-3 tree holding count items in order,
+	// where capacity = 3^h - 1 is the most a 2-3 tree of height h can hold.
+	// A 2-node becomes a single black node, a 3-node a black node with a red
+	// left child. Splitting the items evenly among the children keeps every
+	// child between 2^(h-1) - 1 and 3^(h-1) - 1 items, so all leaves end up at
+	// the same depth.
+	if (count == 0)
+	{
+		return nullptr;
+	}
+
+	size_t childCapacity = (capacity - 2) / 3;
+	bool threeNode = count - 1 > 2 * childCapacity;
+
+	size_t childCounts[3];
+	if (threeNode)
+	{
+		childCounts[0] = (count - 2) / 3;
+		childCounts[1] = (count - 2 - childCounts[0]) / 2;
+		childCounts[2] = count - 2 - childCounts[0] - childCounts[1];
+	}
+	else
+	{
+		childCounts[0] = (count - 1) / 2;
+		childCounts[1] = count - 1 - childCounts[0];
+	}
+
+	// Items are consumed strictly in order, so a single pass over the input
+	// suffices. If anything throws, the subtrees built so far are destroyed.
+	Node* children[3] = { nullptr, nullptr, nullptr };
+	Node* red = nullptr;
+	Node* black = nullptr;
+	try
+	{
+		children[0] = Build(pool, first, childCounts[0], childCapacity);
+		if (threeNode)
+		{
+			red = pool.Create(*first);
+			++first;
+			children[1] = Build(pool, first, childCounts[1], childCapacity);
+		}
+
+		black = pool.Create(*first);
+		++first;
+		children[threeNode ? 2 : 1] = Build(pool, first, childCounts[threeNode ? 2 : 1], childCapacity);
+	}
+	catch (...)
+	{
+		for (Node* child : children) DestroyAll(pool, child);
+		if (red) pool.Destroy(red);
+		if (black) pool.Destroy(black);
+		throw;
+	}
+
+	black->SetBlack(true);
+	if (threeNode)
+	{
+		red->Left = children[0];
+		red->Right = children[1];
+		red->SetLeftSize(childCounts[0]);
+		red->Update();
+
+		black->Left = red;
+		black->Right = children[2];
+		black->SetLeftSize(childCounts[0] + 1 + childCounts[1]);
+	}
+	else
+	{
+		black->Left = children[0];
+		black->Right = children[1];
+		black->SetLeftSize(childCounts[0]);
+	}
+
+	black->Update();
+	return black;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K>
+inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackTree<T, Compare, Allocator, Augment>::Node::Find (const Node* node, const K& item, const Compare& compare)
+{
+	size_t index = 0;
+	while (node)
+	{
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order == 0)
+		{
+			return std::make_pair(index + node->LeftSize(), std::ref(node->Item));
+		}
+
+		if (order < 0)
+		{
+			node = node->Left;
+		}
+		else
+		{
+			index += node->LeftSize() + 1;
+			node = node->Right;
+		}
+	}
+
+	return std::make_pair((size_t)-1, std::ref(s_default));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Node::FindMany (const Node* root, std::span<const T> items, std::span<size_t> indices, const Compare& compare)
+{
+	// A single search waits for one cache miss per level. Walking a number of
+	// searches in turns and prefetching the next node of each lets the misses
+	// overlap, and a finished search is immediately replaced by the next one.
+	constexpr size_t MaxLanes = 16;
+	struct Lane
+	{
+		const Node* Current;
+		size_t Index;
+		size_t Item;
+	};
+
+	Lane lanes[MaxLanes];
+	size_t next = 0;
+	size_t active = 0;
+	while (active < MaxLanes && next < items.size())
+	{
+		lanes[active++] = Lane{ root, 0, next++ };
+	}
+
+	while (active > 0)
+	{
+		for (size_t lane = 0; lane < active;)
+		{
+			const Node* node = lanes[lane].Current;
+			if (node)
+			{
+				auto order = CompareOrder(compare, items[lanes[lane].Item], node->Item);
+				if (order != 0)
+				{
+					if (order < 0)
+					{
+						node = node->Left;
+					}
+					else
+					{
+						lanes[lane].Index += node->LeftSize() + 1;
+						node = node->Right;
+					}
+
+					RBT_PREFETCH(node);
+					lanes[lane++].Current = node;
+					continue;
+				}
+			}
+
+			indices[lanes[lane].Item] = node ? lanes[lane].Index + node->LeftSize() : (size_t)-1;
+			if (next < items.size())
+			{
+				lanes[lane++] = Lane{ root, 0, next++ };
+			}
+			else
+			{
+				lanes[lane] = lanes[--active];
+			}
+		}
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline const T& RedBlackTree<T, Compare, Allocator, Augment>::Node::At (const Node* node, size_t index)
+{
+	while (node)
+	{
+		if (node->LeftSize() == index)
+		{
+			return node->Item;
+		}
+
+		if (index < node->LeftSize())
+		{
+			node = node->Left;
+		}
+		else
+		{
+			index -= node->LeftSize() + 1;
+			node = node->Right;
+		}
+	}
+
+	return s_default;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::Node::Rank (const Node* node, const T& item, const Compare& compare)
+{
+	size_t index = 0;
+	while (node)
+	{
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order == 0)
+		{
+			return index + node->LeftSize();
+		}
+
+		if (order < 0)
+		{
+			node = node->Left;
+		}
+		else
+		{
+			index += node->LeftSize() + 1;
+			node = node->Right;
+		}
+	}
+
+	return index;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Node::Contains (const Node* node, const K& item, const Compare& compare)
+{
+	while (node)
+	{
+		auto order = CompareOrder(compare, item, node->Item);
+		if (order == 0)
+		{
+			return true;
+		}
+
+		node = order < 0 ? node->Left : node->Right;
+	}
+
+	return false;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Node::MakeSubtree (Node* root, size_t size)
+{
+	Subtree tree{ root, 0, size };
+	if (root)
+	{
+		root->SetBlack(true);
+	}
+
+	for (const Node* node = root; node; node = node->Left)
+	{
+		tree.BlackHeight += node->IsBlack();
+	}
+
+	return tree;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Node::Blacken (Subtree& tree)
+{
+	// A red root can always be made black, it just adds a level
+	if (tree.Root && tree.Root->IsRed())
+	{
+		tree.Root->SetBlack(true);
+		++tree.BlackHeight;
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline std::pair<typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree, typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree> RedBlackTree<T, Compare, Allocator, Augment>::Node::Children (const Subtree& tree)
+{
+	Node* root = tree.Root;
+	size_t blackHeight = tree.BlackHeight - root->IsBlack();
+	return std::make_pair(Subtree{ root->Left, blackHeight, root->LeftSize() }, Subtree{ root->Right, blackHeight, tree.Size - root->LeftSize() - 1 });
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Node::Join (Subtree left, Node* pivot, Subtree right)
+{
+	Blacken(left);
+	Blacken(right);
+
+	size_t size = left.Size + 1 + right.Size;
+	if (left.BlackHeight == right.BlackHeight)
+	{
+		pivot->Left = left.Root;
+		pivot->Right = right.Root;
+		pivot->SizeAndColour = BlackBit | left.Size;
+		pivot->Update();
+		return Subtree{ pivot, left.BlackHeight + 1, size };
+	}
+
+	// Walk down the spine of the taller tree facing the shorter one, to the
+	// first black node of the same black height. The pivot takes its place
+	// as a red node with the two equally high trees as children, which is no
+	// different from inserting a red leaf, so Fixup repairs the rest.
+	bool intoLeft = left.BlackHeight > right.BlackHeight;
+	Subtree& taller = intoLeft ? left : right;
+	size_t shorterHeight = intoLeft ? right.BlackHeight : left.BlackHeight;
+
+	Node** path[MaxHeight];
+	size_t depth = 0;
+
+	Node** link = &taller.Root;
+	size_t blackHeight = taller.BlackHeight;
+	size_t linkSize = taller.Size;
+	while (*link && !((*link)->IsBlack() && blackHeight == shorterHeight))
+	{
+		Node* node = *link;
+		blackHeight -= node->IsBlack();
+		path[depth++] = link;
+
+		if (intoLeft)
+		{
+			linkSize -= node->LeftSize() + 1;
+			link = &node->Right;
+		}
+		else
+		{
+			node->AddLeftSize(left.Size + 1);
+			link = &node->Left;
+		}
+	}
+
+	pivot->Left = intoLeft ? *link : left.Root;
+	pivot->Right = intoLeft ? right.Root : *link;
+	pivot->SizeAndColour = intoLeft ? linkSize : left.Size;
+	pivot->Update();
+	*link = pivot;
+
+	// The sizes are up to date, so the repair stops at the first black child.
+	// Aggregates still change all the way up.
+	bool balanced = false;
+	while (depth > 0)
+	{
+		Node* node = *path[--depth];
+		Node* child = intoLeft ? node->Right : node->Left;
+		if (!balanced && child->IsBlack())
+		{
+			balanced = true;
+		}
+
+		if (!balanced)
+		{
+			Fixup(node);
+			*path[depth] = node;
+		}
+		else if constexpr (!IsAugmented)
+		{
+			break;
+		}
+
+		node->Update();
+	}
+
+	return Subtree{ taller.Root, taller.BlackHeight, size };
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Node::Concatenate (Subtree left, Subtree right)
+{
+	if (!left.Root)
+	{
+		return right;
+	}
+
+	if (!right.Root)
+	{
+		return left;
+	}
+
+	auto [rest, maximum] = SplitMax(left);
+	return Join(rest, maximum, right);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K>
+inline std::tuple<typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree, typename RedBlackTree<T, Compare, Allocator, Augment>::Node*, typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree> RedBlackTree<T, Compare, Allocator, Augment>::Node::Split (const Subtree& tree, const K& item, const Compare& compare)
+{
+	// Every node on the way is joined back to the part it belongs to, the
+	// joins cost the difference of black heights, which adds up to O(log n).
+	if (!tree.Root)
+	{
+		return std::make_tuple(tree, nullptr, tree);
+	}
+
+	Node* node = tree.Root;
+	auto [left, right] = Children(tree);
+	auto order = CompareOrder(compare, item, node->Item);
+	if (order == 0)
+	{
+		return std::make_tuple(left, node, right);
+	}
+
+	if (order < 0)
+	{
+		auto [low, found, high] = Split(left, item, compare);
+		return std::make_tuple(low, found, Join(high, node, right));
+	}
+
+	auto [low, found, high] = Split(right, item, compare);
+	return std::make_tuple(Join(left, node, low), found, high);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline std::pair<typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree, typename RedBlackTree<T, Compare, Allocator, Augment>::Node*> RedBlackTree<T, Compare, Allocator, Augment>::Node::SplitMax (const Subtree& tree)
+{
+	Node* node = tree.Root;
+	auto [left, right] = Children(tree);
+	if (!right.Root)
+	{
+		return std::make_pair(left, node);
+	}
+
+	auto [rest, maximum] = SplitMax(right);
+	return std::make_pair(Join(left, node, rest), maximum);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Node::Union (Subtree a, Subtree b, const Compare& compare, std::vector<Node*>& discarded, size_t forkDepth)
+{
+	if (!a.Root)
+	{
+		return b;
+	}
+
+	if (!b.Root)
+	{
+		return a;
+	}
+
+	// Split b around the root of a and merge the halves independently. The
+	// nodes are only relinked, the one duplicate is dropped.
+	Node* pivot = a.Root;
+	auto [aLeft, aRight] = Children(a);
+	auto [bLeft, duplicate, bRight] = Split(b, pivot->Item, compare);
+	if (duplicate)
+	{
+		duplicate->Left = duplicate->Right = nullptr;
+		discarded.push_back(duplicate);
+	}
+
+	bool fork = forkDepth > 0 && a.Size + b.Size >= ParallelThreshold;
+	size_t childDepth = fork ? forkDepth - 1 : forkDepth;
+	std::vector<Node*> forkDiscarded;
+
+	Subtree left, right;
+	ForkJoin(fork,
+		[&]() { left = Union(aLeft, bLeft, compare, discarded, childDepth); },
+		[&]() { right = Union(aRight, bRight, compare, fork ? forkDiscarded : discarded, childDepth); });
+
+	discarded.insert(discarded.end(), forkDiscarded.begin(), forkDiscarded.end());
+	return Join(left, pivot, right);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Node::Intersection (Subtree a, Subtree b, const Compare& compare, std::vector<Node*>& discarded, size_t forkDepth)
+{
+	if (!a.Root || !b.Root)
+	{
+		for (Node* root : { a.Root, b.Root })
+		{
+			if (root)
+			{
+				discarded.push_back(root);
+			}
+		}
+
+		return Subtree{ nullptr, 0, 0 };
+	}
+
+	Node* pivot = a.Root;
+	auto [aLeft, aRight] = Children(a);
+	auto [bLeft, duplicate, bRight] = Split(b, pivot->Item, compare);
+
+	bool fork = forkDepth > 0 && a.Size + b.Size >= ParallelThreshold;
+	size_t childDepth = fork ? forkDepth - 1 : forkDepth;
+	std::vector<Node*> forkDiscarded;
+
+	Subtree left, right;
+	ForkJoin(fork,
+		[&]() { left = Intersection(aLeft, bLeft, compare, discarded, childDepth); },
+		[&]() { right = Intersection(aRight, bRight, compare, fork ? forkDiscarded : discarded, childDepth); });
+
+	discarded.insert(discarded.end(), forkDiscarded.begin(), forkDiscarded.end());
+
+	// Keep the pivot if it was in both trees, drop it otherwise
+	Node* dropped = duplicate ? duplicate : pivot;
+	dropped->Left = dropped->Right = nullptr;
+	discarded.push_back(dropped);
+
+	return duplicate ? Join(left, pivot, right) : Concatenate(left, right);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Node::Difference (Subtree a, Subtree b, const Compare& compare, std::vector<Node*>& discarded, size_t forkDepth)
+{
+	if (!a.Root || !b.Root)
+	{
+		if (b.Root)
+		{
+			discarded.push_back(b.Root);
+		}
+
+		return a;
+	}
+
+	Node* pivot = b.Root;
+	auto [bLeft, bRight] = Children(b);
+	auto [aLeft, removed, aRight] = Split(a, pivot->Item, compare);
+	for (Node* dropped : { pivot, removed })
+	{
+		if (dropped)
+		{
+			dropped->Left = dropped->Right = nullptr;
+			discarded.push_back(dropped);
+		}
+	}
+
+	bool fork = forkDepth > 0 && a.Size + b.Size >= ParallelThreshold;
+	size_t childDepth = fork ? forkDepth - 1 : forkDepth;
+	std::vector<Node*> forkDiscarded;
+
+	Subtree left, right;
+	ForkJoin(fork,
+		[&]() { left = Difference(aLeft, bLeft, compare, discarded, childDepth); },
+		[&]() { right = Difference(aRight, bRight, compare, fork ? forkDiscarded : discarded, childDepth); });
+
+	discarded.insert(discarded.end(), forkDiscarded.begin(), forkDiscarded.end());
+	return Concatenate(left, right);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Node::Difference (Subtree a, std::span<const T> b, const Compare& compare, std::vector<Node*>& discarded, size_t forkDepth)
+{
+	if (!a.Root || b.empty())
+	{
+		return a;
+	}
+
+	// Same as with a tree, with the sorted items split at their median in
+	// place of the root, so no nodes are made for them.
+	size_t middle = b.size() / 2;
+	auto [aLeft, removed, aRight] = Split(a, b[middle], compare);
+	if (removed)
+	{
+		removed->Left = removed->Right = nullptr;
+		discarded.push_back(removed);
+	}
+
+	bool fork = forkDepth > 0 && a.Size + b.size() >= ParallelThreshold;
+	size_t childDepth = fork ? forkDepth - 1 : forkDepth;
+	std::vector<Node*> forkDiscarded;
+
+	Subtree left, right;
+	ForkJoin(fork,
+		[&]() { left = Difference(aLeft, b.first(middle), compare, discarded, childDepth); },
+		[&]() { right = Difference(aRight, b.subspan(middle + 1), compare, fork ? forkDiscarded : discarded, childDepth); });
+
+	discarded.insert(discarded.end(), forkDiscarded.begin(), forkDiscarded.end());
+	return Concatenate(left, right);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename First, typename Second>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Node::ForkJoin (bool fork, First&& first, Second&& second)
+{
+	// The two halves share no nodes and allocate nothing, so they can run on
+	// different threads without any synchronisation.
+	if (fork)
+	{
+		auto forked = std::async(std::launch::async, std::forward<Second>(second));
+		first();
+		forked.get();
+	}
+	else
+	{
+		first();
+		second();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// REDBLACKTREE::ITERATOR MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::Iterator::Iterator()
+	: m_tree(nullptr), m_index(0), m_depth(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::Iterator::Iterator(const Iterator& other)
+	: m_tree(other.m_tree), m_index(other.m_index), m_depth(other.m_depth)
+{
+	std::copy(other.m_path, other.m_path + other.m_depth, m_path);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator& RedBlackTree<T, Compare, Allocator, Augment>::Iterator::operator=(const Iterator& other)
+{
+	// Only the used part of the path is copied
+	m_tree = other.m_tree;
+	m_index = other.m_index;
+	m_depth = other.m_depth;
+	std::copy(other.m_path, other.m_path + other.m_depth, m_path);
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator::reference RedBlackTree<T, Compare, Allocator, Augment>::Iterator::operator*() const
+{
+	return m_path[m_depth - 1]->Item;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator::pointer RedBlackTree<T, Compare, Allocator, Augment>::Iterator::operator->() const
+{
+	return &m_path[m_depth - 1]->Item;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator& RedBlackTree<T, Compare, Allocator, Augment>::Iterator::operator++()
+{
+	Node::Next(m_path, m_depth);
+	++m_index;
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator RedBlackTree<T, Compare, Allocator, Augment>::Iterator::operator++(int)
+{
+	Iterator previous = *this;
+	++*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator& RedBlackTree<T, Compare, Allocator, Augment>::Iterator::operator--()
+{
+	// Stepping back from the end lands on the maximum
+	Node::Previous(m_path, m_depth, m_tree->m_root);
+	--m_index;
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator RedBlackTree<T, Compare, Allocator, Augment>::Iterator::operator--(int)
+{
+	Iterator previous = *this;
+	--*this;
+	return previous;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Iterator::operator==(const Iterator& other) const
+{
+	const Node* current = m_depth ? m_path[m_depth - 1] : nullptr;
+	const Node* otherCurrent = other.m_depth ? other.m_path[other.m_depth - 1] : nullptr;
+	return current == otherCurrent;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::Iterator::Index() const
+{
+	return m_index;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Iterator::PushLeftSpine(const Node* node)
+{
+	Node::PushLeftSpine(m_path, m_depth, node);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Iterator::PushRightSpine(const Node* node)
+{
+	Node::PushRightSpine(m_path, m_depth, node);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// REDBLACKTREE::NODEHANDLE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle::NodeHandle()
+	: m_pool(nullptr), m_node(nullptr)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle::NodeHandle(Pool* pool, Node* node)
+	: m_pool(pool), m_node(node)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle::NodeHandle(NodeHandle&& other) noexcept
+	: m_pool(other.m_pool), m_node(other.m_node)
+{
+	other.m_node = nullptr;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle& RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle::operator=(NodeHandle&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (m_node)
+		{
+			m_pool->Destroy(m_node);
+		}
+
+		m_pool = other.m_pool;
+		m_node = other.m_node;
+		other.m_node = nullptr;
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle::~NodeHandle()
+{
+	if (m_node)
+	{
+		m_pool->Destroy(m_node);
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle::Empty() const
+{
+	return !m_node;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle::operator bool() const
+{
+	return m_node;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline T& RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle::Item() const
+{
+	return m_node->Item;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// REDBLACKTREE::FINGER MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::Finger::Finger(const RedBlackTree& tree)
+	: m_tree(&tree), m_depth(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackTree<T, Compare, Allocator, Augment>::Finger::Find(const T& item)
+{
+	return Search(item);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<HeterogeneousKey<T, Compare> K>
+inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackTree<T, Compare, Allocator, Augment>::Finger::Find(const K& key)
+{
+	return Search(key);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Finger::Contains(const T& item)
+{
+	return Search(item).first != (size_t)-1;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<HeterogeneousKey<T, Compare> K>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Finger::Contains(const K& key)
+{
+	return Search(key).first != (size_t)-1;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Finger::Reset()
+{
+	m_depth = 0;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K>
+inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackTree<T, Compare, Allocator, Augment>::Finger::Search(const K& key)
+{
+	const Compare& compare = m_tree->m_compare;
+
+	// Climb until the subtree's range holds the key. The bounds only widen
+	// going up, so each side needs comparing only until it first holds, and
+	// the climb costs about one comparison per level.
+	Level level = { m_tree->m_root, 0, nullptr, nullptr };
+	bool aboveLow = false;
+	bool belowHigh = false;
+	while (m_depth > 0)
+	{
+		const Level& candidate = m_path[m_depth - 1];
+		aboveLow = aboveLow || !candidate.Low || CompareLess(compare, candidate.Low->Item, key);
+		belowHigh = belowHigh || !candidate.High || CompareLess(compare, key, candidate.High->Item);
+		if (aboveLow && belowHigh)
+		{
+			level = candidate;
+			--m_depth;
+			break;
+		}
+
+		--m_depth;
+	}
+
+	// Then descend as usual, recording the path for the next search
+	const Node* node = level.Root;
+	while (node)
+	{
+		level.Root = node;
+		m_path[m_depth++] = level;
+
+		auto order = CompareOrder(compare, key, node->Item);
+		if (order == 0)
+		{
+			return std::make_pair(level.Offset + node->LeftSize(), std::cref(node->Item));
+		}
+
+		if (order < 0)
+		{
+			level.High = node;
+			node = node->Left;
+		}
+		else
+		{
+			level.Offset += node->LeftSize() + 1;
+			level.Low = node;
+			node = node->Right;
+		}
+	}
+
+	return std::make_pair((size_t)-1, std::cref(Node::s_default));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// REDBLACKTREE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::RedBlackTree()
+	: m_compare(), m_pool(), m_root(nullptr), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::RedBlackTree(const Allocator& allocator)
+	: m_compare(), m_pool(allocator), m_root(nullptr), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::RedBlackTree(const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_pool(allocator), m_root(nullptr), m_treeSize(0)
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<std::input_iterator InputIt>
+inline RedBlackTree<T, Compare, Allocator, Augment>::RedBlackTree(InputIt first, InputIt last, const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_pool(allocator), m_root(nullptr), m_treeSize(0)
+{
+	Assign(first, last);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<std::input_iterator InputIt>
+inline RedBlackTree<T, Compare, Allocator, Augment>::RedBlackTree(SortedUniqueTag, InputIt first, InputIt last, const Compare& compare, const Allocator& allocator)
+	: m_compare(compare), m_pool(allocator), m_root(nullptr), m_treeSize(0)
+{
+	Assign(SortedUnique, first, last);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::RedBlackTree(RedBlackTree&& other) noexcept
+	: m_compare(std::move(other.m_compare)), m_pool(std::move(other.m_pool)), m_root(std::exchange(other.m_root, nullptr)), m_treeSize(std::exchange(other.m_treeSize, 0))
+#ifdef PROVIDE_DATA_STRUCTURE
+	, m_reference(std::move(other.m_reference))
+#endif
+{}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>& RedBlackTree<T, Compare, Allocator, Augment>::operator=(RedBlackTree&& other) noexcept
+{
+	if (this != &other)
+	{
+		Clear();
+		m_compare = std::move(other.m_compare);
+		m_pool = std::move(other.m_pool);
+		m_root = std::exchange(other.m_root, nullptr);
+		m_treeSize = std::exchange(other.m_treeSize, 0);
+#ifdef PROVIDE_DATA_STRUCTURE
+		m_reference = std::move(other.m_reference);
+#endif
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment>::~RedBlackTree()
+{
+	Clear();
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Insert(const T& item)
+{
+	return InsertWith(item, [&]() { return m_pool.Create(item); }).second;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Insert(T&& item)
+{
+	// The item is only moved from once its place in the tree is known
+	return InsertWith(item, [&]() { return m_pool.Create(std::move(item)); }).second;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Insert(Iterator hint, const T& item)
+{
+	return InsertNear(hint.Index(), item, [&]() { return m_pool.Create(item); });
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Insert(Iterator hint, T&& item)
+{
+	return InsertNear(hint.Index(), item, [&]() { return m_pool.Create(std::move(item)); });
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Insert(NodeHandle&& handle)
+{
+	if (!handle)
+	{
+		return false;
+	}
+
+	// A node of another tree's pool cannot be linked here, only its item
+	// can be moved over.
+	Node* node = handle.m_node;
+	if (handle.m_pool != &m_pool)
+	{
+		bool inserted = InsertWith(node->Item, [&]() { return m_pool.Create(std::move(node->Item)); }).second;
+		if (inserted)
+		{
+			handle = NodeHandle();
+		}
+
+		return inserted;
+	}
+
+	// The node is reset to a new leaf, as if created for its possibly
+	// changed item. A duplicate leaves it with the handle.
+	node->SizeAndColour = 0;
+	node->Left = nullptr;
+	node->Right = nullptr;
+	node->Update();
+
+	bool inserted = InsertWith(node->Item, [node]() { return node; }).second;
+	if (inserted)
+	{
+		handle.m_node = nullptr;
+	}
+
+	return inserted;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::InsertAt(size_t index, const T& item)
+{
+	return InsertNear(index, item, [&]() { return m_pool.Create(item); });
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::InsertAt(size_t index, T&& item)
+{
+	return InsertNear(index, item, [&]() { return m_pool.Create(std::move(item)); });
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename... Args>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Emplace(Args&&... args)
+{
+	// The item has to exist before it can be compared, so it is constructed
+	// directly in a node, which is returned to the pool if it is a duplicate.
+	Node* created = m_pool.Create(std::forward<Args>(args)...);
+	bool inserted = InsertWith(created->Item, [created]() { return created; }).second;
+	if (!inserted)
+	{
+		m_pool.Destroy(created);
+	}
+
+	return inserted;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Delete(const T& item)
+{
+#ifdef PROVIDE_DATA_STRUCTURE
+	// The item may live in the node being deleted
+	ReferenceDelete(item);
+#endif
+
+	bool deleteResult = Node::Delete(m_pool, m_root, item, m_compare);
+	m_treeSize -= deleteResult;
+
+	return deleteResult;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<HeterogeneousKey<T, Compare> K>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Delete(const K& key)
+{
+#ifdef PROVIDE_DATA_STRUCTURE
+	ReferenceDelete(key);
+#endif
+
+	bool deleteResult = Node::Delete(m_pool, m_root, key, m_compare);
+	m_treeSize -= deleteResult;
+
+	return deleteResult;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Delete(Iterator position)
+{
+	return DeleteAt(position.Index());
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::DeleteAt(size_t index)
+{
+	Node* removed = UnlinkAt(index);
+	if (!removed)
+	{
+		return false;
+	}
+
+	m_pool.Destroy(removed);
+	return true;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle RedBlackTree<T, Compare, Allocator, Augment>::Extract(const T& item)
+{
+	return NodeHandle(&m_pool, UnlinkKey(item));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<HeterogeneousKey<T, Compare> K>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::NodeHandle RedBlackTree<T, Compare, Allocator, Augment>::Extract(const K& key)
+{
+	return NodeHandle(&m_pool, UnlinkKey(key));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline std::optional<T> RedBlackTree<T, Compare, Allocator, Augment>::ExtractAt(size_t index)
+{
+	Node* removed = UnlinkAt(index);
+	if (!removed)
+	{
+		return std::nullopt;
+	}
+
+	std::optional<T> item(std::move(removed->Item));
+	m_pool.Destroy(removed);
+	return item;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline std::optional<T> RedBlackTree<T, Compare, Allocator, Augment>::PopMin()
+{
+	return ExtractAt(0);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline std::optional<T> RedBlackTree<T, Compare, Allocator, Augment>::PopMax()
+{
+	return ExtractAt(m_treeSize - 1);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Node* RedBlackTree<T, Compare, Allocator, Augment>::UnlinkAt(size_t index)
+{
+	if (index >= m_treeSize)
+	{
+		return nullptr;
+	}
+
+#ifdef PROVIDE_DATA_STRUCTURE
+	ReferenceDelete(Node::At(m_root, index));
+#endif
+
+	// Steers by the subtree sizes alone, so the node is found and unlinked
+	// in a single descent without comparing any items.
+	Node* removed = Node::Unlink(m_root, [&](const Node* node)
+	{
+		return index <=> node->LeftSize();
+	}, [&](const Node* node)
+	{
+		index -= node->LeftSize() + 1;
+	});
+
+	--m_treeSize;
+	return removed;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Node* RedBlackTree<T, Compare, Allocator, Augment>::UnlinkKey(const K& key)
+{
+#ifdef PROVIDE_DATA_STRUCTURE
+	ReferenceDelete(key);
+#endif
+
+	Node* removed = Node::Unlink(m_root, [&](const Node* node)
+	{
+		return CompareOrder(m_compare, key, node->Item);
+	}, [](const Node*) {});
+
+	m_treeSize -= removed != nullptr;
+	return removed;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Clear()
+{
+	// With trivially destructible items there is nothing to run per node, so
+	// the whole pool can be handed back slab by slab.
+	if constexpr (!std::is_trivially_destructible_v<T>)
+	{
+		Node::DestroyAll(m_pool, m_root);
+	}
+
+	m_pool.Release();
+	m_root = nullptr;
+	m_treeSize = 0;
+
+#ifdef PROVIDE_DATA_STRUCTURE
+	m_reference.clear();
+#endif
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<std::input_iterator InputIt>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Assign(InputIt first, InputIt last)
+{
+	std::vector<T> items(first, last);
+	SortUnique(items);
+
+	Assign(SortedUnique, std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<std::input_iterator InputIt>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Assign(SortedUniqueTag, InputIt first, InputIt last)
+{
+	if constexpr (!std::forward_iterator<InputIt>)
+	{
+		// The size has to be known upfront to shape the tree
+		std::vector<T> items(first, last);
+		Assign(SortedUnique, items.begin(), items.end());
+	}
+	else
+	{
+		Clear();
+
+		size_t count = (size_t)std::distance(first, last);
+		size_t capacity = 0;
+		while (capacity < count)
+		{
+			capacity = capacity * 3 + 2;
+		}
+
+		m_root = Node::Build(m_pool, first, count, capacity);
+		m_treeSize = count;
+
+#ifdef PROVIDE_DATA_STRUCTURE
+		ReferenceRebuild();
+#endif
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment> RedBlackTree<T, Compare, Allocator, Augment>::Join(RedBlackTree&& left, const T& pivot, RedBlackTree&& right)
+{
+	RedBlackTree result(std::move(left));
+	Subtree rightTree = result.Adopt(right);
+	Subtree joined = Node::Join(result.Whole(), result.m_pool.Create(pivot), rightTree);
+
+	std::vector<Node*> discarded;
+	result.Assume(joined, discarded);
+	return result;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline RedBlackTree<T, Compare, Allocator, Augment> RedBlackTree<T, Compare, Allocator, Augment>::Split(const T& item)
+{
+	auto [low, found, high] = Node::Split(Whole(), item, m_compare);
+	if (found)
+	{
+		high = Node::Join(Subtree{ nullptr, 0, 0 }, found, high);
+	}
+
+	// Nodes cannot leave their pool, so the smaller part is moved into new
+	// nodes of a fresh pool and the larger one keeps the existing pool.
+	RedBlackTree result(m_compare, Allocator(m_pool.GetAllocator()));
+	if (high.Size <= low.Size)
+	{
+		result.m_root = Relocate(m_pool, result.m_pool, high);
+		result.m_treeSize = high.Size;
+		m_root = low.Root;
+		m_treeSize = low.Size;
+	}
+	else
+	{
+		result.m_pool = std::move(m_pool);
+		result.m_root = high.Root;
+		result.m_treeSize = high.Size;
+		m_pool = Pool(result.m_pool.GetAllocator());
+		m_root = Relocate(result.m_pool, m_pool, low);
+		m_treeSize = low.Size;
+	}
+
+#ifdef PROVIDE_DATA_STRUCTURE
+	ReferenceRebuild();
+	result.ReferenceRebuild();
+#endif
+
+	return result;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Union(RedBlackTree&& other)
+{
+	if (this == &other)
+	{
+		return;
+	}
+
+	std::vector<Node*> discarded;
+	Subtree otherTree = Adopt(other);
+	Assume(Node::Union(Whole(), otherTree, m_compare, discarded, ForkDepth()), discarded);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Intersection(RedBlackTree&& other)
+{
+	if (this == &other)
+	{
+		return;
+	}
+
+	std::vector<Node*> discarded;
+	Subtree otherTree = Adopt(other);
+	Assume(Node::Intersection(Whole(), otherTree, m_compare, discarded, ForkDepth()), discarded);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Difference(RedBlackTree&& other)
+{
+	if (this == &other)
+	{
+		Clear();
+		return;
+	}
+
+	std::vector<Node*> discarded;
+	Subtree otherTree = Adopt(other);
+	Assume(Node::Difference(Whole(), otherTree, m_compare, discarded, ForkDepth()), discarded);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::InsertBatch(std::span<const T> items)
+{
+	// The batch becomes a tree of its own in this tree's pool, which is then
+	// merged in with a parallel union. Items already contained are dropped.
+	std::vector<T> batch(items.begin(), items.end());
+	SortUnique(batch);
+
+	size_t sizeBefore = m_treeSize;
+	Subtree batchTree = Node::MakeSubtree(BuildFrom(m_pool, batch), batch.size());
+
+	std::vector<Node*> discarded;
+	Assume(Node::Union(Whole(), batchTree, m_compare, discarded, ForkDepth()), discarded);
+	return m_treeSize - sizeBefore;
+}
 
-	node = std::move(newTop);
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::DeleteBatch(std::span<const T> items)
+{
+	// The tree is split around the sorted items directly, so deleting does
+	// not allocate nodes for them.
+	std::vector<T> batch(items.begin(), items.end());
+	SortUnique(batch);
+
+	size_t sizeBefore = m_treeSize;
+	std::vector<Node*> discarded;
+	Assume(Node::Difference(Whole(), std::span<const T>(batch), m_compare, discarded, ForkDepth()), discarded);
+	return sizeBefore - m_treeSize;
 }
 
-template<Comparable T>
-inline void RedBlackTree<T>::Node::RotateRight (std::unique_ptr<Node>& node)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackTree<T, Compare, Allocator, Augment>::Find(const T& item) const
 {
-	std::unique_ptr<Node> newTop = std::move(node->Left);
+	return Node::Find(m_root, item, m_compare);
+}
 
-	// Do the actual rotation
-	node->Left = std::move(newTop->Right);
-	newTop->Right = std::move(node);
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<HeterogeneousKey<T, Compare> K>
+inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackTree<T, Compare, Allocator, Augment>::Find(const K& key) const
+{
+	return Node::Find(m_root, key, m_compare);
+}
 
-	// Fix colours
-	bool colourTemp = newTop->Right->Black;
-	newTop->Right->Black = newTop->Black;
-	newTop->Black = colourTemp;
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::FindMany(std::span<const T> items, std::span<size_t> indices) const
+{
+	// Only as many items are looked up as there is room for their indices
+	size_t count = std::min(items.size(), indices.size());
+	Node::FindMany(m_root, items.first(count), indices.first(count), m_compare);
+}
 
-	// Fix left-subtree sizes
-	// newTop's left subtree size stays the same
-	// but node's left subtree size decreases by newTop's leftSize + 1
-	newTop->Right->LeftSize -= newTop->LeftSize + 1;
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline const T& RedBlackTree<T, Compare, Allocator, Augment>::At(size_t index) const
+{
+	return Node::At(m_root, index);
+}
 
-	node = std::move(newTop);
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator RedBlackTree<T, Compare, Allocator, Augment>::LowerBound(const T& item) const
+{
+	return Bound<false>(item);
 }
 
-template<Comparable T>
-inline void RedBlackTree<T>::Node::MoveRedLeft (std::unique_ptr<Node>& node)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator RedBlackTree<T, Compare, Allocator, Augment>::UpperBound(const T& item) const
 {
-	node->SwitchColours();
-	if (node->Right && node->Right->IsLeftRed())
-	{
-		RotateRight(node->Right);
-		RotateLeft(node);
-		node->SwitchColours();
-	}
+	return Bound<true>(item);
 }
 
-template<Comparable T>
-inline void RedBlackTree<T>::Node::MoveRedRight (std::unique_ptr<Node>& node)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::Rank(const T& item) const
 {
-	node->SwitchColours();
-	if (node->Left && node->Left->IsLeftRed())
-	{
-		RotateRight(node);
-		node->SwitchColours();
-	}
+	return Node::Rank(m_root, item, m_compare);
 }
 
-template<Comparable T>
-inline bool RedBlackTree<T>::Node::Insert (std::unique_ptr<Node>& node, const T& item)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::CountRange(const T& low, const T& high) const
 {
-	if (node->Item == item)
+	if (!CompareLess(m_compare, low, high))
 	{
-		return false;
+		return 0;
 	}
 
-	bool inserted = true;
-	if (item < node->Item)
+	// Descend while both bounds lie on the same side, the first node between
+	// them splits the count into the ranks within its two subtrees.
+	const Node* node = m_root;
+	while (node)
 	{
-		if (!node->Left)
+		if (CompareOrder(m_compare, high, node->Item) <= 0)
 		{
-			node->Left = std::make_unique<Node>(item);
-			++node->LeftSize;
+			node = node->Left;
 		}
-		else
-		{
-			inserted = Insert(node->Left, item);
-			node->LeftSize += inserted;
-		}
-	}
-	else
-	{
-		if (!node->Right)
+		else if (CompareOrder(m_compare, low, node->Item) > 0)
 		{
-			node->Right = std::make_unique<Node>(item);
+			node = node->Right;
 		}
 		else
 		{
-			inserted = Insert(node->Right, item);
+			return node->LeftSize() - Node::Rank(node->Left, low, m_compare) + 1 + Node::Rank(node->Right, high, m_compare);
 		}
 	}
 
-	Fixup(node);
-	return inserted;
+	return 0;
 }
 
-template<Comparable T>
-inline bool RedBlackTree<T>::Node::Delete (std::unique_ptr<Node>& node, const T& item)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline std::ranges::subrange<typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator> RedBlackTree<T, Compare, Allocator, Augment>::Range(const T& low, const T& high) const
 {
-	if (!node)
+	if (!CompareLess(m_compare, low, high))
 	{
-		return false;
+		return std::ranges::subrange<Iterator>(end(), end());
 	}
 
-	bool deleted = false;
-	if (item < node->Item)
-	{
-		if (node->Left && node->Left->IsBlack() && node->Left->IsLeftBlack())
-		{
-			MoveRedLeft(node);
-		}
+	return std::ranges::subrange<Iterator>(LowerBound(low), LowerBound(high));
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::aggregate_type RedBlackTree<T, Compare, Allocator, Augment>::Aggregate() const
+{
+	return Node::AggregateOf(m_root);
+}
 
-		deleted = Delete(node->Left, item);
-		node->LeftSize -= static_cast<size_t>(deleted);
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::aggregate_type RedBlackTree<T, Compare, Allocator, Augment>::Aggregate(const T& low, const T& high) const
+{
+	if (!CompareLess(m_compare, low, high))
+	{
+		return Augment::Identity();
 	}
-	else
+
+	// Like CountRange, descend to the first node between the bounds. Below
+	// it, every node inside the range on the way to a bound contributes its
+	// own item and the whole subtree facing the other bound.
+	const Node* split = m_root;
+	while (split)
 	{
-		if (node->IsLeftRed())
+		if (CompareOrder(m_compare, high, split->Item) <= 0)
 		{
-			RotateRight(node);
+			split = split->Left;
 		}
-
-		if (node->Item == item && !node->Right)
+		else if (CompareOrder(m_compare, low, split->Item) > 0)
 		{
-			node.reset();
-			return true;
+			split = split->Right;
 		}
-
-		if (node->IsRightBlack() && node->Right && node->Right->IsLeftBlack())
+		else
 		{
-			MoveRedRight(node);
-		}
-
-		if (node->Item == item) {
-			// Find the minimum node of right subtree
-			Node* rightMin = node->Right.get();
-			while (rightMin->Left) rightMin = rightMin->Left.get();
-
-			// Swap the values of (this subtree) root and the minimum value of the right subtree, then delete minimum of right subtree
-			node->Item = rightMin->Item;
-			rightMin->Item = item;
-
-			deleted = DeleteMin(node->Right);
-		}
-		else {
-			deleted = Delete(node->Right, item);
+			break;
 		}
 	}
 
-	Fixup(node);
-	return deleted;
-}
-
-template<Comparable T>
-inline bool RedBlackTree<T>::Node::DeleteMin (std::unique_ptr<Node>& node)
-{
-	if (node->IsLeftBlack() && node->Left && node->Left->IsLeftBlack())
+	if (!split)
 	{
-		MoveRedLeft(node);
+		return Augment::Identity();
 	}
 
-	if (!node->Left)
+	aggregate_type left = Augment::Identity();
+	for (const Node* node = split->Left; node;)
 	{
-		node.reset();
-		return true;
+		if (CompareOrder(m_compare, low, node->Item) <= 0)
+		{
+			left = Augment::Combine(Augment::Combine(Augment::Lift(node->Item), Node::AggregateOf(node->Right)), left);
+			node = node->Left;
+		}
+		else
+		{
+			node = node->Right;
+		}
 	}
-	else
+
+	aggregate_type right = Augment::Identity();
+	for (const Node* node = split->Right; node;)
 	{
-		DeleteMin(node->Left);
+		if (CompareOrder(m_compare, high, node->Item) > 0)
+		{
+			right = Augment::Combine(right, Augment::Combine(Node::AggregateOf(node->Left), Augment::Lift(node->Item)));
+			node = node->Right;
+		}
+		else
+		{
+			node = node->Left;
+		}
 	}
 
-	--node->LeftSize;
-	Fixup(node);
-	return true;
+	return Augment::Combine(Augment::Combine(left, Augment::Lift(split->Item)), right);
 }
 
-template<Comparable T>
-inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackTree<T>::Node::Find (const Node* node, const T& item)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Contains(const T& item) const
 {
-	if (!node)
-	{
-		return std::make_pair((size_t)-1, std::ref(s_default));
-	}
-
-	if (item == node->Item)
-	{
-		return std::make_pair(node->LeftSize, std::ref(node->Item));
-	}
+	return Node::Contains(m_root, item, m_compare);
+}
 
-	if (item < node->Item)
-	{
-		return Find(node->Left.get(), item);
-	}
-	else
-	{
-		auto foundPair = Find(node->Right.get(), item);
-		foundPair.first += node->LeftSize;
-		return foundPair;
-	}
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<HeterogeneousKey<T, Compare> K>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Contains(const K& key) const
+{
+	return Node::Contains(m_root, key, m_compare);
 }
 
-template<Comparable T>
-inline const T& RedBlackTree<T>::Node::At (const Node* node, size_t index)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::Empty() const
 {
-	if (!node)
-	{
-		return s_default;
-	}
+	return m_treeSize == 0;
+}
 
-	if (node->LeftSize == index)
-	{
-		return node->Item;
-	}
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::Size() const
+{
+	return m_treeSize;
+}
 
-	if (index < node->LeftSize)
-	{
-		return At(node->Left.get(), index);
-	}
-	else
-	{
-		return At(node->Right.get(), index - (node->LeftSize + 1));
-	}
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::MemoryUsage() const
+{
+	return m_pool.Capacity() * sizeof(Node);
 }
 
-template<Comparable T>
-inline bool RedBlackTree<T>::Node::Contains (const Node* node, const T& item)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline FrozenTree<T, Compare, Allocator> RedBlackTree<T, Compare, Allocator, Augment>::Freeze() const
 {
-	if (!node)
-	{
-		return false;
-	}
+	return FrozenTree<T, Compare, Allocator>(SortedUnique, begin(), end(), m_compare, Allocator(m_pool.GetAllocator()));
+}
 
-	if (item == node->Item)
-	{
-		return true;
-	}
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator RedBlackTree<T, Compare, Allocator, Augment>::begin() const
+{
+	Iterator iterator;
+	iterator.m_tree = this;
+	iterator.PushLeftSpine(m_root);
+	return iterator;
+}
 
-	if (item < node->Item)
-	{
-		return Contains(node->Left.get(), item);
-	}
-	else
-	{
-		return Contains(node->Right.get(), item);
-	}
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator RedBlackTree<T, Compare, Allocator, Augment>::end() const
+{
+	Iterator iterator;
+	iterator.m_tree = this;
+	iterator.m_index = m_treeSize;
+	return iterator;
 }
 
-//////////////////////////////////////////////////////////////////////////////
-// REDBLACKTREE MEMBER FUNCTION DEFINITIONS
-//////////////////////////////////////////////////////////////////////////////
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::reverse_iterator RedBlackTree<T, Compare, Allocator, Augment>::rbegin() const
+{
+	return reverse_iterator(end());
+}
 
-template<Comparable T>
-inline RedBlackTree<T>::RedBlackTree()
-	: m_root(nullptr), m_treeSize(0), m_default(0)
-{}
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::reverse_iterator RedBlackTree<T, Compare, Allocator, Augment>::rend() const
+{
+	return reverse_iterator(begin());
+}
 
-template<Comparable T>
-inline bool RedBlackTree<T>::Insert(const T& item)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<bool Upper>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Iterator RedBlackTree<T, Compare, Allocator, Augment>::Bound(const T& item) const
 {
-	bool insertResult = false;
-	if (this->Empty())
-	{
-		m_root = std::make_unique<Node>(item);
-		m_treeSize = 1;
-		insertResult = true;
-	}
-	else
+	// The whole path is recorded on the way down and then cut back to the
+	// last node that was passed on the left, which is the bound.
+	Iterator iterator;
+	iterator.m_tree = this;
+
+	size_t boundDepth = 0;
+	size_t boundIndex = m_treeSize;
+	size_t index = 0;
+	for (const Node* node = m_root; node;)
 	{
-		if (Node::Insert(m_root, item))
+		iterator.m_path[iterator.m_depth++] = node;
+
+		auto order = CompareOrder(m_compare, item, node->Item);
+		if (order < 0 || (!Upper && order == 0))
+		{
+			boundDepth = iterator.m_depth;
+			boundIndex = index + node->LeftSize();
+			if (order == 0)
+			{
+				break;
+			}
+
+			node = node->Left;
+		}
+		else
 		{
-			m_treeSize++;
-			insertResult = true;
+			index += node->LeftSize() + 1;
+			node = node->Right;
 		}
 	}
 
+	iterator.m_depth = boundDepth;
+	iterator.m_index = boundIndex;
+	return iterator;
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K, typename Create>
+inline std::pair<typename RedBlackTree<T, Compare, Allocator, Augment>::Node*, bool> RedBlackTree<T, Compare, Allocator, Augment>::InsertWith(const K& key, Create&& create)
+{
+	auto [node, inserted] = Node::Insert(m_root, key, m_compare, std::forward<Create>(create));
+	m_treeSize += inserted;
+
 #ifdef PROVIDE_DATA_STRUCTURE
-	if (!std::count(m_reference.begin(), m_reference.end(), item))
-	{
-		m_reference.insert(std::upper_bound(m_reference.begin(), m_reference.end(), item), item);
-	}
+	ReferenceInsert(node->Item);
 #endif
 #ifdef RUNTIME_REFERENCE_DATA_STRUCTURE
 	ASSERT(CheckContent());
 #endif
 
-	return insertResult;
+	return std::make_pair(node, inserted);
 }
 
-template<Comparable T>
-inline bool RedBlackTree<T>::Delete(const T& item)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename Create>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::InsertNear(size_t index, const T& item, Create&& create)
 {
-	bool deleteResult = Node::Delete(m_root, item);
-	m_treeSize -= deleteResult;
+	// Descends by the subtree sizes to where the item would be the index-th,
+	// then checks it against the two neighbours met on the way. Only if the
+	// hint was wrong does it fall back to the search by comparison.
+	if (index <= m_treeSize)
+	{
+		const Node* predecessor = nullptr;
+		const Node* successor = nullptr;
+		Node* inserted = Node::Link(m_root, [&](const Node* node)
+		{
+			if (index <= node->LeftSize())
+			{
+				successor = node;
+				return std::strong_ordering::less;
+			}
+
+			index -= node->LeftSize() + 1;
+			predecessor = node;
+			return std::strong_ordering::greater;
+		}, [&]() -> Node*
+		{
+			if ((predecessor && !CompareLess(m_compare, predecessor->Item, item)) || (successor && !CompareLess(m_compare, item, successor->Item)))
+			{
+				return nullptr;
+			}
+
+			return create();
+		}).first;
+
+		if (inserted)
+		{
+			++m_treeSize;
 
 #ifdef PROVIDE_DATA_STRUCTURE
-	auto found = std::find(m_reference.begin(), m_reference.end(), item);
-	if (found != m_reference.end())
-	{
-		m_reference.erase(found);
-	}
+			ReferenceInsert(inserted->Item);
+#endif
+#ifdef RUNTIME_REFERENCE_DATA_STRUCTURE
+			ASSERT(CheckContent());
 #endif
 
-	return deleteResult;
+			return true;
+		}
+	}
+
+	return InsertWith(item, std::forward<Create>(create)).second;
 }
 
-template<Comparable T>
-inline bool RedBlackTree<T>::DeleteAt(size_t index)
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Whole()
 {
-	return Delete(At(index));
+	return Node::MakeSubtree(m_root, m_treeSize);
 }
 
-template<Comparable T>
-inline void RedBlackTree<T>::Clear()
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Subtree RedBlackTree<T, Compare, Allocator, Augment>::Adopt(RedBlackTree& other)
 {
-	m_root = nullptr;
-	m_treeSize = 0;
+	// Take over the other tree's nodes, moving its items into new nodes only
+	// if its allocator cannot free memory of this one.
+	Subtree tree = Node::MakeSubtree(other.m_root, other.m_treeSize);
+	if (!m_pool.Adopt(other.m_pool))
+	{
+		tree.Root = Relocate(other.m_pool, m_pool, tree);
+		tree = Node::MakeSubtree(tree.Root, tree.Size);
+	}
+
+	other.m_root = nullptr;
+	other.m_treeSize = 0;
 
 #ifdef PROVIDE_DATA_STRUCTURE
-	m_reference.clear();
+	other.ReferenceRebuild();
 #endif
+
+	return tree;
 }
 
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::Assume(const Subtree& tree, std::vector<Node*>& discarded)
+{
+	m_root = tree.Root;
+	m_treeSize = tree.Size;
+
+	for (Node* root : discarded)
+	{
+		Node::DestroyAll(m_pool, root);
+	}
+
+#ifdef PROVIDE_DATA_STRUCTURE
+	ReferenceRebuild();
+#endif
+}
 
-template<Comparable T>
-inline std::pair<size_t, std::reference_wrapper<const T>> RedBlackTree<T>::Find(const T& item) const
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Node* RedBlackTree<T, Compare, Allocator, Augment>::Relocate(Pool& from, Pool& to, const Subtree& tree)
 {
-	return Node::Find(m_root.get(), item);
+	std::vector<T> items;
+	items.reserve(tree.Size);
+	Node::MoveItems(tree.Root, items);
+	Node::DestroyAll(from, tree.Root);
+	return BuildFrom(to, items);
 }
 
-template<Comparable T>
-inline const T& RedBlackTree<T>::At(size_t index) const
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline typename RedBlackTree<T, Compare, Allocator, Augment>::Node* RedBlackTree<T, Compare, Allocator, Augment>::BuildFrom(Pool& pool, std::vector<T>& items)
 {
-	return Node::At(m_root.get(), index);
+	size_t capacity = 0;
+	while (capacity < items.size())
+	{
+		capacity = capacity * 3 + 2;
+	}
+
+	auto first = std::make_move_iterator(items.begin());
+	return Node::Build(pool, first, items.size(), capacity);
 }
 
-template<Comparable T>
-inline bool RedBlackTree<T>::Contains(const T& item) const
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::SortUnique(std::vector<T>& items) const
 {
-	return Node::Contains(m_root.get(), item);
+	SortBatch(items, m_compare, ForkDepth());
+	items.erase(std::unique(items.begin(), items.end(), [this](const T& a, const T& b) { return CompareOrder(m_compare, a, b) == 0; }), items.end());
 }
 
-template<Comparable T>
-inline bool RedBlackTree<T>::Empty() const
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::SortBatch(std::span<T> items, const Compare& compare, size_t forkDepth)
 {
-	return m_treeSize == 0;
+	auto less = [&compare](const T& a, const T& b) { return CompareLess(compare, a, b); };
+	if (forkDepth == 0 || items.size() < ParallelThreshold)
+	{
+		std::sort(items.begin(), items.end(), less);
+		return;
+	}
+
+	// Sort both halves on their own threads, then merge them
+	size_t half = items.size() / 2;
+	Node::ForkJoin(true,
+		[&]() { SortBatch(items.first(half), compare, forkDepth - 1); },
+		[&]() { SortBatch(items.subspan(half), compare, forkDepth - 1); });
+
+	std::inplace_merge(items.begin(), items.begin() + half, items.end(), less);
 }
 
-template<Comparable T>
-inline size_t RedBlackTree<T>::Size() const
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::ForkDepth()
 {
-	return m_treeSize;
+	// Enough levels of forking to give every core a share of the work
+	unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	return std::bit_width(cores) - 1;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -536,32 +3052,148 @@ inline size_t RedBlackTree<T>::Size() const
 //////////////////////////////////////////////////////////////////////////////
 
 #ifdef PROVIDE_DATA_STRUCTURE
-template<typename T>
-inline bool RedBlackTree<T>::CheckContent() const
+// The reference can only be kept for copyable items, move-only items and
+// items with const members are checked for order and count only.
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::ReferenceInsert(const T& item)
 {
-	if (m_reference.size() != m_treeSize)
+	if constexpr (std::copyable<T>)
 	{
-		printf("Tree size different from reference!\n");
-		return false;
+		auto less = [this](const T& a, const T& b) { return CompareLess(m_compare, a, b); };
+		auto position = std::upper_bound(m_reference.begin(), m_reference.end(), item, less);
+		if (position == m_reference.begin() || less(*std::prev(position), item))
+		{
+			m_reference.insert(position, item);
+		}
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+template<typename K>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::ReferenceDelete(const K& item)
+{
+	if constexpr (std::copyable<T>)
+	{
+		auto found = std::find_if(m_reference.begin(), m_reference.end(), [&](const T& other) { return CompareOrder(m_compare, item, other) == 0; });
+		if (found != m_reference.end())
+		{
+			m_reference.erase(found);
+		}
 	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::ReferenceRebuild()
+{
+	if constexpr (std::copyable<T>)
+	{
+		m_reference.assign(begin(), end());
+	}
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::CheckContent() const
+{
+	if constexpr (std::copyable<T>)
+	{
+		if (m_reference.size() != m_treeSize)
+		{
+			printf("Tree size different from reference!\n");
+			return false;
+		}
+
+		size_t index = 0;
+		for (const T& found : *this)
+		{
+			if (CompareOrder(m_compare, m_reference[index], found) != 0)
+			{
+				printf("Found item not equal to reference at index: %d\n", (int)index);
+				return false;
+			}
 
-	for (size_t i = 0; i < m_reference.size(); i++)
+			++index;
+		}
+	}
+	else
 	{
-		T found = At(i);
-		if (m_reference[i] != found)
+		size_t count = 0;
+		for (auto it = begin(); it != end(); ++it, ++count)
+		{
+			if (count > 0 && !CompareLess(m_compare, *std::prev(it), *it))
+			{
+				printf("Found items out of order at index: %d\n", (int)count);
+				return false;
+			}
+		}
+
+		if (count != m_treeSize)
 		{
-			printf("Found item not equal to reference at index: %d\n", (int)i);
+			printf("Tree size different from the count of items!\n");
 			return false;
 		}
 	}
 
+	bool consistent = true;
+	CheckLeftSizes(m_root, consistent);
+	if (!consistent)
+	{
+		printf("Found a node with left subtree size not matching its left subtree!\n");
+		return false;
+	}
+
+	CheckAggregates(m_root, consistent);
+	if (!consistent)
+	{
+		printf("Found a node with aggregate not matching its subtree!\n");
+		return false;
+	}
+
 	return true;
 }
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline size_t RedBlackTree<T, Compare, Allocator, Augment>::CheckLeftSizes(const Node* node, bool& consistent)
+{
+	if (!node)
+	{
+		return 0;
+	}
+
+	size_t leftSize = CheckLeftSizes(node->Left, consistent);
+	if (leftSize != node->LeftSize())
+	{
+		consistent = false;
+	}
+
+	return leftSize + 1 + CheckLeftSizes(node->Right, consistent);
+}
+
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void RedBlackTree<T, Compare, Allocator, Augment>::CheckAggregates(const Node* node, bool& consistent)
+{
+	// Only aggregates that can be compared can be checked
+	if constexpr (Node::IsAugmented && std::equality_comparable<aggregate_type>)
+	{
+		if (!node)
+		{
+			return;
+		}
+
+		CheckAggregates(node->Left, consistent);
+		CheckAggregates(node->Right, consistent);
+
+		aggregate_type expected = Augment::Combine(Augment::Combine(Node::AggregateOf(node->Left), Augment::Lift(node->Item)), Node::AggregateOf(node->Right));
+		if (!(expected == node->Aggregate))
+		{
+			consistent = false;
+		}
+	}
+}
 #endif
 
 #ifdef PROVIDE_INVARIANT_CHECKS
-template<typename T>
-inline bool RedBlackTree<T>::CheckInvariants() const
+template<typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool RedBlackTree<T, Compare, Allocator, Augment>::CheckInvariants() const
 {
 	if (!m_root)
 	{
@@ -576,7 +3208,7 @@ inline bool RedBlackTree<T>::CheckInvariants() const
 	};
 
 	std::stack<StackFrame> stack;
-	stack.push({ m_root.get(), 0 });
+	stack.push({ m_root, 0 });
 
 	while (!stack.empty())
 	{
@@ -585,7 +3217,7 @@ inline bool RedBlackTree<T>::CheckInvariants() const
 		stack.pop();
 
 		// Check two red edges in a row (doesn;t need to hold for root)
-		if (!(currentNode == m_root.get()) && currentNode->IsRed() && (currentNode->IsLeftRed() || currentNode->IsRightRed()))
+		if (!(currentNode == m_root) && currentNode->IsRed() && (currentNode->IsLeftRed() || currentNode->IsRightRed()))
 		{
 			printf("Found two neighbouring red edges!\n");
 			return false;
@@ -619,12 +3251,12 @@ inline bool RedBlackTree<T>::CheckInvariants() const
 
 		if (currentNode->Left)
 		{
-			stack.push({ currentNode->Left.get(), currentFrame.blackDepth + (currentNode->IsLeftBlack() ? 1 : 0)});
+			stack.push({ currentNode->Left, currentFrame.blackDepth + (currentNode->IsLeftBlack() ? 1 : 0)});
 		}
 
 		if (currentNode->Right)
 		{
-			stack.push({ currentNode->Right.get(), currentFrame.blackDepth + (currentNode->IsRightBlack() ? 1 : 0)});
+			stack.push({ currentNode->Right, currentFrame.blackDepth + (currentNode->IsRightBlack() ? 1 : 0)});
 		}
 	}
 
@@ -633,14 +3265,14 @@ inline bool RedBlackTree<T>::CheckInvariants() const
 #endif
 
 #ifdef ENABLE_FORCED_CHECKS
-template <typename T>
-inline bool ForceCheckInvariants(const RedBlackTree<T>& tree)
+template <typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool ForceCheckInvariants(const RedBlackTree<T, Compare, Allocator, Augment>& tree)
 {
 	return tree.CheckInvariants();
 }
 
-template <typename T>
-inline bool ForceCheckContent(const RedBlackTree<T>& tree)
+template <typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool ForceCheckContent(const RedBlackTree<T, Compare, Allocator, Augment>& tree)
 {
 	return tree.CheckContent();
 }
@@ -652,30 +3284,31 @@ inline bool ForceCheckContent(const RedBlackTree<T>& tree)
 #endif
 
 #ifdef ENABLE_TREE_DUMP
-template <typename T>
-inline void DumpTreeToFile(const std::string& filename, const RedBlackTree<T>& tree)
+template <typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline void DumpTreeToFile(const std::string& filename, const RedBlackTree<T, Compare, Allocator, Augment>& tree)
 {
-	static const std::function<void(std::ostream&, const typename RedBlackTree<T>::Node*)> dumpHelper =
-		[&](std::ostream& output, const typename RedBlackTree<T>::Node* node)
+	using Node = typename RedBlackTree<T, Compare, Allocator, Augment>::Node;
+	static const std::function<void(std::ostream&, const Node*)> dumpHelper =
+		[&](std::ostream& output, const Node* node)
 		{
 			if (node->Left)
 			{
 				output << (node->IsLeftRed() ? "edge[color=red];\n" : "edge[color=black];\n");
-				output << "\"Value: " << node->Item << "\\n LeftSize: " << node->LeftSize <<"\" -> \"Value: " << node->Left->Item << "\\n LeftSize: " << node->Left->LeftSize << "\"\n";
-				dumpHelper(output, node->Left.get());
+				output << "\"Value: " << node->Item << "\\n LeftSize: " << node->LeftSize() <<"\" -> \"Value: " << node->Left->Item << "\\n LeftSize: " << node->Left->LeftSize() << "\"\n";
+				dumpHelper(output, node->Left);
 			}
 
 			if (node->Right)
 			{
 				output << (node->IsRightRed() ? "edge[color=red];\n" : "edge[color=black];\n");
-				output << "\"Value: " << node->Item << "\\n LeftSize: " << node->LeftSize << "\" -> \"Value: " << node->Right->Item << "\\n LeftSize: " << node->Right->LeftSize << "\"\n";
-				dumpHelper(output, node->Right.get());
+				output << "\"Value: " << node->Item << "\\n LeftSize: " << node->LeftSize() << "\" -> \"Value: " << node->Right->Item << "\\n LeftSize: " << node->Right->LeftSize() << "\"\n";
+				dumpHelper(output, node->Right);
 			}
 		};
 
 	std::ofstream output{filename};
 	output << "digraph G {\n";
-	dumpHelper(output, tree.m_root.get());
+	dumpHelper(output, tree.m_root);
 	output << "}\n";
 	output.close();
 }
@@ -0,0 +1,333 @@
+#ifndef _TREE_SERIALIZATION_H
+#define _TREE_SERIALIZATION_H
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "RedBlackTree.h"
+#include "FrozenTree.h"
+
+#ifdef _WIN32
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// TREE FILE FORMAT
+//////////////////////////////////////////////////////////////////////////////
+
+// A tree file is this header followed by the items in the Eytzinger order of
+// FrozenTree, as raw bytes. The header fills a cache line, so the items are
+// aligned when the file is mapped. Files record the item size and byte order
+// of the machine that wrote them, and are only read where those match.
+struct TreeFileHeader
+{
+	static constexpr char     s_magic[8] = { 'R', 'B', 'T', 'R', 'E', 'E', 0, 0 };
+	static constexpr uint32_t s_version = 1;
+	static constexpr uint32_t s_byteOrder = 0x01020304;
+
+	char     Magic[8];
+	uint32_t Version;
+	uint32_t ByteOrder;
+	uint64_t ItemSize;
+	uint64_t ItemAlignment;
+	uint64_t Count;
+	uint8_t  Reserved[24];
+};
+
+static_assert(sizeof(TreeFileHeader) == 64, "The items have to start on a cache line.");
+
+//////////////////////////////////////////////////////////////////////////////
+// MAPPED TREE DECLARATION
+//////////////////////////////////////////////////////////////////////////////
+
+// Read-only tree searched in place in a memory mapped tree file. Opening
+// checks the header and maps the file, without reading or allocating
+// anything per item, and pages are only loaded as searches touch them. The
+// items are not validated, so the file has to be one written by WriteTree.
+template <typename T, Comparator<T> Compare = DefaultCompare<T>>
+class MappedTree
+{
+	static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable items can be used from their bytes.");
+	static_assert(alignof(T) <= sizeof(TreeFileHeader), "Items after the header have to be aligned.");
+public:
+			 MappedTree   ();
+	explicit MappedTree   (const Compare& compare);
+			 MappedTree   (const MappedTree&) = delete;
+			 MappedTree   (MappedTree&& other) noexcept;
+	MappedTree& operator= (const MappedTree&) = delete;
+	MappedTree& operator= (MappedTree&& other) noexcept;
+			 ~MappedTree  ();
+
+	bool     Open         (const std::string& filename);
+	void     Close        ();
+	bool     IsOpen       () const;
+
+	const FrozenTree<T, Compare>& Tree () const;
+	const FrozenTree<T, Compare>* operator-> () const;
+private:
+	[[no_unique_address]] Compare m_compare;
+	FrozenTree<T, Compare>      m_tree;
+	void*                       m_address;
+	size_t                      m_length;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// SERIALIZATION FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+inline TreeFileHeader MakeTreeFileHeader(size_t count)
+{
+	TreeFileHeader header = {};
+	std::memcpy(header.Magic, TreeFileHeader::s_magic, sizeof(header.Magic));
+	header.Version = TreeFileHeader::s_version;
+	header.ByteOrder = TreeFileHeader::s_byteOrder;
+	header.ItemSize = sizeof(T);
+	header.ItemAlignment = alignof(T);
+	header.Count = count;
+	return header;
+}
+
+template <typename T>
+inline bool IsTreeFileHeaderFor(const TreeFileHeader& header)
+{
+	return std::memcmp(header.Magic, TreeFileHeader::s_magic, sizeof(header.Magic)) == 0
+		&& header.Version == TreeFileHeader::s_version
+		&& header.ByteOrder == TreeFileHeader::s_byteOrder
+		&& header.ItemSize == sizeof(T)
+		&& header.ItemAlignment == alignof(T);
+}
+
+// Writes the frozen tree as a tree file. Returns false if the stream failed.
+template <typename T, Comparator<T> Compare, typename Allocator>
+inline bool WriteTree(std::ostream& out, const FrozenTree<T, Compare, Allocator>& tree)
+{
+	static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable items can be written as bytes.");
+
+	TreeFileHeader header = MakeTreeFileHeader<T>(tree.Size());
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(tree.Items().data()), tree.Size() * sizeof(T));
+	return out.good();
+}
+
+// Writes the tree as a tree file, which can later be mapped as a MappedTree
+// or read back with ReadTree. Returns false if the stream failed.
+template <typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool WriteTree(std::ostream& out, const RedBlackTree<T, Compare, Allocator, Augment>& tree)
+{
+	return WriteTree(out, tree.Freeze());
+}
+
+// Replaces the content of the tree with the items of a tree file. The tree
+// is built bottom up in O(n), as for a sorted Assign, so colours and sizes
+// are not part of the file. Returns false, leaving the tree unchanged, if
+// the stream does not hold a tree file of this item type in strictly
+// increasing order.
+template <typename T, Comparator<T> Compare, typename Allocator, Augmentation<T> Augment>
+inline bool ReadTree(std::istream& in, RedBlackTree<T, Compare, Allocator, Augment>& tree)
+{
+	static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable items can be read as bytes.");
+	static_assert(std::is_default_constructible_v<T>, "Items are read into default constructed storage.");
+
+	TreeFileHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || !IsTreeFileHeaderFor<T>(header))
+	{
+		return false;
+	}
+
+	// Reading in blocks keeps a damaged count from allocating more than the
+	// stream actually holds.
+	constexpr size_t BlockSize = 1 << 16;
+	std::vector<T> items;
+	while (items.size() < header.Count)
+	{
+		size_t offset = items.size();
+		size_t count = std::min<size_t>(BlockSize, header.Count - offset);
+		items.resize(offset + count);
+		if (!in.read(reinterpret_cast<char*>(items.data() + offset), count * sizeof(T)))
+		{
+			return false;
+		}
+	}
+
+	auto frozen = FrozenTree<T, Compare>::View(items, tree.m_compare);
+	auto unordered = std::adjacent_find(frozen.begin(), frozen.end(), [&](const T& a, const T& b)
+	{
+		return !CompareLess(tree.m_compare, a, b);
+	});
+
+	if (unordered != frozen.end())
+	{
+		return false;
+	}
+
+	tree.Assign(SortedUnique, frozen.begin(), frozen.end());
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// MAPPED TREE MEMBER FUNCTION DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template<typename T, Comparator<T> Compare>
+inline MappedTree<T, Compare>::MappedTree()
+	: m_compare(), m_tree(), m_address(nullptr), m_length(0)
+{}
+
+template<typename T, Comparator<T> Compare>
+inline MappedTree<T, Compare>::MappedTree(const Compare& compare)
+	: m_compare(compare), m_tree(compare), m_address(nullptr), m_length(0)
+{}
+
+template<typename T, Comparator<T> Compare>
+inline MappedTree<T, Compare>::MappedTree(MappedTree&& other) noexcept
+	: m_compare(other.m_compare), m_tree(std::move(other.m_tree)), m_address(other.m_address), m_length(other.m_length)
+{
+	other.m_address = nullptr;
+	other.m_length = 0;
+}
+
+template<typename T, Comparator<T> Compare>
+inline MappedTree<T, Compare>& MappedTree<T, Compare>::operator=(MappedTree&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_compare = other.m_compare;
+		m_tree = std::move(other.m_tree);
+		m_address = other.m_address;
+		m_length = other.m_length;
+		other.m_address = nullptr;
+		other.m_length = 0;
+	}
+
+	return *this;
+}
+
+template<typename T, Comparator<T> Compare>
+inline MappedTree<T, Compare>::~MappedTree()
+{
+	Close();
+}
+
+template<typename T, Comparator<T> Compare>
+inline bool MappedTree<T, Compare>::Open(const std::string& filename)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER length;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &length) && (size_t)length.QuadPart >= sizeof(TreeFileHeader))
+	{
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+
+	CloseHandle(file);
+	if (!mapping)
+	{
+		return false;
+	}
+
+	// The view keeps the file mapped after the handles are closed
+	void* address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!address)
+	{
+		return false;
+	}
+
+	m_address = address;
+	m_length = length.QuadPart;
+#else
+	int file = open(filename.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	void* address = MAP_FAILED;
+	if (fstat(file, &status) == 0 && (size_t)status.st_size >= sizeof(TreeFileHeader))
+	{
+		address = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+	}
+
+	// The mapping keeps the file open after the descriptor is closed
+	close(file);
+	if (address == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_address = address;
+	m_length = status.st_size;
+#endif
+
+	const TreeFileHeader* header = static_cast<const TreeFileHeader*>(m_address);
+	if (!IsTreeFileHeaderFor<T>(*header) || header->Count > (m_length - sizeof(TreeFileHeader)) / sizeof(T))
+	{
+		Close();
+		return false;
+	}
+
+	const T* items = reinterpret_cast<const T*>(header + 1);
+	m_tree = FrozenTree<T, Compare>::View(std::span<const T>(items, header->Count), m_compare);
+	return true;
+}
+
+template<typename T, Comparator<T> Compare>
+inline void MappedTree<T, Compare>::Close()
+{
+	m_tree = FrozenTree<T, Compare>(m_compare);
+	if (m_address)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_address);
+#else
+		munmap(m_address, m_length);
+#endif
+		m_address = nullptr;
+		m_length = 0;
+	}
+}
+
+template<typename T, Comparator<T> Compare>
+inline bool MappedTree<T, Compare>::IsOpen() const
+{
+	return m_address != nullptr;
+}
+
+template<typename T, Comparator<T> Compare>
+inline const FrozenTree<T, Compare>& MappedTree<T, Compare>::Tree() const
+{
+	return m_tree;
+}
+
+template<typename T, Comparator<T> Compare>
+inline const FrozenTree<T, Compare>* MappedTree<T, Compare>::operator->() const
+{
+	return &m_tree;
+}
+
+#endif
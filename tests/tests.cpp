@@ -1,9 +1,27 @@
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <numeric>
 #include <random>
+#include <set>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <gtest/gtest.h>
 
 #define ENABLE_FORCED_CHECKS
 #include "RedBlackTree.h"
+#include "RedBlackMap.h"
+#include "RedBlackMultiset.h"
+#include "IntervalTree.h"
+#include "BTree.h"
+#include "FrozenTree.h"
+#include "TreeSerialization.h"
+#include "RcuRedBlackTree.h"
+#include "ConcurrentRedBlackTree.h"
+#include "PersistentRedBlackTree.h"
 
 TEST(RedBlackTree, InsertIncreasingSmall)
 {
@@ -222,3 +240,1775 @@ TEST(RedBlackTree, FuzzyInsertDelete)
 		}
 	}
 }
+
+template <typename T>
+struct CountingAllocator
+{
+	using value_type = T;
+
+	CountingAllocator(size_t* allocations) : Allocations(allocations) {}
+	template <typename U> CountingAllocator(const CountingAllocator<U>& other) : Allocations(other.Allocations) {}
+
+	T* allocate(size_t count)
+	{
+		++*Allocations;
+		return std::allocator<T>().allocate(count);
+	}
+
+	void deallocate(T* pointer, size_t count)
+	{
+		std::allocator<T>().deallocate(pointer, count);
+	}
+
+	template <typename U> bool operator==(const CountingAllocator<U>& other) const { return Allocations == other.Allocations; }
+
+	size_t* Allocations;
+};
+
+TEST(RedBlackTree, PoolReusesFreedNodes)
+{
+	size_t allocations = 0;
+	RedBlackTree<int64_t, DefaultCompare<int64_t>, CountingAllocator<int64_t>> tree{ CountingAllocator<int64_t>(&allocations) };
+
+	for (int64_t i = 0; i < 10000; ++i) tree.Insert(i);
+	size_t allocationsAfterFill = allocations;
+	EXPECT_GT(allocationsAfterFill, 0);
+	EXPECT_LT(allocationsAfterFill, 10000 / 64);
+
+	for (int64_t i = 0; i < 10000; i += 2) tree.Delete(i);
+	for (int64_t i = 10000; i < 15000; ++i) tree.Insert(i);
+
+	EXPECT_EQ(allocationsAfterFill, allocations);
+	EXPECT_EQ(10000, tree.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, ClearAndReuse)
+{
+	RedBlackTree<std::string> tree;
+
+	for (size_t round = 0; round < 3; ++round)
+	{
+		for (size_t i = 0; i < 1000; ++i)
+		{
+			tree.Insert(std::to_string(i * 7919 % 1000));
+		}
+
+		EXPECT_EQ(1000, tree.Size());
+		EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+		tree.Clear();
+		EXPECT_TRUE(tree.Empty());
+		EXPECT_FALSE(tree.Contains("1"));
+	}
+}
+
+TEST(RedBlackTree, MoveConstructAndAssign)
+{
+	RedBlackTree<int64_t> tree;
+	for (int64_t i = 0; i < 1000; ++i) tree.Insert(i);
+
+	RedBlackTree<int64_t> moved{ std::move(tree) };
+	EXPECT_EQ(1000, moved.Size());
+	EXPECT_EQ(0, tree.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(moved));
+
+	tree = std::move(moved);
+	EXPECT_EQ(1000, tree.Size());
+	EXPECT_EQ(999, tree.At(999));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, FindReturnsIndex)
+{
+	RedBlackTree<int64_t> tree;
+	for (int64_t i = 0; i < 10000; ++i) tree.Insert((i * 7919) % 10000);
+
+	for (size_t i = 0; i < tree.Size(); ++i)
+	{
+		EXPECT_EQ(i, tree.Find(tree.At(i)).first);
+	}
+
+	EXPECT_EQ((size_t)-1, tree.Find(10000).first);
+	EXPECT_EQ((size_t)-1, tree.Find(-1).first);
+}
+
+TEST(RedBlackTree, FuzzyInsertDeleteSmallRange)
+{
+	RedBlackTree<int64_t> tree;
+	std::mt19937_64 e2(42);
+	std::uniform_int_distribution<int64_t> dist(0, 2000);
+
+	for (size_t i = 0; i < 20000; i++)
+	{
+		if (dist(e2) % 5 >= 2)
+		{
+			tree.Insert(dist(e2));
+		}
+		else
+		{
+			tree.Delete(dist(e2));
+		}
+
+		if (i % 1000 == 0)
+		{
+			EXPECT_EQ(1, FORCE_CHECKS(tree));
+		}
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, CompactNodes)
+{
+	RedBlackTree<int64_t> tree;
+	EXPECT_EQ(0, tree.MemoryUsage());
+
+	for (int64_t i = 0; i < 20000; ++i) tree.Insert(i);
+
+	// Item, two children and the left size with the colour packed inside.
+	size_t nodeSize = sizeof(int64_t) + 3 * sizeof(void*);
+	EXPECT_GE(tree.MemoryUsage(), tree.Size() * nodeSize);
+	EXPECT_LE(tree.MemoryUsage(), 2 * tree.Size() * nodeSize);
+
+	for (int64_t i = 0; i < 20000; i += 3) tree.Delete(i);
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+static_assert(std::bidirectional_iterator<RedBlackTree<int64_t>::Iterator>);
+static_assert(std::ranges::bidirectional_range<RedBlackTree<int64_t>>);
+
+TEST(RedBlackTree, IterateInOrder)
+{
+	RedBlackTree<int64_t> tree;
+	EXPECT_EQ(tree.begin(), tree.end());
+
+	for (int64_t i = 0; i < 10000; ++i) tree.Insert((i * 7919) % 10000);
+
+	int64_t expected = 0;
+	for (int64_t item : tree)
+	{
+		EXPECT_EQ(expected++, item);
+	}
+	EXPECT_EQ(10000, expected);
+
+	for (auto it = tree.rbegin(); it != tree.rend(); ++it)
+	{
+		EXPECT_EQ(--expected, *it);
+	}
+	EXPECT_EQ(0, expected);
+
+	for (auto it = tree.begin(); it != tree.end(); ++it)
+	{
+		EXPECT_EQ(it.Index(), (size_t)*it);
+	}
+}
+
+TEST(RedBlackTree, IteratorAlgorithms)
+{
+	RedBlackTree<int64_t> tree;
+	for (int64_t i = 1; i <= 1000; ++i) tree.Insert(i * 2);
+
+	EXPECT_EQ(1000, std::distance(tree.begin(), tree.end()));
+	EXPECT_TRUE(std::is_sorted(tree.begin(), tree.end()));
+	EXPECT_EQ(2000, *std::prev(tree.end()));
+	EXPECT_EQ(999, std::prev(tree.end()).Index());
+
+	auto found = std::ranges::find(tree, 500);
+	ASSERT_NE(tree.end(), found);
+	EXPECT_EQ(249, found.Index());
+	EXPECT_EQ(498, *std::prev(found));
+	EXPECT_EQ(502, *std::next(found));
+
+	EXPECT_EQ(500, std::ranges::count_if(tree, [](int64_t item) { return item % 4 == 0; }));
+
+	auto it = tree.end();
+	for (size_t i = 0; i < tree.Size(); ++i) --it;
+	EXPECT_EQ(tree.begin(), it);
+}
+
+TEST(RedBlackTree, BuildFromSortedRange)
+{
+	for (int64_t count = 0; count < 300; ++count)
+	{
+		std::vector<int64_t> items;
+		for (int64_t i = 0; i < count; ++i) items.push_back(i * 3);
+
+		RedBlackTree<int64_t> tree(SortedUnique, items.begin(), items.end());
+		EXPECT_EQ(items.size(), tree.Size());
+		EXPECT_TRUE(std::equal(items.begin(), items.end(), tree.begin(), tree.end()));
+		EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+		for (int64_t i = 0; i < count; ++i)
+		{
+			EXPECT_EQ(i * 3, tree.At(i));
+		}
+	}
+}
+
+TEST(RedBlackTree, BuildThenModify)
+{
+	std::vector<int64_t> items;
+	for (int64_t i = 0; i < 100000; ++i) items.push_back(i * 2);
+
+	RedBlackTree<int64_t> tree;
+	tree.Insert(-1);
+	tree.Assign(SortedUnique, items.begin(), items.end());
+	EXPECT_EQ(items.size(), tree.Size());
+	EXPECT_FALSE(tree.Contains(-1));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	for (int64_t i = 0; i < 1000; ++i)
+	{
+		tree.Insert(i * 2 + 1);
+		tree.Delete(i * 4);
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, BuildFromUnsortedRange)
+{
+	std::mt19937_64 e2(7);
+	std::uniform_int_distribution<int64_t> dist(0, 5000);
+	std::vector<int64_t> items;
+	for (size_t i = 0; i < 10000; ++i) items.push_back(dist(e2));
+
+	RedBlackTree<int64_t> tree(items.begin(), items.end());
+	RedBlackTree<int64_t> reference;
+	for (auto item : items) reference.Insert(item);
+
+	EXPECT_EQ(reference.Size(), tree.Size());
+	EXPECT_TRUE(std::equal(reference.begin(), reference.end(), tree.begin(), tree.end()));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	std::istringstream input("5 3 9 3 1");
+	tree.Assign(std::istream_iterator<int64_t>(input), std::istream_iterator<int64_t>());
+	EXPECT_EQ(4, tree.Size());
+	EXPECT_EQ(9, tree.At(3));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+struct CopyCounted
+{
+	CopyCounted(int64_t value) : Value(value) {}
+	CopyCounted(const CopyCounted& other) : Value(other.Value) { ++s_copies; }
+	CopyCounted(CopyCounted&& other) noexcept : Value(other.Value) {}
+	CopyCounted& operator=(const CopyCounted& other) { Value = other.Value; ++s_copies; return *this; }
+	CopyCounted& operator=(CopyCounted&& other) noexcept { Value = other.Value; return *this; }
+
+	bool operator<(const CopyCounted& other) const { return Value < other.Value; }
+	bool operator==(const CopyCounted& other) const { return Value == other.Value; }
+
+	int64_t Value;
+	static inline size_t s_copies = 0;
+};
+
+TEST(RedBlackTree, InsertAndDeleteWithoutCopies)
+{
+	RedBlackTree<CopyCounted> tree;
+	size_t copiesBefore = CopyCounted::s_copies;
+
+	for (int64_t i = 0; i < 1000; ++i)
+	{
+		EXPECT_TRUE(tree.Insert(CopyCounted((i * 7919) % 1000)));
+	}
+	EXPECT_FALSE(tree.Insert(CopyCounted(5)));
+
+	for (int64_t i = 1000; i < 2000; ++i)
+	{
+		EXPECT_TRUE(tree.Emplace(i));
+	}
+	EXPECT_FALSE(tree.Emplace(1500));
+
+	for (int64_t i = 0; i < 2000; i += 2)
+	{
+		EXPECT_TRUE(tree.Delete(CopyCounted(i)));
+	}
+
+	// Only the debug reference copies each inserted item, the tree never does
+	EXPECT_EQ(copiesBefore + 2000, CopyCounted::s_copies);
+	EXPECT_EQ(1000, tree.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, MoveOnlyItems)
+{
+	RedBlackTree<std::unique_ptr<int64_t>> tree;
+	std::vector<int64_t*> pointers;
+
+	for (int64_t i = 0; i < 1000; ++i)
+	{
+		auto item = std::make_unique<int64_t>(i);
+		pointers.push_back(item.get());
+		EXPECT_TRUE(tree.Insert(std::move(item)));
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	std::sort(pointers.begin(), pointers.end());
+	for (size_t i = 0; i < pointers.size(); i += 2)
+	{
+		std::unique_ptr<int64_t> key(pointers[i]);
+		EXPECT_TRUE(tree.Contains(key));
+		key.release();
+	}
+
+	while (!tree.Empty())
+	{
+		EXPECT_TRUE(tree.DeleteAt(tree.Size() / 2));
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, CustomComparator)
+{
+	RedBlackTree<int64_t, std::greater<>> tree;
+	for (int64_t i = 0; i < 10000; ++i) tree.Insert((i * 7919) % 10000);
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+	EXPECT_EQ(9999, tree.At(0));
+	EXPECT_EQ(0, tree.At(9999));
+	EXPECT_EQ(9000, tree.Find(999).first);
+	EXPECT_TRUE(std::is_sorted(tree.begin(), tree.end(), std::greater<>()));
+
+	for (int64_t i = 0; i < 10000; i += 2) EXPECT_TRUE(tree.Delete(i));
+	EXPECT_EQ(5000, tree.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, FuzzyDeleteAtAndExtractAt)
+{
+	RedBlackTree<int64_t, DefaultCompare<int64_t>, std::allocator<int64_t>, SumAugmentation<int64_t>> tree;
+	std::vector<int64_t> reference;
+	for (int64_t i = 0; i < 20000; ++i)
+	{
+		tree.Insert(i * 3);
+		reference.push_back(i * 3);
+	}
+
+	std::mt19937_64 e2(31);
+	for (size_t i = 0; !reference.empty(); ++i)
+	{
+		size_t index = e2() % reference.size();
+		if (i % 2 == 0)
+		{
+			EXPECT_TRUE(tree.DeleteAt(index));
+		}
+		else
+		{
+			EXPECT_EQ(reference[index], tree.ExtractAt(index));
+		}
+
+		reference.erase(reference.begin() + index);
+		if (i % 2000 == 0)
+		{
+			EXPECT_TRUE(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+			EXPECT_EQ(1, FORCE_CHECKS(tree));
+		}
+	}
+
+	// Out of range indices leave the tree alone, even an item equal to the
+	// default one.
+	tree.Insert(0);
+	EXPECT_FALSE(tree.DeleteAt(1));
+	EXPECT_FALSE(tree.ExtractAt(1).has_value());
+	EXPECT_EQ(1, tree.Size());
+	EXPECT_TRUE(tree.DeleteAt(0));
+	EXPECT_FALSE(tree.DeleteAt(0));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, PopMinPopMax)
+{
+	RedBlackTree<std::unique_ptr<std::string>, std::less<>> tree;
+	for (int i = 0; i < 1000; ++i)
+	{
+		tree.Insert(std::make_unique<std::string>(std::to_string(i)));
+	}
+
+	const std::string* previous = nullptr;
+	while (tree.Size() > 1)
+	{
+		std::optional<std::unique_ptr<std::string>> minimum = tree.PopMin();
+		std::optional<std::unique_ptr<std::string>> maximum = tree.PopMax();
+		ASSERT_TRUE(minimum && *minimum && maximum && *maximum);
+		EXPECT_LT(minimum->get(), maximum->get());
+		EXPECT_TRUE(!previous || previous < minimum->get());
+		previous = minimum->get();
+		EXPECT_TRUE(tree.Empty() || (minimum->get() < tree.At(0).get() && tree.At(tree.Size() - 1).get() < maximum->get()));
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+	EXPECT_TRUE(tree.Empty());
+	EXPECT_FALSE(tree.PopMin().has_value());
+	EXPECT_FALSE(tree.PopMax().has_value());
+}
+
+TEST(RedBlackTree, NodeHandles)
+{
+	using Tree = RedBlackTree<int64_t, DefaultCompare<int64_t>, std::allocator<int64_t>, SumAugmentation<int64_t>>;
+	Tree tree;
+	for (int64_t i = 0; i < 1000; ++i) tree.Insert(i);
+
+	// Re-keying reuses the node, so the pool does not grow
+	size_t memory = tree.MemoryUsage();
+	for (int64_t i = 0; i < 1000; i += 2)
+	{
+		Tree::NodeHandle handle = tree.Extract(i);
+		ASSERT_TRUE(handle);
+		handle.Item() += 1000;
+		EXPECT_TRUE(tree.Insert(std::move(handle)));
+		EXPECT_TRUE(handle.Empty());
+	}
+
+	EXPECT_EQ(memory, tree.MemoryUsage());
+	EXPECT_EQ(1000, tree.Size());
+	EXPECT_EQ(1000 * 999 / 2 + 500 * 1000, tree.Aggregate());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	// A duplicate stays with the handle, a missing key gives an empty one
+	Tree::NodeHandle duplicate = tree.Extract(1);
+	duplicate.Item() = 3;
+	EXPECT_FALSE(tree.Insert(std::move(duplicate)));
+	EXPECT_EQ(3, duplicate.Item());
+	EXPECT_FALSE(tree.Contains(1));
+	EXPECT_TRUE(tree.Extract(-5).Empty());
+	EXPECT_FALSE(tree.Insert(Tree::NodeHandle()));
+
+	// Handles from another tree have their item moved over
+	Tree other;
+	other.Insert(-1);
+	EXPECT_TRUE(tree.Insert(other.Extract(-1)));
+	EXPECT_TRUE(other.Empty());
+	EXPECT_TRUE(tree.Contains(-1));
+	EXPECT_EQ(1000, tree.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+	EXPECT_EQ(1, FORCE_CHECKS(other));
+}
+
+TEST(RedBlackTree, FingerSearch)
+{
+	RedBlackTree<int64_t> tree;
+	for (int64_t i = 0; i < 50000; ++i) tree.Insert(i * 2);
+
+	// Sequential, clustered and random keys, found and missing
+	RedBlackTree<int64_t>::Finger finger(tree);
+	for (int64_t i = -3; i < 100005; ++i)
+	{
+		EXPECT_EQ(tree.Find(i).first, finger.Find(i).first);
+	}
+
+	std::mt19937_64 e2(41);
+	int64_t center = 0;
+	for (size_t i = 0; i < 50000; ++i)
+	{
+		center = i % 100 == 0 ? (int64_t)(e2() % 100000) : center;
+		int64_t key = i % 7 == 0 ? (int64_t)(e2() % 100000) : center + (int64_t)(e2() % 64) - 32;
+		auto [index, found] = finger.Find(key);
+		EXPECT_EQ(tree.Find(key).first, index);
+		EXPECT_EQ(tree.Contains(key), finger.Contains(key));
+		if (index != (size_t)-1)
+		{
+			EXPECT_EQ(key, found.get());
+		}
+	}
+
+	// Changes invalidate the finger until it is reset
+	tree.Delete(5000);
+	tree.Insert(5001);
+	finger.Reset();
+	EXPECT_FALSE(finger.Contains(5000));
+	EXPECT_EQ(2501, finger.Find(5002).first);
+
+	RedBlackTree<std::string, std::less<>> strings;
+	for (int i = 0; i < 1000; ++i) strings.Insert(std::to_string(i));
+	RedBlackTree<std::string, std::less<>>::Finger stringFinger(strings);
+	for (int i = 0; i < 1000; ++i)
+	{
+		std::string key = std::to_string(i);
+		EXPECT_EQ(strings.Find(key).first, stringFinger.Find(std::string_view(key)).first);
+	}
+
+	RedBlackTree<int64_t> empty;
+	RedBlackTree<int64_t>::Finger emptyFinger(empty);
+	EXPECT_FALSE(emptyFinger.Contains(0));
+}
+
+TEST(RedBlackTree, HintedInsertAndDelete)
+{
+	RedBlackTree<std::string> tree;
+	std::set<std::string> reference;
+	for (int i = 0; i < 5000; ++i)
+	{
+		std::string item = std::to_string(100000 + i);
+		EXPECT_TRUE(tree.Insert(tree.end(), item));
+		reference.insert(item);
+	}
+
+	// Correct and wrong hints give the same tree
+	std::mt19937_64 e2(37);
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		std::string item = std::to_string(100000 + e2() % 20000);
+		size_t rank = std::distance(reference.begin(), reference.lower_bound(item));
+		bool inserted = reference.insert(item).second;
+		if (i % 3 == 0)
+		{
+			EXPECT_EQ(inserted, tree.InsertAt(rank, item));
+		}
+		else if (i % 3 == 1)
+		{
+			EXPECT_EQ(inserted, tree.InsertAt(e2() % (tree.Size() + 2), item));
+		}
+		else
+		{
+			EXPECT_EQ(inserted, tree.Insert(tree.LowerBound(item), std::string(item)));
+		}
+	}
+
+	EXPECT_TRUE(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		std::string item = std::to_string(100000 + e2() % 20000);
+		auto position = tree.LowerBound(item);
+		if (position != tree.end() && *position == item)
+		{
+			EXPECT_TRUE(tree.Delete(position));
+			reference.erase(item);
+		}
+	}
+
+	EXPECT_FALSE(tree.Delete(tree.end()));
+	EXPECT_EQ(reference.size(), tree.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+struct CountingThreeWay
+{
+	size_t* Comparisons;
+
+	std::strong_ordering operator() (int64_t a, int64_t b) const
+	{
+		++*Comparisons;
+		return b <=> a;
+	}
+};
+
+TEST(RedBlackTree, StatefulThreeWayComparator)
+{
+	size_t comparisons = 0;
+	RedBlackTree<int64_t, CountingThreeWay> tree{ CountingThreeWay{ &comparisons } };
+
+	std::vector<int64_t> items;
+	for (int64_t i = 0; i < 1000; ++i) items.push_back((i * 7919) % 1000);
+	tree.Assign(items.begin(), items.end());
+	EXPECT_EQ(999, tree.At(0));
+
+	// One comparison per level, the tree is never deeper than 2 log n.
+	comparisons = 0;
+	EXPECT_EQ(500, tree.Find(499).first);
+	EXPECT_LE(comparisons, 20u);
+
+	RedBlackTree<int64_t, CountingThreeWay> moved{ std::move(tree) };
+	moved.Insert(1000);
+	EXPECT_EQ(1000, moved.At(0));
+	EXPECT_EQ(1, FORCE_CHECKS(moved));
+}
+
+TEST(RedBlackTree, TransparentLookup)
+{
+	RedBlackTree<std::string, std::less<>> tree;
+	for (int64_t i = 0; i < 1000; ++i) tree.Insert(std::to_string(i));
+
+	std::string_view key = "500";
+	EXPECT_TRUE(tree.Contains(key));
+	EXPECT_EQ("500", tree.Find(key).second.get());
+	EXPECT_FALSE(tree.Contains(std::string_view("1000")));
+
+	EXPECT_TRUE(tree.Delete(key));
+	EXPECT_FALSE(tree.Delete(key));
+	EXPECT_FALSE(tree.Contains("500"));
+	EXPECT_EQ(999, tree.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, FindMany)
+{
+	RedBlackTree<int64_t> tree;
+	std::mt19937_64 e2(7);
+	std::uniform_int_distribution<int64_t> dist(0, 20000);
+	for (size_t i = 0; i < 10000; ++i) tree.Insert(dist(e2));
+
+	std::vector<int64_t> keys;
+	for (size_t i = 0; i < 1000; ++i) keys.push_back(dist(e2));
+
+	std::vector<size_t> indices(keys.size());
+	tree.FindMany(keys, indices);
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		EXPECT_EQ(tree.Find(keys[i]).first, indices[i]);
+	}
+
+	// Only as many keys are looked up as there are indices for
+	std::vector<size_t> few(11, 0);
+	tree.FindMany(keys, std::span<size_t>(few).first(10));
+	for (size_t i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(tree.Find(keys[i]).first, few[i]);
+	}
+
+	EXPECT_EQ(0, few[10]);
+
+	tree.FindMany({}, indices);
+	RedBlackTree<int64_t>().FindMany(keys, indices);
+	EXPECT_EQ(keys.size(), (size_t)std::count(indices.begin(), indices.end(), (size_t)-1));
+}
+
+TEST(RedBlackTree, BoundsAndRanks)
+{
+	RedBlackTree<int64_t> tree;
+	std::vector<int64_t> reference;
+	std::mt19937_64 e2(11);
+	std::uniform_int_distribution<int64_t> dist(0, 5000);
+	for (size_t i = 0; i < 2000; ++i)
+	{
+		int64_t item = dist(e2);
+		if (tree.Insert(item)) reference.insert(std::lower_bound(reference.begin(), reference.end(), item), item);
+	}
+
+	for (int64_t key = -1; key <= 5001; ++key)
+	{
+		size_t lower = std::lower_bound(reference.begin(), reference.end(), key) - reference.begin();
+		size_t upper = std::upper_bound(reference.begin(), reference.end(), key) - reference.begin();
+
+		EXPECT_EQ(lower, tree.Rank(key));
+		EXPECT_EQ(lower, tree.LowerBound(key).Index());
+		EXPECT_EQ(upper, tree.UpperBound(key).Index());
+		if (lower < reference.size())
+		{
+			EXPECT_EQ(reference[lower], *tree.LowerBound(key));
+		}
+		else
+		{
+			EXPECT_EQ(tree.end(), tree.LowerBound(key));
+		}
+	}
+
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		int64_t low = dist(e2);
+		int64_t high = dist(e2);
+		size_t expected = low < high ? std::lower_bound(reference.begin(), reference.end(), high) - std::lower_bound(reference.begin(), reference.end(), low) : 0;
+		EXPECT_EQ(expected, tree.CountRange(low, high));
+
+		auto range = tree.Range(low, high);
+		EXPECT_EQ(expected, (size_t)std::ranges::distance(range));
+		EXPECT_TRUE(std::ranges::all_of(range, [&](int64_t item) { return low <= item && item < high; }));
+	}
+
+	EXPECT_EQ(tree.Size(), tree.CountRange(-1, 5001));
+	EXPECT_EQ(0, RedBlackTree<int64_t>().CountRange(0, 10));
+}
+
+TEST(RedBlackTree, SplitAndJoin)
+{
+	std::vector<int64_t> items;
+	for (int64_t i = 0; i < 3000; ++i) items.push_back(i * 2);
+
+	for (int64_t key : { -1, 0, 1, 7, 1000, 3001, 5998, 5999, 6000 })
+	{
+		RedBlackTree<int64_t> low(SortedUnique, items.begin(), items.end());
+		RedBlackTree<int64_t> high = low.Split(key);
+
+		size_t expected = std::lower_bound(items.begin(), items.end(), key) - items.begin();
+		EXPECT_EQ(expected, low.Size());
+		EXPECT_EQ(items.size() - expected, high.Size());
+		EXPECT_TRUE(std::equal(low.begin(), low.end(), items.begin()));
+		EXPECT_TRUE(std::equal(high.begin(), high.end(), items.begin() + expected));
+		EXPECT_EQ(1, FORCE_CHECKS(low));
+		EXPECT_EQ(1, FORCE_CHECKS(high));
+	}
+
+	// Joins of trees of very different heights
+	for (size_t leftSize : { 0, 1, 5, 100, 2999 })
+	{
+		RedBlackTree<int64_t> left(SortedUnique, items.begin(), items.begin() + leftSize);
+		RedBlackTree<int64_t> right;
+		for (size_t i = leftSize + 1; i < items.size(); ++i) right.Insert(items[i]);
+
+		auto joined = RedBlackTree<int64_t>::Join(std::move(left), items[leftSize], std::move(right));
+		EXPECT_TRUE(left.Empty());
+		EXPECT_TRUE(right.Empty());
+		EXPECT_EQ(items.size(), joined.Size());
+		EXPECT_TRUE(std::equal(joined.begin(), joined.end(), items.begin()));
+		EXPECT_EQ(1, FORCE_CHECKS(joined));
+	}
+}
+
+TEST(RedBlackTree, SetOperations)
+{
+	std::mt19937_64 e2(12);
+	for (size_t round = 0; round < 30; ++round)
+	{
+		std::uniform_int_distribution<int64_t> dist(0, 1 + e2() % 4000);
+		std::set<int64_t> a, b;
+		size_t aCount = e2() % 2000, bCount = e2() % 2000;
+		for (size_t i = 0; i < aCount; ++i) a.insert(dist(e2));
+		for (size_t i = 0; i < bCount; ++i) b.insert(dist(e2));
+
+		auto check = [&](auto operation, auto reference)
+		{
+			RedBlackTree<int64_t> tree(a.begin(), a.end());
+			RedBlackTree<int64_t> other(b.begin(), b.end());
+			operation(tree, std::move(other));
+
+			std::vector<int64_t> expected;
+			reference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(expected));
+			EXPECT_EQ(expected.size(), tree.Size());
+			EXPECT_TRUE(std::equal(tree.begin(), tree.end(), expected.begin(), expected.end()));
+			EXPECT_TRUE(other.Empty());
+			EXPECT_EQ(1, FORCE_CHECKS(tree));
+		};
+
+		check([](auto& tree, auto&& other) { tree.Union(std::move(other)); },
+			[](auto... args) { return std::set_union(args...); });
+		check([](auto& tree, auto&& other) { tree.Intersection(std::move(other)); },
+			[](auto... args) { return std::set_intersection(args...); });
+		check([](auto& tree, auto&& other) { tree.Difference(std::move(other)); },
+			[](auto... args) { return std::set_difference(args...); });
+	}
+}
+
+TEST(RedBlackTree, LargeUnion)
+{
+	std::vector<int64_t> evens, odds, all;
+	for (int64_t i = 0; i < 400000; ++i)
+	{
+		(i % 2 ? odds : evens).push_back(i);
+		all.push_back(i);
+	}
+
+	RedBlackTree<int64_t> tree(SortedUnique, evens.begin(), evens.end());
+	tree.Union(RedBlackTree<int64_t>(SortedUnique, odds.begin(), odds.end()));
+	EXPECT_EQ(all.size(), tree.Size());
+	EXPECT_TRUE(std::equal(tree.begin(), tree.end(), all.begin(), all.end()));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	tree.Difference(RedBlackTree<int64_t>(SortedUnique, odds.begin(), odds.end()));
+	EXPECT_TRUE(std::equal(tree.begin(), tree.end(), evens.begin(), evens.end()));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, SetOperationsAcrossAllocators)
+{
+	size_t allocations = 0;
+	size_t otherAllocations = 0;
+	using Tree = RedBlackTree<int64_t, DefaultCompare<int64_t>, CountingAllocator<int64_t>>;
+
+	Tree tree{ CountingAllocator<int64_t>(&allocations) };
+	Tree other{ CountingAllocator<int64_t>(&otherAllocations) };
+	for (int64_t i = 0; i < 1000; ++i) tree.Insert(i * 3);
+	for (int64_t i = 0; i < 1000; ++i) other.Insert(i * 5);
+
+	tree.Union(std::move(other));
+	EXPECT_EQ(1000 + 1000 - 200, tree.Size());
+	EXPECT_TRUE(other.Empty());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	Tree same{ CountingAllocator<int64_t>(&allocations) };
+	for (int64_t i = 0; i < 1000; ++i) same.Insert(i * 3);
+	size_t allocationsBefore = allocations;
+	tree.Intersection(std::move(same));
+	EXPECT_EQ(1000, tree.Size());
+	EXPECT_EQ(allocationsBefore, allocations);
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, BatchInsertDelete)
+{
+	RedBlackTree<int64_t> tree;
+	std::set<int64_t> reference;
+	std::mt19937_64 e2(13);
+	for (size_t round = 0; round < 40; ++round)
+	{
+		std::uniform_int_distribution<int64_t> dist(0, 5000);
+		std::vector<int64_t> batch(e2() % 1500);
+		for (auto& item : batch) item = dist(e2);
+
+		size_t sizeBefore = reference.size();
+		if (round % 3 == 2)
+		{
+			// Deleting only frees nodes, it never allocates any
+			size_t memoryBefore = tree.MemoryUsage();
+			for (auto item : batch) reference.erase(item);
+			EXPECT_EQ(sizeBefore - reference.size(), tree.DeleteBatch(batch));
+			EXPECT_GE(memoryBefore, tree.MemoryUsage());
+		}
+		else
+		{
+			reference.insert(batch.begin(), batch.end());
+			EXPECT_EQ(reference.size() - sizeBefore, tree.InsertBatch(batch));
+		}
+
+		EXPECT_EQ(reference.size(), tree.Size());
+		EXPECT_TRUE(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+		EXPECT_EQ(1, FORCE_CHECKS(tree));
+	}
+}
+
+TEST(RedBlackTree, LargeBatches)
+{
+	std::vector<int64_t> batch;
+	for (int64_t i = 0; i < 300000; ++i) batch.push_back(i * 7919 % 300000);
+
+	RedBlackTree<int64_t> tree;
+	for (int64_t i = 0; i < 300000; i += 3) tree.Insert(i);
+	EXPECT_EQ(200000, tree.InsertBatch(batch));
+	EXPECT_EQ(300000, tree.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	batch.resize(150000);
+	EXPECT_EQ(150000, tree.DeleteBatch(batch));
+	EXPECT_EQ(150000, tree.Size());
+	EXPECT_TRUE(std::ranges::none_of(batch, [&](int64_t item) { return tree.Contains(item); }));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackTree, SumAggregates)
+{
+	using Tree = RedBlackTree<int64_t, DefaultCompare<int64_t>, std::allocator<int64_t>, SumAugmentation<int64_t>>;
+	Tree tree;
+	std::set<int64_t> reference;
+	std::mt19937_64 e2(14);
+	std::uniform_int_distribution<int64_t> dist(-3000, 3000);
+
+	auto check = [&]()
+	{
+		for (size_t query = 0; query < 50; ++query)
+		{
+			int64_t low = dist(e2), high = dist(e2);
+			int64_t expected = 0;
+			for (auto it = reference.lower_bound(low); it != reference.end() && *it < high; ++it) expected += *it;
+			EXPECT_EQ(expected, tree.Aggregate(low, high));
+		}
+
+		EXPECT_EQ(std::accumulate(reference.begin(), reference.end(), int64_t(0)), tree.Aggregate());
+		EXPECT_EQ(1, FORCE_CHECKS(tree));
+	};
+
+	for (size_t round = 0; round < 20; ++round)
+	{
+		for (size_t i = 0; i < 500; ++i)
+		{
+			int64_t item = dist(e2);
+			if (e2() % 3 == 0)
+			{
+				EXPECT_EQ(reference.erase(item) == 1, tree.Delete(item));
+			}
+			else
+			{
+				EXPECT_EQ(reference.insert(item).second, tree.Insert(item));
+			}
+		}
+
+		check();
+	}
+
+	std::vector<int64_t> batch(2000);
+	for (auto& item : batch) item = dist(e2);
+	tree.InsertBatch(batch);
+	reference.insert(batch.begin(), batch.end());
+	check();
+
+	Tree high = tree.Split(0);
+	std::set<int64_t> highReference(reference.lower_bound(0), reference.end());
+	reference.erase(reference.lower_bound(0), reference.end());
+	check();
+
+	std::set<int64_t> odds;
+	for (int64_t i = -2999; i < 3000; i += 2) odds.insert(i);
+	tree.Difference(Tree(odds.begin(), odds.end()));
+	for (auto item : odds) reference.erase(item);
+	check();
+
+	tree.Union(std::move(high));
+	reference.insert(highReference.begin(), highReference.end());
+	check();
+
+	tree.Assign(odds.begin(), odds.end());
+	reference = odds;
+	check();
+
+	EXPECT_EQ(0, Tree().Aggregate());
+	EXPECT_EQ(0, tree.Aggregate(5, 5));
+	EXPECT_EQ(0, tree.Aggregate(6, 5));
+}
+
+TEST(RedBlackTree, MinMaxAggregates)
+{
+	RedBlackTree<int32_t, std::greater<>, std::allocator<int32_t>, MinAugmentation<int32_t>> minimum;
+	RedBlackTree<int32_t, DefaultCompare<int32_t>, std::allocator<int32_t>, MaxAugmentation<int32_t>> maximum;
+	std::mt19937_64 e2(15);
+	for (size_t i = 0; i < 5000; ++i)
+	{
+		int32_t item = (int32_t)(e2() % 100000);
+		minimum.Insert(item);
+		maximum.Insert(item);
+	}
+
+	// With a descending order the range runs from high to low items
+	for (size_t query = 0; query < 200; ++query)
+	{
+		int32_t low = (int32_t)(e2() % 100000), high = (int32_t)(e2() % 100000);
+		auto it = maximum.LowerBound(low);
+		if (low < high && it != maximum.end() && *it < high)
+		{
+			EXPECT_EQ(*it, minimum.Aggregate(high - 1, low - 1));
+			EXPECT_EQ(*std::prev(maximum.LowerBound(high)), maximum.Aggregate(low, high));
+		}
+		else
+		{
+			EXPECT_EQ(std::numeric_limits<int32_t>::lowest(), maximum.Aggregate(low, high));
+		}
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(minimum));
+	EXPECT_EQ(1, FORCE_CHECKS(maximum));
+}
+
+// Concatenation is associative but not commutative, so any aggregate combined
+// out of order shows up.
+struct ConcatenateAugmentation
+{
+	using Value = std::string;
+
+	static Value Identity() { return {}; }
+	static Value Lift(const std::string& item) { return item + ","; }
+	static Value Combine(const Value& a, const Value& b) { return a + b; }
+};
+
+TEST(RedBlackTree, OrderedAggregates)
+{
+	RedBlackTree<std::string, DefaultCompare<std::string>, std::allocator<std::string>, ConcatenateAugmentation> tree;
+	std::set<std::string> reference;
+	std::mt19937_64 e2(16);
+	for (size_t i = 0; i < 3000; ++i)
+	{
+		std::string item = std::to_string(e2() % 1000);
+		if (e2() % 4 == 0)
+		{
+			tree.Delete(item);
+			reference.erase(item);
+		}
+		else
+		{
+			tree.Insert(item);
+			reference.insert(item);
+		}
+	}
+
+	for (size_t query = 0; query < 100; ++query)
+	{
+		std::string low = std::to_string(e2() % 1000), high = std::to_string(e2() % 1000);
+		std::string expected;
+		for (auto it = reference.lower_bound(low); it != reference.end() && *it < high; ++it) expected += *it + ",";
+		EXPECT_EQ(expected, tree.Aggregate(low, high));
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackMap, FuzzyOperations)
+{
+	RedBlackMap<int64_t, std::string> map;
+	std::map<int64_t, std::string> reference;
+	std::mt19937_64 e2(14);
+	std::uniform_int_distribution<int64_t> dist(0, 2000);
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		int64_t key = dist(e2);
+		std::string value = std::to_string(e2() % 100);
+		switch (e2() % 5)
+		{
+		case 0:
+			map[key] += value;
+			reference[key] += value;
+			break;
+		case 1:
+			EXPECT_EQ(reference.try_emplace(key, value).second, map.TryEmplace(key, value).second);
+			break;
+		case 2:
+			EXPECT_EQ(reference.insert_or_assign(key, value).second, map.InsertOrAssign(key, value));
+			break;
+		default:
+			EXPECT_EQ(reference.erase(key) == 1, map.Delete(key));
+			break;
+		}
+	}
+
+	EXPECT_EQ(reference.size(), map.Size());
+	EXPECT_TRUE(std::ranges::equal(map, reference));
+	for (auto& [key, value] : reference)
+	{
+		auto [index, found] = map.Find(key);
+		ASSERT_NE(nullptr, found);
+		EXPECT_EQ(value, *found);
+		EXPECT_EQ(key, map.At(index).first);
+	}
+
+	EXPECT_EQ(nullptr, map.Find(-1).second);
+	EXPECT_EQ(1, FORCE_CHECKS(map));
+}
+
+TEST(RedBlackMap, UpdateInPlace)
+{
+	size_t comparisons = 0;
+	RedBlackMap<int64_t, std::unique_ptr<int64_t>, CountingThreeWay> map{ CountingThreeWay{ &comparisons } };
+	for (int64_t i = 0; i < 1000; ++i) map.TryEmplace(i, std::make_unique<int64_t>(i));
+
+	// Updates are a single descent and keep the node, and its value's address
+	size_t memory = map.MemoryUsage();
+	int64_t* value = map.Find(500).second->get();
+	comparisons = 0;
+	EXPECT_FALSE(map.TryEmplace(500, std::make_unique<int64_t>(0)).second);
+	EXPECT_LE(comparisons, 20u);
+	EXPECT_EQ(500, *map[500]);
+
+	comparisons = 0;
+	EXPECT_FALSE(map.InsertOrAssign(500, std::make_unique<int64_t>(-500)));
+	EXPECT_LE(comparisons, 20u);
+	EXPECT_EQ(-500, *map[500]);
+	EXPECT_NE(value, map[500].get());
+
+	for (auto& [key, item] : map) *item += 1;
+	EXPECT_EQ(-499, *map.At(499).second);
+	EXPECT_EQ(1000, *map.At(0).second);
+	EXPECT_EQ(memory, map.MemoryUsage());
+	EXPECT_EQ(1, FORCE_CHECKS(map));
+}
+
+TEST(RedBlackMap, TransparentLookup)
+{
+	RedBlackMap<std::string, int64_t, std::less<>> map;
+	for (int64_t i = 0; i < 100; ++i) map[std::to_string(i)] = i;
+
+	std::string_view key = "42";
+	EXPECT_EQ(42, *map.Find(key).second);
+	EXPECT_TRUE(map.Contains(key));
+	EXPECT_TRUE(map.Delete(key));
+	EXPECT_FALSE(map.Contains(key));
+	EXPECT_EQ(99, map.Size());
+	EXPECT_TRUE(map.DeleteAt(0));
+	EXPECT_EQ("1", map.At(0).first);
+}
+
+TEST(RedBlackMultiset, FuzzyInsertDelete)
+{
+	RedBlackMultiset<int64_t> tree;
+	std::multiset<int64_t> reference;
+	std::mt19937_64 e2(15);
+	std::uniform_int_distribution<int64_t> dist(0, 500);
+	for (size_t i = 0; i < 50000; ++i)
+	{
+		int64_t item = dist(e2);
+		size_t count = e2() % 4;
+		if (e2() % 3)
+		{
+			for (size_t j = 0; j < count; ++j) reference.insert(item);
+			EXPECT_EQ(reference.count(item), tree.Insert(item, count));
+		}
+		else
+		{
+			size_t expected = std::min(count, reference.count(item));
+			for (size_t j = 0; j < expected; ++j) reference.erase(reference.find(item));
+			EXPECT_EQ(expected, tree.Delete(item, count));
+		}
+
+		if (i % 5000 == 0)
+		{
+			EXPECT_TRUE(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+			EXPECT_EQ(1, FORCE_CHECKS(tree));
+		}
+	}
+
+	EXPECT_EQ(reference.size(), tree.Size());
+	size_t index = 0;
+	for (int64_t item : reference)
+	{
+		EXPECT_EQ(item, tree.At(index++));
+	}
+
+	for (int64_t item = -1; item <= 501; ++item)
+	{
+		size_t rank = std::distance(reference.begin(), reference.lower_bound(item));
+		EXPECT_EQ(rank, tree.Rank(item));
+		EXPECT_EQ(reference.count(item), tree.Count(item));
+		EXPECT_EQ(reference.count(item) ? rank : (size_t)-1, tree.Find(item).first);
+	}
+
+	EXPECT_TRUE(std::equal(tree.rbegin(), tree.rend(), reference.rbegin(), reference.rend()));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RedBlackMultiset, DuplicatesDoNotAllocate)
+{
+	size_t allocations = 0;
+	RedBlackMultiset<int64_t, DefaultCompare<int64_t>, CountingAllocator<int64_t>> tree{ CountingAllocator<int64_t>(&allocations) };
+	for (int64_t i = 0; i < 1000; ++i) tree.Insert(i);
+
+	size_t allocationsAfterFill = allocations;
+	for (size_t round = 0; round < 10; ++round)
+	{
+		for (int64_t i = 0; i < 1000; ++i) tree.Insert(i, 2);
+	}
+
+	EXPECT_EQ(allocationsAfterFill, allocations);
+	EXPECT_EQ(21000, tree.Size());
+	EXPECT_EQ(1000, tree.UniqueSize());
+	EXPECT_EQ(500, tree.At(21 * 500));
+	EXPECT_EQ(21, tree.DeleteAll(500));
+	EXPECT_FALSE(tree.Contains(500));
+	EXPECT_EQ(999, tree.UniqueSize());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(IntervalTree, FuzzyOverlapping)
+{
+	IntervalTree<int64_t> tree;
+	std::set<Interval<int64_t>> reference;
+	std::mt19937_64 e2(17);
+	std::uniform_int_distribution<int64_t> start(0, 10000);
+	std::uniform_int_distribution<int64_t> length(0, 300);
+
+	for (size_t round = 0; round < 20; ++round)
+	{
+		for (size_t i = 0; i < 500; ++i)
+		{
+			int64_t low = start(e2), high = low + length(e2);
+			if (e2() % 4 == 0 && !reference.empty())
+			{
+				auto it = reference.lower_bound({ low, high });
+				if (it == reference.end()) --it;
+				Interval<int64_t> interval = *it;
+				EXPECT_TRUE(tree.Delete(interval.Low, interval.High));
+				reference.erase(interval);
+			}
+			else
+			{
+				EXPECT_EQ(reference.insert({ low, high }).second, tree.Insert(low, high));
+			}
+		}
+
+		for (size_t query = 0; query < 50; ++query)
+		{
+			int64_t low = start(e2), high = low + length(e2) / 4;
+			std::vector<Interval<int64_t>> expected;
+			std::ranges::copy_if(reference, std::back_inserter(expected),
+				[&](const Interval<int64_t>& interval) { return interval.Low <= high && low <= interval.High; });
+
+			EXPECT_EQ(expected, tree.Overlapping(low, high));
+			EXPECT_EQ(!expected.empty(), tree.Overlaps(low, high));
+		}
+
+		EXPECT_EQ(reference.size(), tree.Size());
+		EXPECT_EQ(1, FORCE_CHECKS(tree));
+	}
+}
+
+TEST(IntervalTree, Stabbing)
+{
+	std::vector<Interval<double>> intervals = { { 0, 10 }, { 2, 3 }, { 3, 8 }, { 5, 5 }, { 9, 12 }, { 4, 1 } };
+	IntervalTree<double> tree(intervals.begin(), intervals.end());
+	EXPECT_EQ(5, tree.Size());
+	EXPECT_FALSE(tree.Insert(7, 6));
+	EXPECT_FALSE(tree.Insert(2, 3));
+
+	using Found = std::vector<Interval<double>>;
+	EXPECT_EQ((Found{ { 0, 10 }, { 2, 3 }, { 3, 8 } }), tree.Stabbing(3));
+	EXPECT_EQ((Found{ { 0, 10 }, { 3, 8 }, { 5, 5 } }), tree.Stabbing(5));
+	EXPECT_EQ((Found{ { 0, 10 }, { 9, 12 } }), tree.Stabbing(9.5));
+	EXPECT_EQ(Found{}, tree.Stabbing(12.5));
+	EXPECT_EQ(Found{}, tree.Stabbing(-1));
+	EXPECT_TRUE(tree.Overlaps(10.5, 20));
+	EXPECT_FALSE(tree.Overlaps(12.5, 20));
+
+	EXPECT_TRUE(tree.Delete(0, 10));
+	EXPECT_EQ((Found{ { 3, 8 }, { 5, 5 } }), tree.Overlapping(4, 6));
+	EXPECT_FALSE(tree.Overlaps(8.5, 8.9));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(BTree, FuzzyInsertDelete)
+{
+	BTree<int64_t> tree;
+	std::set<int64_t> reference;
+	std::mt19937_64 e2(18);
+	std::uniform_int_distribution<int64_t> dist(-20000, 20000);
+
+	for (size_t round = 0; round < 30; ++round)
+	{
+		for (size_t i = 0; i < 2000; ++i)
+		{
+			int64_t item = dist(e2);
+			if (round % 10 >= 6 && !reference.empty())
+			{
+				if (e2() % 2)
+				{
+					EXPECT_EQ(reference.erase(item) == 1, tree.Delete(item));
+				}
+				else
+				{
+					size_t index = e2() % reference.size();
+					EXPECT_EQ(*std::next(reference.begin(), index % 64), tree.At(index % 64));
+					reference.erase(std::next(reference.begin(), index % 64));
+					EXPECT_TRUE(tree.DeleteAt(index % 64));
+				}
+			}
+			else
+			{
+				EXPECT_EQ(reference.insert(item).second, tree.Insert(item));
+			}
+		}
+
+		EXPECT_EQ(reference.size(), tree.Size());
+		EXPECT_TRUE(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+		EXPECT_TRUE(std::equal(tree.rbegin(), tree.rend(), reference.rbegin(), reference.rend()));
+		EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+		for (size_t query = 0; query < 200; ++query)
+		{
+			int64_t item = dist(e2);
+			auto lower = reference.lower_bound(item);
+			size_t rank = std::distance(reference.begin(), lower);
+			EXPECT_EQ(rank, tree.Rank(item));
+			EXPECT_EQ(rank, tree.LowerBound(item).Index());
+			EXPECT_EQ(std::distance(reference.begin(), reference.upper_bound(item)), tree.UpperBound(item).Index());
+			if (lower != reference.end())
+			{
+				EXPECT_EQ(*lower, *tree.LowerBound(item));
+			}
+
+			bool contained = reference.contains(item);
+			EXPECT_EQ(contained, tree.Contains(item));
+			EXPECT_EQ(contained ? rank : std::numeric_limits<size_t>::max(), tree.Find(item).first);
+		}
+	}
+
+	while (!tree.Empty())
+	{
+		EXPECT_TRUE(tree.DeleteAt(e2() % tree.Size()));
+	}
+
+	EXPECT_FALSE(tree.DeleteAt(0));
+	EXPECT_EQ(tree.begin(), tree.end());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(BTree, NarrowAndCustomOrder)
+{
+	BTree<int32_t> narrow;
+	BTree<int64_t, std::greater<>> descending;
+	for (int32_t i = 0; i < 50000; ++i)
+	{
+		narrow.Insert(i * 7 % 50000);
+		descending.Insert(i);
+	}
+
+	for (int32_t i = 0; i < 50000; i += 97)
+	{
+		EXPECT_EQ(i, narrow.Find(i).first);
+		EXPECT_EQ(i, narrow.At(i));
+		EXPECT_EQ(49999 - i, descending.Find(i).first);
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(narrow));
+	EXPECT_EQ(1, FORCE_CHECKS(descending));
+}
+
+TEST(BTree, StringItems)
+{
+	BTree<std::string, std::less<>> tree;
+	std::set<std::string> reference;
+	std::mt19937_64 e2(19);
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		std::string item = std::to_string(e2() % 5000);
+		if (e2() % 3 == 0)
+		{
+			EXPECT_EQ(reference.erase(item) == 1, tree.Delete(std::string_view(item)));
+		}
+		else
+		{
+			EXPECT_EQ(reference.insert(item).second, tree.Emplace(item));
+		}
+	}
+
+	EXPECT_TRUE(std::equal(tree.begin(), tree.end(), reference.begin(), reference.end()));
+	EXPECT_TRUE(tree.Contains(std::string_view(*reference.begin())));
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+
+	tree.Clear();
+	EXPECT_TRUE(tree.Empty());
+	EXPECT_FALSE(tree.Contains("1"));
+}
+
+TEST(FrozenTree, EverySize)
+{
+	// Sizes around every power of two leave the last level at all fill levels
+	RedBlackTree<int64_t> tree;
+	for (int64_t size = 0; size < 140; ++size)
+	{
+		auto frozen = tree.Freeze();
+		ASSERT_EQ(tree.Size(), frozen.Size());
+		EXPECT_TRUE(std::equal(frozen.begin(), frozen.end(), tree.begin(), tree.end()));
+		EXPECT_TRUE(std::equal(frozen.rbegin(), frozen.rend(), tree.rbegin(), tree.rend()));
+
+		for (int64_t i = -1; i <= 2 * size + 1; ++i)
+		{
+			bool contained = i >= 0 && i % 2 == 0 && i < 2 * size;
+			size_t rank = std::min<size_t>(std::max<int64_t>(0, (i + 1) / 2), size);
+			EXPECT_EQ(contained, frozen.Contains(i));
+			EXPECT_EQ(contained ? rank : std::numeric_limits<size_t>::max(), frozen.Find(i).first);
+			EXPECT_EQ(rank, frozen.Rank(i));
+			EXPECT_EQ(rank, frozen.LowerBound(i).Index());
+			EXPECT_EQ(tree.LowerBound(i) == tree.end(), frozen.LowerBound(i) == frozen.end());
+			if (frozen.UpperBound(i) != frozen.end())
+			{
+				EXPECT_EQ(*tree.UpperBound(i), *frozen.UpperBound(i));
+			}
+		}
+
+		for (size_t i = 0; i < frozen.Size(); ++i)
+		{
+			EXPECT_EQ(tree.At(i), frozen.At(i));
+		}
+
+		EXPECT_EQ(0, frozen.At(frozen.Size()));
+		EXPECT_EQ(size * sizeof(int64_t), frozen.MemoryUsage());
+		tree.Insert(2 * size);
+	}
+}
+
+TEST(FrozenTree, LargeAndStrings)
+{
+	RedBlackTree<int64_t> tree;
+	std::mt19937_64 e2(23);
+	for (size_t i = 0; i < 100000; ++i)
+	{
+		tree.Insert(e2() % 1000000);
+	}
+
+	auto frozen = tree.Freeze();
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		int64_t item = e2() % 1000000;
+		EXPECT_EQ(tree.Find(item).first, frozen.Find(item).first);
+		EXPECT_EQ(tree.LowerBound(item).Index(), frozen.LowerBound(item).Index());
+		EXPECT_EQ(tree.UpperBound(item).Index(), frozen.UpperBound(item).Index());
+	}
+
+	RedBlackTree<std::string, std::less<>> strings;
+	for (int i = 0; i < 1000; ++i)
+	{
+		strings.Insert(std::to_string(i));
+	}
+
+	auto frozenStrings = strings.Freeze();
+	EXPECT_TRUE(frozenStrings.Contains(std::string_view("500")));
+	EXPECT_EQ(strings.Find("500").first, frozenStrings.Find(std::string_view("500")).first);
+	EXPECT_EQ("500", frozenStrings.Find(std::string_view("500")).second.get());
+	EXPECT_FALSE(frozenStrings.Contains(std::string_view("5000")));
+	EXPECT_TRUE(std::equal(frozenStrings.begin(), frozenStrings.end(), strings.begin(), strings.end()));
+}
+
+TEST(TreeSerialization, WriteAndRead)
+{
+	RedBlackTree<int64_t> tree;
+	std::mt19937_64 e2(29);
+	for (size_t i = 0; i < 50000; ++i)
+	{
+		tree.Insert(e2() % 1000000);
+	}
+
+	std::stringstream stream;
+	EXPECT_TRUE(WriteTree(stream, tree));
+	std::string bytes = stream.str();
+	EXPECT_EQ(sizeof(TreeFileHeader) + tree.Size() * sizeof(int64_t), bytes.size());
+
+	RedBlackTree<int64_t> loaded;
+	loaded.Insert(-1);
+	EXPECT_TRUE(ReadTree(stream, loaded));
+	EXPECT_TRUE(std::equal(loaded.begin(), loaded.end(), tree.begin(), tree.end()));
+	EXPECT_EQ(1, FORCE_CHECKS(loaded));
+
+	// Another item size, a cut off file and items out of order are rejected
+	// without touching the tree.
+	std::stringstream narrow(bytes);
+	RedBlackTree<int32_t> wrongType;
+	EXPECT_FALSE(ReadTree(narrow, wrongType));
+
+	std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+	EXPECT_FALSE(ReadTree(truncated, loaded));
+
+	std::string swapped = bytes;
+	std::swap_ranges(swapped.end() - 2 * sizeof(int64_t), swapped.end() - sizeof(int64_t), swapped.end() - sizeof(int64_t));
+	std::stringstream unordered(swapped);
+	EXPECT_FALSE(ReadTree(unordered, loaded));
+	EXPECT_EQ(tree.Size(), loaded.Size());
+
+	std::stringstream empty;
+	EXPECT_TRUE(WriteTree(empty, RedBlackTree<int64_t>()));
+	EXPECT_TRUE(ReadTree(empty, loaded));
+	EXPECT_TRUE(loaded.Empty());
+}
+
+TEST(TreeSerialization, MappedTree)
+{
+	RedBlackTree<int64_t> tree;
+	for (int64_t i = 0; i < 100000; ++i)
+	{
+		tree.Insert(i * 3);
+	}
+
+	std::string filename = (std::filesystem::temp_directory_path() / "rbtree_mapped_test.bin").string();
+	{
+		std::ofstream file(filename, std::ios::binary);
+		EXPECT_TRUE(WriteTree(file, tree));
+	}
+
+	MappedTree<int64_t> mapped;
+	EXPECT_FALSE(mapped.IsOpen());
+	ASSERT_TRUE(mapped.Open(filename));
+	EXPECT_EQ(tree.Size(), mapped->Size());
+	EXPECT_EQ(0, mapped->MemoryUsage());
+	for (int64_t i = -1; i < 300010; i += 7)
+	{
+		EXPECT_EQ(tree.Find(i).first, mapped->Find(i).first);
+		EXPECT_EQ(tree.LowerBound(i).Index(), mapped->LowerBound(i).Index());
+	}
+
+	MappedTree<int64_t> moved = std::move(mapped);
+	EXPECT_FALSE(mapped.IsOpen());
+	EXPECT_TRUE(std::equal(moved->begin(), moved->end(), tree.begin(), tree.end()));
+	EXPECT_EQ(tree.At(500), moved.Tree().At(500));
+
+	MappedTree<int32_t> wrongType;
+	EXPECT_FALSE(wrongType.Open(filename));
+	EXPECT_FALSE(wrongType.IsOpen());
+
+	moved.Close();
+	EXPECT_FALSE(moved.IsOpen());
+	EXPECT_TRUE(moved->Empty());
+	std::filesystem::remove(filename);
+	EXPECT_FALSE(moved.Open(filename));
+}
+
+TEST(RcuRedBlackTree, FuzzyInsertDelete)
+{
+	RcuRedBlackTree<int64_t> tree;
+	RcuRedBlackTree<int64_t>::Reader reader(tree);
+	RedBlackTree<int64_t> reference;
+	std::mt19937_64 e2(5);
+	std::uniform_int_distribution<int64_t> dist(0, 3000);
+
+	for (size_t i = 0; i < 20000; i++)
+	{
+		int64_t item = dist(e2);
+		if (dist(e2) % 5 >= 2)
+		{
+			EXPECT_EQ(reference.Insert(item), tree.Insert(item));
+		}
+		else
+		{
+			EXPECT_EQ(reference.Delete(item), tree.Delete(item));
+		}
+
+		if (i % 1000 == 0)
+		{
+			EXPECT_EQ(1, FORCE_CHECKS(tree));
+		}
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+	EXPECT_EQ(reference.Size(), tree.Size());
+	EXPECT_EQ(reference.Size(), reader.Size());
+	for (int64_t item = 0; item <= 3000; ++item)
+	{
+		EXPECT_EQ(reference.Contains(item), reader.Contains(item));
+		EXPECT_EQ(reference.Find(item).first, reader.Find(item).first);
+	}
+
+	for (size_t i = 0; i < reference.Size(); ++i)
+	{
+		EXPECT_EQ(reference.At(i), reader.At(i));
+	}
+
+	tree.Clear();
+	EXPECT_TRUE(reader.Empty());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(RcuRedBlackTree, ConcurrentReaders)
+{
+	// Items are inserted in increasing and deleted in decreasing order, so
+	// every version readers can see holds a prefix of them.
+	constexpr int64_t count = 5000;
+	auto item = [](int64_t i) { std::string padded = std::to_string(i); return std::string(8 - padded.size(), '0') + padded; };
+
+	RcuRedBlackTree<std::string> tree;
+	std::atomic<bool> done = false;
+	std::atomic<size_t> failures = 0;
+
+	std::vector<std::thread> readers;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		readers.emplace_back([&, i]()
+		{
+			RcuRedBlackTree<std::string>::Reader reader(tree);
+			std::mt19937_64 e2(i);
+			std::uniform_int_distribution<int64_t> dist(0, count - 1);
+			while (!done.load())
+			{
+				int64_t index = dist(e2);
+				std::string found = reader.At(index);
+				failures += !found.empty() && found != item(index);
+
+				size_t foundIndex = reader.Find(item(index)).first;
+				failures += foundIndex != (size_t)index && foundIndex != (size_t)-1;
+			}
+		});
+	}
+
+	for (int64_t i = 0; i < count; ++i) tree.Insert(item(i));
+	for (int64_t i = count - 1; i >= 0; --i) tree.Delete(item(i));
+	done = true;
+
+	for (auto& reader : readers) reader.join();
+
+	EXPECT_EQ(0, failures.load());
+	EXPECT_TRUE(tree.Empty());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(PersistentRedBlackTree, FuzzyInsertDelete)
+{
+	PersistentRedBlackTree<int64_t> tree;
+	RedBlackTree<int64_t> reference;
+	std::mt19937_64 e2(9);
+	std::uniform_int_distribution<int64_t> dist(0, 3000);
+
+	for (size_t i = 0; i < 20000; i++)
+	{
+		int64_t item = dist(e2);
+		if (dist(e2) % 5 >= 2)
+		{
+			EXPECT_EQ(reference.Insert(item), tree.Insert(item));
+		}
+		else
+		{
+			EXPECT_EQ(reference.Delete(item), tree.Delete(item));
+		}
+
+		if (i % 1000 == 0)
+		{
+			EXPECT_EQ(1, FORCE_CHECKS(tree));
+		}
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+	EXPECT_TRUE(std::equal(reference.begin(), reference.end(), tree.begin(), tree.end()));
+	for (int64_t item = 0; item <= 3000; ++item)
+	{
+		EXPECT_EQ(reference.Find(item).first, tree.Find(item).first);
+	}
+}
+
+TEST(PersistentRedBlackTree, SnapshotsStayUnchanged)
+{
+	PersistentRedBlackTree<std::string> tree;
+	std::vector<PersistentRedBlackTree<std::string>> snapshots;
+	std::mt19937_64 e2(13);
+	std::uniform_int_distribution<int64_t> dist(0, 2000);
+
+	std::vector<std::vector<std::string>> expected;
+	for (size_t round = 0; round < 20; ++round)
+	{
+		for (size_t i = 0; i < 500; ++i)
+		{
+			if (dist(e2) % 3)
+			{
+				tree.Insert(std::to_string(dist(e2)));
+			}
+			else
+			{
+				tree.Delete(std::to_string(dist(e2)));
+			}
+		}
+
+		snapshots.push_back(tree.Snapshot());
+		expected.emplace_back(tree.begin(), tree.end());
+	}
+
+	// Modifying the snapshots does not affect one another either
+	for (size_t i = 0; i < snapshots.size(); i += 2)
+	{
+		snapshots[i].Clear();
+		expected[i].clear();
+	}
+
+	tree.Clear();
+	for (size_t i = 0; i < snapshots.size(); ++i)
+	{
+		EXPECT_EQ(expected[i].size(), snapshots[i].Size());
+		EXPECT_TRUE(std::equal(expected[i].begin(), expected[i].end(), snapshots[i].begin(), snapshots[i].end()));
+		EXPECT_EQ(1, FORCE_CHECKS(snapshots[i]));
+	}
+}
+
+TEST(PersistentRedBlackTree, ReadSnapshotWhileWriting)
+{
+	PersistentRedBlackTree<int64_t> tree;
+	for (int64_t i = 0; i < 10000; ++i) tree.Insert(i);
+
+	PersistentRedBlackTree<int64_t> snapshot = tree.Snapshot();
+	std::vector<std::thread> readers;
+	std::atomic<size_t> failures = 0;
+	for (size_t i = 0; i < 4; ++i)
+	{
+		readers.emplace_back([&]()
+		{
+			for (size_t round = 0; round < 5; ++round)
+			{
+				int64_t expected = 0;
+				for (int64_t item : snapshot) failures += item != expected++;
+				failures += snapshot.At(5000) != 5000;
+			}
+		});
+	}
+
+	for (int64_t i = 0; i < 10000; i += 2) tree.Delete(i);
+	for (int64_t i = 10000; i < 20000; ++i) tree.Insert(i);
+
+	for (auto& reader : readers) reader.join();
+
+	EXPECT_EQ(0, failures.load());
+	EXPECT_EQ(15000, tree.Size());
+	EXPECT_EQ(10000, snapshot.Size());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+	EXPECT_EQ(1, FORCE_CHECKS(snapshot));
+}
+
+TEST(ConcurrentRedBlackTree, FuzzyInsertDelete)
+{
+	// Enough items to split the tree into its shards and merge them again
+	ConcurrentRedBlackTree<int64_t> tree(8);
+	RedBlackTree<int64_t> reference;
+	std::mt19937_64 e2(13);
+	std::uniform_int_distribution<int64_t> dist(0, 100000);
+
+	for (size_t i = 0; i < 200000; i++)
+	{
+		int64_t item = dist(e2);
+		if (i < 100000 ? dist(e2) % 5 >= 2 : dist(e2) % 5 == 0)
+		{
+			EXPECT_EQ(reference.Insert(item), tree.Insert(item));
+		}
+		else
+		{
+			EXPECT_EQ(reference.Delete(item), tree.Delete(item));
+		}
+
+		if (i % 10000 == 0)
+		{
+			EXPECT_EQ(1, FORCE_CHECKS(tree));
+			EXPECT_EQ(reference.Size(), tree.Size());
+		}
+
+		if (i == 100000)
+		{
+			EXPECT_LT(4, tree.ShardCount());
+			EXPECT_GE(8, tree.ShardCount());
+			for (size_t j = 0; j < reference.Size(); ++j)
+			{
+				EXPECT_EQ(reference.At(j), tree.At(j));
+			}
+		}
+	}
+
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+	EXPECT_EQ(reference.Size(), tree.Size());
+	EXPECT_LT(tree.ShardCount(), 8);
+	for (int64_t item = 0; item <= 100000; item += 7)
+	{
+		EXPECT_EQ(reference.Contains(item), tree.Contains(item));
+		EXPECT_EQ(reference.Find(item).first, tree.Find(item).first);
+		EXPECT_EQ(reference.Rank(item), tree.Rank(item));
+	}
+
+	for (size_t i = 0; i < reference.Size(); ++i)
+	{
+		EXPECT_EQ(reference.At(i), tree.At(i));
+	}
+
+	EXPECT_EQ(0, tree.At(reference.Size()));
+	tree.Clear();
+	EXPECT_TRUE(tree.Empty());
+	EXPECT_EQ(1, tree.ShardCount());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+}
+
+TEST(ConcurrentRedBlackTree, ConcurrentWriters)
+{
+	// Every writer inserts and later deletes its own interleaved keys, while
+	// readers check that whatever they find is consistent.
+	constexpr int64_t count = 40000;
+	constexpr int64_t writerCount = 4;
+
+	ConcurrentRedBlackTree<int64_t> tree(16);
+	std::atomic<bool> done = false;
+	std::atomic<size_t> failures = 0;
+
+	std::vector<std::thread> readers;
+	for (size_t i = 0; i < 2; ++i)
+	{
+		readers.emplace_back([&, i]()
+		{
+			std::mt19937_64 e2(i);
+			std::uniform_int_distribution<int64_t> dist(0, count - 1);
+			while (!done.load())
+			{
+				int64_t item = dist(e2);
+				auto [index, found] = tree.Find(item);
+				failures += index != (size_t)-1 && found != item;
+				failures += tree.At(dist(e2)) >= count;
+			}
+		});
+	}
+
+	std::vector<std::thread> writers;
+	for (int64_t i = 0; i < writerCount; ++i)
+	{
+		writers.emplace_back([&, i]()
+		{
+			for (int64_t item = i; item < count; item += writerCount) failures += !tree.Insert(item);
+			for (int64_t item = i; item < count; item += 2 * writerCount) failures += !tree.Delete(item);
+		});
+	}
+
+	for (auto& writer : writers) writer.join();
+	done = true;
+	for (auto& reader : readers) reader.join();
+
+	EXPECT_EQ(0, failures.load());
+	EXPECT_EQ(count / 2, tree.Size());
+	EXPECT_LT(1, tree.ShardCount());
+	EXPECT_EQ(1, FORCE_CHECKS(tree));
+	for (int64_t i = 0; i < count / 2; ++i)
+	{
+		EXPECT_EQ(i / writerCount * 2 * writerCount + writerCount + i % writerCount, tree.At(i));
+	}
+}